@@ -0,0 +1,339 @@
+#include "PulseFS/Core/JournalSource.hpp"
+#include "PulseFS/Core/UsnBatchDecoder.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "SyntheticTree.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace PulseFS;
+
+namespace {
+
+struct Options {
+  size_t entries = 1000000;
+  size_t searchers = 4;
+  size_t writers = 1;
+  double durationSeconds = 10.0;
+  size_t searchIntervalUs = 0;
+  size_t maxResults = 100;
+  uint64_t seed = 1;
+  std::string recording;
+  std::string label;
+};
+
+const wchar_t *const kQueries[] = {L".js", L"report", L"budget-invoice",
+                                   L"qqzx", L"index_", L"notes"};
+
+constexpr unsigned long long kSequence = 1ull << 48;
+constexpr unsigned long long kRecordMask = kSequence - 1;
+// Record numbers reserved for each writer's churn, above the base tree.
+constexpr unsigned long long kWriterSpan = 1ull << 22;
+
+void PrintUsage() {
+  std::printf(
+      "usage: pulsefs-contention [--entries <n>] [--searchers <n>]\n"
+      "                          [--writers <n>] [--duration-s <seconds>]\n"
+      "                          [--search-interval-us <n>] [--limit <n>]\n"
+      "                          [--seed <n>] [--recording <file>]\n"
+      "                          [--label <text>]\n"
+      "Runs search threads against writer threads applying journal churn and\n"
+      "writes one JSON object with latency percentiles and lock wait time.\n"
+      "--recording replays a pulsefs-replay capture at full speed in place\n"
+      "of the synthetic churn.\n");
+}
+
+bool ParseArgs(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!value)
+      return false;
+    ++i;
+
+    if (std::strcmp(arg, "--entries") == 0) {
+      options.entries = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--searchers") == 0) {
+      options.searchers = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--writers") == 0) {
+      options.writers = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--duration-s") == 0) {
+      options.durationSeconds = std::strtod(value, nullptr);
+    } else if (std::strcmp(arg, "--search-interval-us") == 0) {
+      options.searchIntervalUs = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--limit") == 0) {
+      options.maxResults = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--seed") == 0) {
+      options.seed = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--recording") == 0) {
+      options.recording = value;
+    } else if (std::strcmp(arg, "--label") == 0) {
+      options.label = value;
+    } else {
+      return false;
+    }
+  }
+  return options.durationSeconds > 0 &&
+         (options.searchers > 0 || options.writers > 0);
+}
+
+using Clock = std::chrono::steady_clock;
+
+unsigned long long NanosecondsSince(Clock::time_point start) {
+  return static_cast<unsigned long long>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                           start)
+          .count());
+}
+
+struct WriterResult {
+  unsigned long long buffers = 0;
+  unsigned long long records = 0;
+  unsigned long long changes = 0;
+  std::vector<unsigned long long> applyNs;
+};
+
+// Moves synthetic FRNs into the writer's own record range so concurrent
+// writers never collide with each other or with the base tree; the synthetic
+// root becomes the tree root so churn lands under the real hierarchy.
+class IdRemap {
+public:
+  IdRemap(unsigned long long syntheticRoot, unsigned long long treeRoot,
+          unsigned long long base)
+      : m_syntheticRoot(syntheticRoot), m_treeRoot(treeRoot), m_base(base) {}
+
+  unsigned long long operator()(unsigned long long id) const {
+    if (id == m_syntheticRoot)
+      return m_treeRoot;
+    return kSequence | (m_base + (id & kRecordMask));
+  }
+
+private:
+  unsigned long long m_syntheticRoot;
+  unsigned long long m_treeRoot;
+  unsigned long long m_base;
+};
+
+std::unique_ptr<Core::JournalSource>
+OpenSource(const Options &options, size_t writer, size_t cycle) {
+  if (!options.recording.empty()) {
+    auto replay = std::make_unique<Core::ReplayJournalSource>(
+        options.recording, Core::ReplayPacing::FullSpeed);
+    if (!replay->IsOpen())
+      return nullptr;
+    return replay;
+  }
+  Core::SyntheticChurnOptions churn;
+  churn.seed = options.seed * 7919 + writer * 104729 + cycle;
+  churn.buffers = 1000;
+  return std::make_unique<Core::SyntheticJournalSource>(churn);
+}
+
+void RunWriter(Engine::SearchIndex &index, const Options &options,
+               size_t writer, unsigned long long treeRoot,
+               const std::atomic<bool> &stop, WriterResult &result) {
+  Core::SyntheticChurnOptions churn;
+  churn.seed = options.seed * 7919 + writer * 104729;
+  const auto initial = Core::SyntheticJournalSource(churn).InitialEntries();
+  const bool synthetic = options.recording.empty();
+  const IdRemap remap(initial.front().id, treeRoot,
+                      options.entries + 16 + writer * kWriterSpan);
+
+  if (synthetic) {
+    std::vector<Engine::IndexChange> seed;
+    for (const auto &entry : initial) {
+      if (entry.id == initial.front().id)
+        continue;
+      Engine::FileEntry directory = entry;
+      directory.name = L"writer" + std::to_wstring(writer) + L"_" + entry.name;
+      directory.id = remap(entry.id);
+      directory.parentId = remap(entry.parentId);
+      seed.push_back({Engine::ChangeKind::Insert, std::move(directory)});
+    }
+    index.ApplyBatch(seed);
+  }
+
+  std::vector<char> buffer;
+  Core::UsnBatchDecoder decoder;
+  for (size_t cycle = 0; !stop.load(std::memory_order_relaxed); ++cycle) {
+    auto source = OpenSource(options, writer, cycle);
+    if (!source)
+      return;
+
+    bool finished = false;
+    while (!finished && !stop.load(std::memory_order_relaxed)) {
+      switch (source->Read(buffer)) {
+      case Core::JournalRead::Data:
+        break;
+      case Core::JournalRead::Idle:
+        continue;
+      case Core::JournalRead::Finished:
+      case Core::JournalRead::Failed:
+        finished = true;
+        continue;
+      }
+
+      decoder.Decode(buffer.data() + sizeof(long long),
+                     buffer.size() - sizeof(long long));
+      result.records += decoder.RecordCount();
+      auto batch = decoder.TakeBatch();
+      if (synthetic) {
+        for (auto &change : batch) {
+          change.entry.id = remap(change.entry.id);
+          change.entry.parentId = remap(change.entry.parentId);
+        }
+      }
+
+      const auto start = Clock::now();
+      index.ApplyBatch(batch);
+      result.applyNs.push_back(NanosecondsSince(start));
+      result.buffers++;
+      result.changes += batch.size();
+    }
+  }
+}
+
+void RunSearcher(const Engine::SearchIndex &index, const Options &options,
+                 size_t searcher, const std::atomic<bool> &stop,
+                 std::vector<unsigned long long> &latencies) {
+  size_t next = searcher;
+  while (!stop.load(std::memory_order_relaxed)) {
+    const auto start = Clock::now();
+    index.Search(kQueries[next++ % std::size(kQueries)], options.maxResults);
+    latencies.push_back(NanosecondsSince(start));
+    if (options.searchIntervalUs)
+      std::this_thread::sleep_for(
+          std::chrono::microseconds(options.searchIntervalUs));
+  }
+}
+
+double Percentile(const std::vector<unsigned long long> &sorted,
+                  double fraction) {
+  if (sorted.empty())
+    return 0.0;
+  const size_t rank = std::min(
+      sorted.size() - 1,
+      static_cast<size_t>(fraction * static_cast<double>(sorted.size())));
+  return static_cast<double>(sorted[rank]) / 1e3;
+}
+
+std::string LatencyFields(const char *prefix,
+                          std::vector<unsigned long long> &samples) {
+  std::sort(samples.begin(), samples.end());
+  char text[256];
+  std::snprintf(text, sizeof(text),
+                ",\"%s_count\":%zu,\"%s_p50_us\":%.1f,\"%s_p99_us\":%.1f,"
+                "\"%s_p999_us\":%.1f,\"%s_max_us\":%.1f",
+                prefix, samples.size(), prefix, Percentile(samples, 0.5),
+                prefix, Percentile(samples, 0.99), prefix,
+                Percentile(samples, 0.999), prefix,
+                samples.empty() ? 0.0
+                                : static_cast<double>(samples.back()) / 1e3);
+  return text;
+}
+
+double Average(unsigned long long total, unsigned long long count) {
+  return count ? static_cast<double>(total) / static_cast<double>(count) : 0.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  Engine::SearchIndex index;
+  unsigned long long treeRoot = kSequence | 5;
+  if (options.entries >= 2) {
+    Bench::TreeShape shape;
+    shape.seed = options.seed;
+    shape.entries = options.entries;
+    auto tree = Bench::GenerateTree(shape);
+    treeRoot = tree.front().id;
+
+    index.Reserve(tree.size());
+    std::vector<Engine::IndexChange> batch;
+    batch.reserve(tree.size());
+    for (auto &entry : tree)
+      batch.push_back({Engine::ChangeKind::Insert, std::move(entry)});
+    index.ApplyBatch(batch);
+  } else {
+    options.entries = 0;
+  }
+  const size_t baseEntries = index.Count();
+
+  index.SetLockTracking(true);
+  std::atomic<bool> stop = false;
+  std::vector<WriterResult> writerResults(options.writers);
+  std::vector<std::vector<unsigned long long>> searchLatencies(
+      options.searchers);
+  std::vector<std::thread> threads;
+
+  const auto start = Clock::now();
+  for (size_t w = 0; w < options.writers; ++w) {
+    threads.emplace_back(RunWriter, std::ref(index), std::cref(options), w,
+                         treeRoot, std::cref(stop), std::ref(writerResults[w]));
+  }
+  for (size_t s = 0; s < options.searchers; ++s) {
+    threads.emplace_back(RunSearcher, std::cref(index), std::cref(options), s,
+                         std::cref(stop), std::ref(searchLatencies[s]));
+  }
+
+  std::this_thread::sleep_for(
+      std::chrono::duration<double>(options.durationSeconds));
+  stop = true;
+  for (auto &thread : threads)
+    thread.join();
+  const double elapsedSeconds =
+      static_cast<double>(NanosecondsSince(start)) / 1e9;
+  const Engine::LockWaitStats locks = index.GetLockWaitStats();
+
+  std::vector<unsigned long long> queries;
+  for (auto &latencies : searchLatencies)
+    queries.insert(queries.end(), latencies.begin(), latencies.end());
+
+  WriterResult writes;
+  for (auto &result : writerResults) {
+    writes.buffers += result.buffers;
+    writes.records += result.records;
+    writes.changes += result.changes;
+    writes.applyNs.insert(writes.applyNs.end(), result.applyNs.begin(),
+                          result.applyNs.end());
+  }
+
+  std::printf(
+      "{\"label\":\"%s\",\"seed\":%llu,\"benchmark\":\"contention\","
+      "\"base_entries\":%zu,\"final_entries\":%zu,\"searchers\":%zu,"
+      "\"writers\":%zu,\"duration_s\":%.2f,\"queries_per_s\":%.1f%s,"
+      "\"writer_buffers\":%llu,\"writer_records_per_s\":%.1f,"
+      "\"writer_changes_per_s\":%.1f%s,"
+      "\"exclusive_locks\":%llu,\"exclusive_wait_ms\":%.3f,"
+      "\"exclusive_wait_avg_us\":%.2f,\"exclusive_wait_max_us\":%.1f,"
+      "\"shared_locks\":%llu,\"shared_wait_ms\":%.3f,"
+      "\"shared_wait_avg_us\":%.2f,\"shared_wait_max_us\":%.1f}\n",
+      options.label.c_str(), static_cast<unsigned long long>(options.seed),
+      baseEntries, index.Count(), options.searchers, options.writers,
+      elapsedSeconds, static_cast<double>(queries.size()) / elapsedSeconds,
+      LatencyFields("query", queries).c_str(), writes.buffers,
+      static_cast<double>(writes.records) / elapsedSeconds,
+      static_cast<double>(writes.changes) / elapsedSeconds,
+      LatencyFields("apply", writes.applyNs).c_str(),
+      locks.exclusiveAcquisitions,
+      static_cast<double>(locks.exclusiveWaitNs) / 1e6,
+      Average(locks.exclusiveWaitNs, locks.exclusiveAcquisitions) / 1e3,
+      static_cast<double>(locks.exclusiveMaxWaitNs) / 1e3,
+      locks.sharedAcquisitions, static_cast<double>(locks.sharedWaitNs) / 1e6,
+      Average(locks.sharedWaitNs, locks.sharedAcquisitions) / 1e3,
+      static_cast<double>(locks.sharedMaxWaitNs) / 1e3);
+  return 0;
+}
@@ -0,0 +1,322 @@
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "SyntheticTree.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#ifdef _WIN32
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <fstream>
+#include <unistd.h>
+#endif
+
+using namespace PulseFS;
+
+namespace {
+
+struct Options {
+  std::vector<size_t> sizes = {1000000};
+  uint64_t seed = 1;
+  size_t repeat = 5;
+  size_t pathLookups = 200000;
+  size_t renames = 200000;
+  std::string label;
+};
+
+struct Query {
+  const char *selectivity;
+  const wchar_t *text;
+};
+
+// From "most names match" down to "nothing matches, full scan".
+const Query kQueries[] = {{"high", L".js"},
+                          {"medium", L"report"},
+                          {"low", L"budget-invoice"},
+                          {"none", L"qqzx"}};
+
+void PrintUsage() {
+  std::printf(
+      "usage: pulsefs-bench [--sizes <n,n,...>] [--seed <n>] [--repeat <n>]\n"
+      "                     [--path-lookups <n>] [--renames <n>]\n"
+      "                     [--label <text>]\n"
+      "Writes one JSON object per measurement to stdout.\n");
+}
+
+std::vector<size_t> ParseSizes(const char *text) {
+  std::vector<size_t> sizes;
+  for (const char *p = text; *p;) {
+    char *end = nullptr;
+    sizes.push_back(std::strtoull(p, &end, 10));
+    p = (*end == ',') ? end + 1 : end;
+    if (end == p && *p)
+      break;
+  }
+  return sizes;
+}
+
+bool ParseArgs(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!value)
+      return false;
+    ++i;
+
+    if (std::strcmp(arg, "--sizes") == 0) {
+      options.sizes = ParseSizes(value);
+    } else if (std::strcmp(arg, "--seed") == 0) {
+      options.seed = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--repeat") == 0) {
+      options.repeat = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+    } else if (std::strcmp(arg, "--path-lookups") == 0) {
+      options.pathLookups = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--renames") == 0) {
+      options.renames = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--label") == 0) {
+      options.label = value;
+    } else {
+      return false;
+    }
+  }
+  return !options.sizes.empty();
+}
+
+size_t ResidentBytes() {
+#ifdef _WIN32
+  PROCESS_MEMORY_COUNTERS counters = {};
+  if (::K32GetProcessMemoryInfo(::GetCurrentProcess(), &counters,
+                                sizeof(counters)))
+    return counters.WorkingSetSize;
+  return 0;
+#else
+  std::ifstream statm("/proc/self/statm");
+  size_t pages = 0, resident = 0;
+  statm >> pages >> resident;
+  return resident * static_cast<size_t>(::sysconf(_SC_PAGESIZE));
+#endif
+}
+
+class Reporter {
+public:
+  Reporter(const Options &options, size_t size)
+      : m_options(options), m_size(size) {}
+
+  // ops/elapsed become ns_per_op; extra is a pre-formatted JSON fragment.
+  void Timing(const char *benchmark, size_t ops, double elapsedNs,
+              const std::string &extra = {}) {
+    std::printf("{\"label\":\"%s\",\"seed\":%llu,\"size\":%zu,"
+                "\"benchmark\":\"%s\",\"ops\":%zu,\"total_ms\":%.3f,"
+                "\"ns_per_op\":%.1f%s}\n",
+                m_options.label.c_str(),
+                static_cast<unsigned long long>(m_options.seed), m_size,
+                benchmark, ops, elapsedNs / 1e6,
+                ops ? elapsedNs / static_cast<double>(ops) : 0.0,
+                extra.c_str());
+    std::fflush(stdout);
+  }
+
+  void Memory(size_t indexBytes, size_t residentDelta) {
+    std::printf("{\"label\":\"%s\",\"seed\":%llu,\"size\":%zu,"
+                "\"benchmark\":\"memory\",\"index_bytes\":%zu,"
+                "\"bytes_per_entry\":%.1f,\"rss_delta_bytes\":%zu}\n",
+                m_options.label.c_str(),
+                static_cast<unsigned long long>(m_options.seed), m_size,
+                indexBytes,
+                static_cast<double>(indexBytes) / static_cast<double>(m_size),
+                residentDelta);
+    std::fflush(stdout);
+  }
+
+private:
+  const Options &m_options;
+  size_t m_size;
+};
+
+template <typename Fn> double TimeNs(Fn &&fn) {
+  auto start = std::chrono::steady_clock::now();
+  fn();
+  return std::chrono::duration<double, std::nano>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+template <typename Fn> double MedianNs(size_t repeat, Fn &&fn) {
+  std::vector<double> samples;
+  for (size_t i = 0; i < repeat; ++i)
+    samples.push_back(TimeNs(fn));
+  std::sort(samples.begin(), samples.end());
+  return samples[samples.size() / 2];
+}
+
+void RunSize(const Options &options, size_t size) {
+  Reporter report(options, size);
+
+  Bench::TreeShape shape;
+  shape.seed = options.seed;
+  shape.entries = size;
+  std::vector<Engine::FileEntry> tree;
+  report.Timing("generate", size,
+                TimeNs([&] { tree = Bench::GenerateTree(shape); }));
+
+  {
+    Engine::SearchIndex index;
+    report.Timing("insert", tree.size(), TimeNs([&] {
+                    for (const auto &entry : tree)
+                      index.Insert(entry);
+                  }));
+  }
+
+  const size_t residentBefore = ResidentBytes();
+  Engine::SearchIndex index;
+  report.Timing("bulk_load", tree.size(), TimeNs([&] {
+                  constexpr size_t kChunk = 65536;
+                  index.Reserve(tree.size());
+                  index.BeginBulkLoad();
+                  std::vector<Engine::IndexChange> batch;
+                  batch.reserve(kChunk);
+                  for (const auto &entry : tree) {
+                    batch.push_back({Engine::ChangeKind::Insert, entry});
+                    if (batch.size() == kChunk) {
+                      index.ApplyBatch(batch);
+                      batch.clear();
+                    }
+                  }
+                  index.ApplyBatch(batch);
+                  index.EndBulkLoad();
+                }));
+  const size_t residentAfter = ResidentBytes();
+  report.Memory(index.MemoryUsage(), residentAfter > residentBefore
+                                         ? residentAfter - residentBefore
+                                         : 0);
+
+  for (const auto &query : kQueries) {
+    auto extra = [&](size_t hits) {
+      return std::string(",\"selectivity\":\"") + query.selectivity +
+             "\",\"hits\":" + std::to_string(hits);
+    };
+    size_t hits = 0;
+    const double allNs = MedianNs(options.repeat, [&] {
+      hits = index.Search(query.text, static_cast<size_t>(-1)).size();
+    });
+    report.Timing("search_all", 1, allNs, extra(hits));
+    size_t limitedHits = 0;
+    const double limitedNs = MedianNs(options.repeat, [&] {
+      limitedHits = index.Search(query.text, 100).size();
+    });
+    report.Timing("search_limit100", 1, limitedNs, extra(limitedHits));
+  }
+
+  // The same queries restricted to folders, which the attribute bitmaps
+  // answer without reading the files' names.
+  const Engine::AttributeFilter foldersOnly{Engine::kAttributeDirectory, 0};
+  for (const auto &query : kQueries) {
+    size_t hits = 0;
+    const double foldersNs = MedianNs(options.repeat, [&] {
+      hits = index.Search(query.text, static_cast<size_t>(-1), foldersOnly)
+                 .size();
+    });
+    report.Timing("search_folders", 1, foldersNs,
+                  std::string(",\"selectivity\":\"") + query.selectivity +
+                      "\",\"hits\":" + std::to_string(hits));
+  }
+
+  std::mt19937_64 rng(options.seed ^ 0xBE1C4ull);
+  std::vector<unsigned long long> ids(options.pathLookups);
+  for (auto &id : ids)
+    id = tree[rng() % tree.size()].id;
+  size_t pathChars = 0;
+  const double pathNs = TimeNs([&] {
+    for (auto id : ids)
+      pathChars += index.GetFullPath(id).size();
+  });
+  report.Timing("get_full_path", ids.size(), pathNs,
+                ",\"avg_path_chars\":" +
+                    std::to_string(ids.empty() ? 0 : pathChars / ids.size()));
+
+  std::vector<unsigned long long> directories;
+  for (const auto &entry : tree) {
+    if (entry.fileAttributes & Engine::kAttributeDirectory)
+      directories.push_back(entry.id);
+  }
+  // Listing goes through the child index; the largest directory shows the
+  // cost per child, the sample the cost per call.
+  std::unordered_map<unsigned long long, size_t> childCounts;
+  for (const auto &entry : tree) {
+    if (entry.id != entry.parentId)
+      childCounts[entry.parentId]++;
+  }
+  const auto largest = std::max_element(
+      childCounts.begin(), childCounts.end(),
+      [](const auto &a, const auto &b) { return a.second < b.second; });
+  size_t listed = 0;
+  const double largestNs = MedianNs(options.repeat, [&] {
+    listed = index.GetChildIds(largest->first).size();
+  });
+  report.Timing("list_largest", 1, largestNs,
+                ",\"children\":" + std::to_string(listed));
+  std::vector<unsigned long long> listings(options.pathLookups);
+  for (auto &id : listings)
+    id = directories[rng() % directories.size()];
+  listed = 0;
+  const double listNs = TimeNs([&] {
+    for (auto id : listings)
+      listed += index.GetChildIds(id).size();
+  });
+  report.Timing("list_children", listings.size(), listNs,
+                ",\"avg_children\":" +
+                    std::to_string(listings.empty()
+                                       ? 0
+                                       : listed / listings.size()));
+
+  // Folder totals are kept current, so this walks down from the root only as
+  // far as the answer needs.
+  const unsigned long long root = tree.front().id;
+  size_t folders = 0;
+  const double foldersNs = MedianNs(options.repeat, [&] {
+    folders = index.LargestFolders(root, 100).size();
+  });
+  report.Timing("largest_folders", 1, foldersNs,
+                ",\"folders\":" + std::to_string(folders));
+
+  std::vector<std::pair<size_t, size_t>> moves(options.renames);
+  for (auto &move : moves)
+    move = {1 + rng() % (tree.size() - 1), rng() % directories.size()};
+  // Directories are skipped, so only the renames actually done count.
+  size_t renamed = 0;
+  const double renameNs = TimeNs([&] {
+    for (const auto &[entryIndex, directoryIndex] : moves) {
+      const auto &entry = tree[entryIndex];
+      if (entry.fileAttributes & Engine::kAttributeDirectory)
+        continue;
+      index.Rename(entry.id, L"renamed_" + std::to_wstring(renamed++),
+                   directories[directoryIndex]);
+    }
+  });
+  report.Timing("rename_storm", renamed, renameNs);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  for (size_t size : options.sizes) {
+    if (size < 2)
+      continue;
+    RunSize(options, size);
+  }
+  return 0;
+}
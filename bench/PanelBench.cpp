@@ -0,0 +1,316 @@
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/UI/PanelPlatform.hpp"
+#include "PulseFS/UI/SearchPanel.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+#include "SyntheticTree.hpp"
+#include "imgui.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <new>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Drives SearchPanel::Render through ImGui with no platform or renderer
+// backend: frames are built and discarded, so what is measured is the CPU
+// cost of the panel and of ImGui itself.
+
+using namespace PulseFS;
+
+namespace {
+
+// Only the thread that renders is counted; search workers allocate too, but
+// not on the frame's critical path.
+thread_local bool t_countAllocations = false;
+thread_local unsigned long long t_allocations = 0;
+thread_local unsigned long long t_allocatedBytes = 0;
+
+void CountAllocation(size_t size) {
+  if (t_countAllocations) {
+    t_allocations++;
+    t_allocatedBytes += size;
+  }
+}
+
+void *CountingImGuiAlloc(size_t size, void *) {
+  CountAllocation(size);
+  return std::malloc(size);
+}
+
+void CountingImGuiFree(void *ptr, void *) { std::free(ptr); }
+
+} // namespace
+
+void *operator new(size_t size) {
+  CountAllocation(size);
+  if (void *ptr = std::malloc(size ? size : 1))
+    return ptr;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *ptr) noexcept { std::free(ptr); }
+void operator delete(void *ptr, size_t) noexcept { std::free(ptr); }
+
+namespace {
+
+struct Options {
+  size_t entries = 1000000;
+  size_t maxResults = 10000;
+  size_t frames = 600;
+  size_t churn = 16;
+  uint64_t seed = 1;
+  std::string query = ".js";
+  std::string label;
+};
+
+void PrintUsage() {
+  std::printf(
+      "usage: pulsefs-panelbench [--entries <n>] [--max-results <n>]\n"
+      "                          [--frames <n>] [--churn <n>] [--seed <n>]\n"
+      "                          [--query <text>] [--label <text>]\n"
+      "Renders the search panel headless and writes one JSON object per\n"
+      "scenario to stdout.\n");
+}
+
+bool ParseArgs(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!value)
+      return false;
+    ++i;
+
+    if (std::strcmp(arg, "--entries") == 0) {
+      options.entries = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--max-results") == 0) {
+      options.maxResults = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--frames") == 0) {
+      options.frames = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+    } else if (std::strcmp(arg, "--churn") == 0) {
+      options.churn = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--seed") == 0) {
+      options.seed = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--query") == 0) {
+      options.query = value;
+    } else if (std::strcmp(arg, "--label") == 0) {
+      options.label = value;
+    } else {
+      return false;
+    }
+  }
+  return options.entries > 0;
+}
+
+// Every row gets the same texture, so icons cost what a fully warm cache
+// does.
+class FixedIcons : public UI::IconSource {
+public:
+  UI::IconView GetIcon(const std::wstring &, bool) override {
+    return Texture(16, 16);
+  }
+  UI::IconView GetThumbnail(const std::wstring &) override {
+    return Texture(256, 192);
+  }
+
+private:
+  static UI::IconView Texture(uint32_t width, uint32_t height) {
+    UI::IconView view;
+    view.texture = (ImTextureID)(intptr_t)1;
+    view.width = width;
+    view.height = height;
+    return view;
+  }
+};
+
+class NoFileActions : public UI::FileActions {
+public:
+  void Reveal(const std::wstring &) override {}
+};
+
+struct FrameSample {
+  double cpuNs;
+  unsigned long long allocations;
+  unsigned long long allocatedBytes;
+};
+
+FrameSample RenderFrame(UI::SearchPanel &panel) {
+  ImGuiIO &io = ImGui::GetIO();
+  io.DisplaySize = ImVec2(1280.0f, 800.0f);
+  io.DeltaTime = 1.0f / 60.0f;
+
+  t_allocations = 0;
+  t_allocatedBytes = 0;
+  t_countAllocations = true;
+  const auto start = std::chrono::steady_clock::now();
+  ImGui::NewFrame();
+  panel.Render();
+  ImGui::Render();
+  const auto elapsed = std::chrono::steady_clock::now() - start;
+  t_countAllocations = false;
+
+  return {std::chrono::duration<double, std::nano>(elapsed).count(),
+          t_allocations, t_allocatedBytes};
+}
+
+void Report(const Options &options, const char *scenario, size_t rows,
+            std::vector<FrameSample> &samples) {
+  std::sort(samples.begin(), samples.end(),
+            [](const FrameSample &a, const FrameSample &b) {
+              return a.cpuNs < b.cpuNs;
+            });
+  auto percentile = [&](double p) {
+    const size_t index = static_cast<size_t>(p * (samples.size() - 1));
+    return samples[index].cpuNs / 1e3;
+  };
+  unsigned long long allocations = 0, allocatedBytes = 0;
+  for (const auto &sample : samples) {
+    allocations += sample.allocations;
+    allocatedBytes += sample.allocatedBytes;
+  }
+  const double frames = static_cast<double>(samples.size());
+
+  std::printf("{\"label\":\"%s\",\"seed\":%llu,\"entries\":%zu,"
+              "\"benchmark\":\"panel_%s\",\"rows\":%zu,\"frames\":%zu,"
+              "\"p50_us\":%.1f,\"p99_us\":%.1f,\"max_us\":%.1f,"
+              "\"allocs_per_frame\":%.1f,\"alloc_bytes_per_frame\":%.0f}\n",
+              options.label.c_str(),
+              static_cast<unsigned long long>(options.seed), options.entries,
+              scenario, rows, samples.size(), percentile(0.5),
+              percentile(0.99), samples.back().cpuNs / 1e3,
+              static_cast<double>(allocations) / frames,
+              static_cast<double>(allocatedBytes) / frames);
+  std::fflush(stdout);
+}
+
+// Renders until the first result set lands, so the scenarios start from a
+// populated table.
+bool WaitForResults(UI::SearchPanel &panel) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(30);
+  while (panel.ResultCount() == 0) {
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    RenderFrame(panel);
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  // A few more frames to settle layout and the table's column widths.
+  for (int i = 0; i < 10; ++i)
+    RenderFrame(panel);
+  return true;
+}
+
+void Run(const Options &options) {
+  Bench::TreeShape shape;
+  shape.seed = options.seed;
+  shape.entries = options.entries;
+  std::vector<Engine::FileEntry> tree = Bench::GenerateTree(shape);
+
+  Engine::SearchIndex index;
+  index.Reserve(tree.size());
+  {
+    constexpr size_t kChunk = 65536;
+    std::vector<Engine::IndexChange> batch;
+    batch.reserve(kChunk);
+    for (const auto &entry : tree) {
+      batch.push_back({Engine::ChangeKind::Insert, entry});
+      if (batch.size() == kChunk) {
+        index.ApplyBatch(batch);
+        batch.clear();
+      }
+    }
+    index.ApplyBatch(batch);
+  }
+
+  FixedIcons icons;
+  NoFileActions files;
+  UI::SearchPanel panel;
+  panel.Initialize(index, &icons, &files);
+  panel.SetMaxResults(options.maxResults);
+  panel.SetScanning(false);
+  panel.SetQuery(options.query);
+
+  if (!WaitForResults(panel)) {
+    std::fprintf(stderr, "no results for query \"%s\"\n",
+                 options.query.c_str());
+    return;
+  }
+
+  std::vector<FrameSample> samples;
+  samples.reserve(options.frames);
+
+  // Nothing changes between frames.
+  for (size_t i = 0; i < options.frames; ++i)
+    samples.push_back(RenderFrame(panel));
+  Report(options, "static", panel.ResultCount(), samples);
+
+  // The table scrolls every frame, turning around every 200 frames.
+  samples.clear();
+  ImGuiIO &io = ImGui::GetIO();
+  io.AddMousePosEvent(640.0f, 400.0f);
+  for (size_t i = 0; i < options.frames; ++i) {
+    io.AddMouseWheelEvent(0.0f, (i / 200) % 2 ? 1.0f : -1.0f);
+    samples.push_back(RenderFrame(panel));
+  }
+  Report(options, "scroll", panel.ResultCount(), samples);
+
+  // Entries are renamed into the results on one frame and back out on the
+  // next, as a busy journal would, and arrive as standing-query deltas.
+  samples.clear();
+  const std::wstring marker = Utils::WideFromUtf8(options.query);
+  std::mt19937_64 rng(options.seed);
+  std::uniform_int_distribution<size_t> pick(1, tree.size() - 1);
+  std::vector<Engine::IndexChange> renames;
+  std::vector<Engine::IndexChange> restores;
+  for (size_t i = 0; i < options.frames; ++i) {
+    if (restores.empty()) {
+      renames.clear();
+      for (size_t k = 0; k < options.churn; ++k) {
+        const Engine::FileEntry &original = tree[pick(rng)];
+        Engine::FileEntry renamed = original;
+        renamed.name += marker;
+        renames.push_back({Engine::ChangeKind::Rename, std::move(renamed)});
+        restores.push_back({Engine::ChangeKind::Rename, original});
+      }
+      index.ApplyBatch(renames);
+    } else {
+      index.ApplyBatch(restores);
+      restores.clear();
+    }
+    samples.push_back(RenderFrame(panel));
+  }
+  Report(options, "churn", panel.ResultCount(), samples);
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  ImGui::SetAllocatorFunctions(CountingImGuiAlloc, CountingImGuiFree);
+  IMGUI_CHECKVERSION();
+  ImGui::CreateContext();
+  ImGuiIO &io = ImGui::GetIO();
+  io.IniFilename = nullptr;
+  io.LogFilename = nullptr;
+#if IMGUI_VERSION_NUM >= 19200
+  // Textures are requested through the draw data and simply never uploaded.
+  io.BackendFlags |= ImGuiBackendFlags_RendererHasTextures;
+#else
+  unsigned char *pixels = nullptr;
+  int width = 0, height = 0;
+  io.Fonts->GetTexDataAsRGBA32(&pixels, &width, &height);
+#endif
+
+  Run(options);
+
+  ImGui::DestroyContext();
+  return 0;
+}
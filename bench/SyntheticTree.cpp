@@ -0,0 +1,190 @@
+#include "SyntheticTree.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include <algorithm>
+#include <random>
+#include <string>
+
+namespace PulseFS::Bench {
+
+namespace {
+
+constexpr unsigned long long kSequence = 1ull << 48;
+constexpr unsigned long long kFirstRecord = 16;
+
+const wchar_t *const kWords[] = {
+    L"index",   L"main",    L"report", L"invoice", L"photo",   L"backup",
+    L"config",  L"data",    L"final",  L"draft",   L"notes",   L"project",
+    L"release", L"setup",   L"test",   L"utils",   L"summary", L"budget",
+    L"meeting", L"archive", L"client", L"server",  L"module",  L"image"};
+
+const wchar_t *const kNonAsciiWords[] = {
+    L"résumé", L"Übersicht", L"données", L"данные",    L"写真",
+    L"文档",   L"音楽",      L"café",    L"naïve",     L"Größe",
+    L"日本語", L"표준",      L"αρχείο",  L"\U0001F4C1", L"\U0001F600"};
+
+struct Extension {
+  const wchar_t *text;
+  unsigned weight;
+};
+
+// Rough mix of a developer workstation volume.
+const Extension kExtensions[] = {
+    {L".js", 18},  {L".json", 8}, {L".ts", 6},  {L".cpp", 5}, {L".h", 5},
+    {L".py", 4},   {L".txt", 6},  {L".md", 4},  {L".png", 8}, {L".jpg", 7},
+    {L".dll", 6},  {L".exe", 2},  {L".pdf", 3}, {L".docx", 2}, {L".xml", 4},
+    {L".log", 3},  {L".mp3", 1},  {L".zip", 1}, {L"", 7}};
+
+const wchar_t *const kPackageFiles[] = {L"package.json", L"index.js",
+                                        L"README.md", L"LICENSE",
+                                        L"CHANGELOG.md"};
+
+class Generator {
+public:
+  explicit Generator(const TreeShape &shape)
+      : m_shape(shape), m_rng(shape.seed) {
+    for (const auto &extension : kExtensions)
+      m_extensionWeightTotal += extension.weight;
+  }
+
+  std::vector<Engine::FileEntry> Run() {
+    m_entries.reserve(m_shape.entries);
+    const unsigned long long root = NextId();
+    m_entries.push_back({L"", root, root, Engine::kAttributeDirectory, true});
+    m_open.push_back({root, 0});
+    m_directories.push_back({root, 0});
+
+    while (m_entries.size() < m_shape.entries) {
+      if (m_open.empty()) {
+        // Every branch bottomed out; reopen a random existing directory.
+        m_open.push_back(m_directories[Uniform(m_directories.size())]);
+      }
+
+      const size_t pick = Uniform(m_open.size());
+      const OpenDirectory directory = m_open[pick];
+      m_open[pick] = m_open.back();
+      m_open.pop_back();
+      Expand(directory);
+    }
+
+    m_entries.resize(m_shape.entries);
+    return std::move(m_entries);
+  }
+
+private:
+  struct OpenDirectory {
+    unsigned long long id;
+    size_t depth;
+  };
+
+  size_t Uniform(size_t bound) {
+    return static_cast<size_t>(m_rng() % std::max<size_t>(bound, 1));
+  }
+
+  bool Chance(double probability) {
+    return std::uniform_real_distribution<double>(0.0, 1.0)(m_rng) <
+           probability;
+  }
+
+  unsigned long long NextId() { return kSequence | (kFirstRecord + m_nextRecord++); }
+
+  unsigned long long Add(std::wstring name, unsigned long long parent,
+                         bool directory) {
+    const unsigned long long id = NextId();
+    unsigned long attributes =
+        directory ? Engine::kAttributeDirectory : Engine::kAttributeArchive;
+    if (!name.empty() && name[0] == L'.')
+      attributes |= Engine::kAttributeHidden;
+    m_entries.push_back({std::move(name), id, parent, attributes, true});
+    return id;
+  }
+
+  std::wstring Word() {
+    if (Chance(m_shape.nonAsciiFraction))
+      return kNonAsciiWords[Uniform(std::size(kNonAsciiWords))];
+    return kWords[Uniform(std::size(kWords))];
+  }
+
+  // Lengths cluster around 8-20 characters with a long tail of versioned
+  // and multi-word names.
+  std::wstring Stem() {
+    std::wstring stem = Word();
+    const size_t extraWords = Uniform(100) < 55 ? 0 : (Uniform(100) < 75 ? 1 : 2);
+    for (size_t i = 0; i < extraWords; ++i) {
+      stem += Uniform(2) ? L'_' : L'-';
+      stem += Word();
+    }
+    if (Uniform(100) < 35)
+      stem += std::to_wstring(Uniform(2000));
+    if (Uniform(100) < 3)
+      stem = L"." + stem;
+    return stem;
+  }
+
+  const wchar_t *PickExtension() {
+    unsigned roll = static_cast<unsigned>(Uniform(m_extensionWeightTotal));
+    for (const auto &extension : kExtensions) {
+      if (roll < extension.weight)
+        return extension.text;
+      roll -= extension.weight;
+    }
+    return L"";
+  }
+
+  void Expand(const OpenDirectory &directory) {
+    std::geometric_distribution<size_t> files(0.08);
+    const size_t fileCount = files(m_rng);
+    for (size_t i = 0; i < fileCount && !Full(); ++i)
+      Add(Stem() + PickExtension(), directory.id, false);
+
+    if (directory.depth + 1 >= m_shape.maxDepth)
+      return;
+
+    if (Chance(m_shape.packageRootChance))
+      AddNodeModules(directory.id);
+
+    // Branching thins out with depth so the tree keeps a realistic shape.
+    const double branching = directory.depth < 3 ? 0.25 : 0.4;
+    std::geometric_distribution<size_t> subdirectories(branching);
+    const size_t directoryCount = subdirectories(m_rng);
+    for (size_t i = 0; i < directoryCount && !Full(); ++i) {
+      unsigned long long id = Add(Stem(), directory.id, true);
+      m_open.push_back({id, directory.depth + 1});
+      m_directories.push_back({id, directory.depth + 1});
+    }
+  }
+
+  void AddNodeModules(unsigned long long parent) {
+    const unsigned long long modules = Add(L"node_modules", parent, true);
+    const size_t packages = 50 + Uniform(350);
+    for (size_t p = 0; p < packages && !Full(); ++p) {
+      const unsigned long long package =
+          Add(Word() + L"-" + Word(), modules, true);
+      for (const auto *file : kPackageFiles)
+        Add(file, package, false);
+      const unsigned long long lib = Add(L"lib", package, true);
+      const size_t sources = 3 + Uniform(20);
+      for (size_t i = 0; i < sources && !Full(); ++i)
+        Add(Stem() + L".js", lib, false);
+    }
+  }
+
+  [[nodiscard]] bool Full() const {
+    return m_entries.size() >= m_shape.entries;
+  }
+
+  TreeShape m_shape;
+  std::mt19937_64 m_rng;
+  unsigned m_extensionWeightTotal = 0;
+  unsigned long long m_nextRecord = 0;
+  std::vector<Engine::FileEntry> m_entries;
+  std::vector<OpenDirectory> m_open;
+  std::vector<OpenDirectory> m_directories;
+};
+
+} // namespace
+
+std::vector<Engine::FileEntry> GenerateTree(const TreeShape &shape) {
+  return Generator(shape).Run();
+}
+
+} // namespace PulseFS::Bench
@@ -0,0 +1,25 @@
+#pragma once
+
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PulseFS::Bench {
+
+struct TreeShape {
+  uint64_t seed = 1;
+  size_t entries = 1000000;
+  size_t maxDepth = 14;
+  // Fraction of names drawn from non-ASCII words (accents, CJK, emoji).
+  double nonAsciiFraction = 0.05;
+  // Chance that a directory is a project root with a node_modules fanout.
+  double packageRootChance = 0.002;
+};
+
+// Generates a reproducible NTFS-like tree: entry 0 is the root (id ==
+// parentId), every parent precedes its children, ids are FRNs with dense
+// record numbers.
+std::vector<Engine::FileEntry> GenerateTree(const TreeShape &shape);
+
+} // namespace PulseFS::Bench
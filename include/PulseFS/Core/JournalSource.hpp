@@ -0,0 +1,147 @@
+#pragma once
+
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <optional>
+#include <random>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include "PulseFS/Utils/WinHelpers.hpp"
+#endif
+
+namespace PulseFS::Core {
+
+enum class JournalRead { Data, Idle, Finished, Failed };
+
+// Produces raw FSCTL_READ_USN_JOURNAL buffers: an 8-byte next-USN header
+// followed by USN_RECORD_V2 entries.
+class JournalSource {
+public:
+  virtual ~JournalSource() = default;
+
+  virtual JournalRead Read(std::vector<char> &buffer) = 0;
+
+  // USN the journal will assign next, for lag reporting. Sources that are
+  // not backed by a live journal have no head.
+  virtual std::optional<long long> HeadUsn() { return std::nullopt; }
+
+  // Reads the current size and last write time of a file the journal said
+  // was written, into `entry`. Sources with no volume behind them cannot.
+  virtual bool ReadMetadata(unsigned long long /*id*/,
+                            Engine::FileEntry & /*entry*/) {
+    return false;
+  }
+};
+
+#ifdef _WIN32
+class VolumeJournalSource : public JournalSource {
+public:
+  VolumeJournalSource(std::wstring volumePath, long long startUsn);
+
+  JournalRead Read(std::vector<char> &buffer) override;
+  std::optional<long long> HeadUsn() override;
+  bool ReadMetadata(unsigned long long id, Engine::FileEntry &entry) override;
+
+private:
+  bool Open();
+
+  std::wstring m_volumePath;
+  long long m_nextUsn;
+  unsigned long long m_journalId = 0;
+  Utils::ScopedHandle m_volume;
+};
+#endif
+
+// Forwards buffers from another source and appends each one to a recording.
+class JournalRecorder : public JournalSource {
+public:
+  JournalRecorder(std::unique_ptr<JournalSource> inner,
+                  const std::string &outputPath);
+
+  JournalRead Read(std::vector<char> &buffer) override;
+  std::optional<long long> HeadUsn() override { return m_inner->HeadUsn(); }
+  bool ReadMetadata(unsigned long long id, Engine::FileEntry &entry) override {
+    return m_inner->ReadMetadata(id, entry);
+  }
+
+  [[nodiscard]] bool IsOpen() const { return m_out.is_open(); }
+
+private:
+  std::unique_ptr<JournalSource> m_inner;
+  std::ofstream m_out;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+enum class ReplayPacing { FullSpeed, RealTime };
+
+class ReplayJournalSource : public JournalSource {
+public:
+  ReplayJournalSource(const std::string &recordingPath, ReplayPacing pacing);
+
+  JournalRead Read(std::vector<char> &buffer) override;
+
+  [[nodiscard]] bool IsOpen() const { return m_valid; }
+
+private:
+  std::ifstream m_in;
+  ReplayPacing m_pacing;
+  bool m_valid = false;
+  std::chrono::steady_clock::time_point m_start;
+};
+
+struct SyntheticChurnOptions {
+  uint64_t seed = 1;
+  size_t directories = 1000;
+  size_t buffers = 1000;
+  size_t bufferSize = 65536;
+  // Lets a file's records straddle buffers, as a real journal read does, so
+  // a create and its delete can arrive in different batches.
+  bool splitSequences = false;
+};
+
+// Generates create/rename/delete churn with the cumulative reason flags a
+// real volume produces, against a fixed set of seeded directories.
+class SyntheticJournalSource : public JournalSource {
+public:
+  explicit SyntheticJournalSource(const SyntheticChurnOptions &options);
+
+  std::vector<Engine::FileEntry> InitialEntries() const;
+  // Files created and not deleted by the buffers read so far. With
+  // splitSequences this is exact only once Read has returned Finished.
+  [[nodiscard]] size_t LiveFileCount() const { return m_live.size(); }
+
+  JournalRead Read(std::vector<char> &buffer) override;
+
+private:
+  struct LiveFile {
+    unsigned long long frn;
+    unsigned long long parent;
+    std::u16string name;
+  };
+
+  std::u16string MakeName();
+  void AppendSequence(std::vector<char> &buffer);
+  void FillSplit(std::vector<char> &buffer);
+  void AppendCreate(std::vector<char> &buffer, bool deleteAfter);
+  void AppendRename(std::vector<char> &buffer);
+  void AppendDelete(std::vector<char> &buffer);
+  void Append(std::vector<char> &buffer, const LiveFile &file,
+              uint32_t reason);
+
+  SyntheticChurnOptions m_options;
+  std::mt19937_64 m_rng;
+  std::vector<LiveFile> m_live;
+  unsigned long long m_nextRecord;
+  long long m_usn = 0;
+  size_t m_buffersProduced = 0;
+  // Records generated but not yet read, for splitSequences.
+  std::vector<char> m_carry;
+  size_t m_carryOffset = 0;
+};
+
+} // namespace PulseFS::Core
@@ -0,0 +1,91 @@
+#pragma once
+
+#include "PulseFS/Core/LinuxScanner.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PulseFS::Core {
+
+struct LinuxMetadataOptions {
+  bool useIoUring = true;
+  unsigned queueDepth = 256;
+  // Worker count for the thread-pool fallback; 0 picks the core count.
+  size_t threads = 0;
+  // Results applied to the index per batch.
+  size_t flushSize = 4096;
+};
+
+// Fills size and modification time for entries a name-only scan inserted.
+// statx requests are issued through io_uring, up to queueDepth in flight,
+// or on a thread pool when io_uring is unavailable. Results are applied in
+// batches so the columns fill in while the stage runs.
+//
+//   LinuxMetadataCollector metadata(index);
+//   options.onListed = metadata.ListingObserver();
+//   LinuxScanner::Enumerate(index, root, options);
+//   metadata.Start();
+class LinuxMetadataCollector {
+public:
+  enum class Backend { IoUring, ThreadPool };
+
+  explicit LinuxMetadataCollector(Engine::SearchIndex &index,
+                                  const LinuxMetadataOptions &options = {});
+  ~LinuxMetadataCollector();
+
+  LinuxMetadataCollector(const LinuxMetadataCollector &) = delete;
+  LinuxMetadataCollector &operator=(const LinuxMetadataCollector &) = delete;
+
+  [[nodiscard]] decltype(LinuxScanOptions::onListed) ListingObserver();
+
+  void Enqueue(std::string directoryPath,
+               std::vector<LinuxStatTarget> targets);
+
+  // Starts working through the queue. Call once the scan has applied its
+  // names; results for ids the index does not know yet are dropped.
+  void Start();
+
+  // Waits until everything queued so far has been applied, then rethrows
+  // what stopped the stage early, if anything did.
+  void Wait();
+
+  void Stop();
+
+  [[nodiscard]] Backend ActiveBackend() const { return m_backend; }
+  [[nodiscard]] size_t Completed() const { return m_completed; }
+
+private:
+  struct DirectoryJob {
+    std::string path;
+    std::vector<LinuxStatTarget> targets;
+  };
+
+  bool PopJob(DirectoryJob &job, bool block);
+  void RunIoUring();
+  void RunThreadPool();
+  void Flush(std::vector<Engine::IndexChange> &results, bool force);
+
+  Engine::SearchIndex &m_index;
+  LinuxMetadataOptions m_options;
+  Backend m_backend = Backend::ThreadPool;
+
+  std::mutex m_queueMutex;
+  std::condition_variable m_queueChanged;
+  std::deque<DirectoryJob> m_queue;
+  bool m_draining = false;
+
+  std::atomic<bool> m_running = false;
+  std::atomic<size_t> m_completed = 0;
+  std::thread m_thread;
+  // Set by m_thread; read once it is joined.
+  std::exception_ptr m_error;
+};
+
+} // namespace PulseFS::Core
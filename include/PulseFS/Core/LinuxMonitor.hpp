@@ -0,0 +1,124 @@
+#pragma once
+
+#include "PulseFS/Core/LinuxScanner.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Utils/WorkStealingPool.hpp"
+#include <atomic>
+#include <chrono>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace PulseFS::Core {
+
+struct LinuxMonitorStats {
+  unsigned long long events = 0;
+  unsigned long long batches = 0;
+  unsigned long long overflows = 0;
+  unsigned long long rescannedDirectories = 0;
+  // From poll returning with events to the index holding them. Neither
+  // fanotify nor inotify stamps its events, so time spent queued in the
+  // kernel before that is not counted.
+  double lastApplyLatencyUs = 0.0;
+  double maxApplyLatencyUs = 0.0;
+};
+
+// Keeps an index built by LinuxScanner in sync with live changes, using
+// fanotify (FAN_REPORT_DFID_NAME) when permitted and inotify otherwise.
+//
+//   LinuxMonitor monitor(index);
+//   monitor.Open(root);
+//   LinuxScanOptions options;
+//   options.onDirectory = monitor.DirectoryObserver();
+//   LinuxScanner::Enumerate(index, root, options);
+//   monitor.Start();
+class LinuxMonitor {
+public:
+  enum class Backend { None, Fanotify, Inotify };
+
+  explicit LinuxMonitor(Engine::SearchIndex &index);
+  ~LinuxMonitor();
+
+  LinuxMonitor(const LinuxMonitor &) = delete;
+  LinuxMonitor &operator=(const LinuxMonitor &) = delete;
+
+  // Sets up notification before the scan so no change falls in between.
+  bool Open(const std::string &rootPath);
+
+  [[nodiscard]] decltype(LinuxScanOptions::onDirectory) DirectoryObserver();
+
+  void Start();
+  void Stop();
+
+  [[nodiscard]] Backend ActiveBackend() const { return m_backend; }
+  [[nodiscard]] LinuxMonitorStats GetStats() const;
+
+private:
+  enum class EventKind { Create, Delete, MovedFrom, MovedTo };
+
+  struct ObservedEvent {
+    EventKind kind;
+    unsigned long long directoryId;
+    std::string name;
+    bool isDirectory;
+    bool exists = false;
+    struct stat st {};
+  };
+
+  struct DirectoryState {
+    struct timespec mtime {};
+    int watch = -1;
+  };
+
+  void ObserveDirectory(const std::string &path, unsigned long long id,
+                        const struct stat &st);
+  bool IsTracked(unsigned long long directoryId);
+  std::string DirectoryPath(unsigned long long directoryId) const;
+
+  void MonitorLoop();
+  void ReadFanotify(std::vector<ObservedEvent> &events);
+  void ReadInotify(std::vector<ObservedEvent> &events);
+  void ApplyEvents(std::vector<ObservedEvent> &events);
+  // Removes what the index holds below `id`, except entries `changeById`
+  // already has a change for.
+  void RemoveSubtree(
+      unsigned long long id, std::vector<Engine::IndexChange> &changes,
+      const std::unordered_map<unsigned long long, size_t> &changeById);
+  void ScanNewDirectory(unsigned long long id);
+  void RescanChangedDirectories();
+  void RescanDirectory(unsigned long long id, const std::string &path);
+  void RecordApplyLatency(std::chrono::steady_clock::time_point polledAt);
+
+  Engine::SearchIndex &m_index;
+  Backend m_backend = Backend::None;
+  int m_notifyFd = -1;
+  int m_rootFd = -1;
+  std::string m_rootPath;
+  bool m_overflowed = false;
+  std::unordered_set<unsigned long long> m_dirtyDirectories;
+
+  std::mutex m_directoryMutex;
+  std::unordered_map<unsigned long long, DirectoryState> m_directories;
+  std::unordered_map<int, unsigned long long> m_watches;
+
+  std::atomic<bool> m_running = false;
+  std::thread m_thread;
+  // Walks directories created while monitoring; made on first use, then
+  // kept so each new directory does not start a thread.
+  std::unique_ptr<Utils::WorkStealingPool> m_scanPool;
+
+  std::atomic<unsigned long long> m_events = 0;
+  std::atomic<unsigned long long> m_batches = 0;
+  std::atomic<unsigned long long> m_overflows = 0;
+  std::atomic<unsigned long long> m_rescannedDirectories = 0;
+  std::atomic<double> m_lastApplyLatencyUs = 0.0;
+  std::atomic<double> m_maxApplyLatencyUs = 0.0;
+};
+
+} // namespace PulseFS::Core
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "PulseFS/Core/ScanPublisher.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Utils/WorkStealingPool.hpp"
+#include <cstddef>
+#include <functional>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+namespace PulseFS::Core {
+
+struct LinuxStatTarget {
+  unsigned long long id;
+  std::string name;
+};
+
+struct LinuxScanOptions {
+  size_t threads = 0;
+  // Walk on this pool instead of one of `threads` workers made for the walk.
+  // Nothing else may submit to it until the walk returns.
+  Utils::WorkStealingPool *pool = nullptr;
+  bool stayOnFileSystem = true;
+  // Entries are published to the index in batches of this size, or sooner
+  // once ScanPublisher's interval has passed.
+  size_t batchSize = 4096;
+  ScanProgress *progress = nullptr;
+
+  // Called from worker threads for every directory that is walked.
+  std::function<void(const std::string &path, unsigned long long id,
+                     const struct stat &st)>
+      onDirectory;
+
+  // Called from worker threads with the children of every listed directory,
+  // so a later stage (LinuxMetadataCollector) can stat them.
+  std::function<void(const std::string &path,
+                     std::vector<LinuxStatTarget> children)>
+      onListed;
+};
+
+// Walks a directory tree with openat/getdents64 on a work-stealing pool.
+// Entries are keyed by inode number, so hard links collapse to one entry.
+// The tree can be searched while the walk runs; see ScanPublisher.
+class LinuxScanner {
+public:
+  static size_t Enumerate(Engine::SearchIndex &index,
+                          const std::string &rootPath,
+                          const LinuxScanOptions &options = {});
+
+  // Inserts everything below an already indexed directory.
+  static size_t ScanSubtree(Engine::SearchIndex &index,
+                            const std::string &directoryPath,
+                            unsigned long long directoryId,
+                            const LinuxScanOptions &options = {});
+
+  static unsigned long AttributesFromMode(const char *name, mode_t mode);
+
+  // Lists the direct children of a directory without touching the index.
+  static std::vector<Engine::FileEntry>
+  ListDirectory(const std::string &directoryPath,
+                unsigned long long directoryId);
+};
+
+} // namespace PulseFS::Core
@@ -1,14 +1,31 @@
 #pragma once
 
+#include "PulseFS/Core/ScanPublisher.hpp"
 #include "PulseFS/Engine/SearchIndex.hpp"
+#include <cstddef>
 #include <string>
 
 namespace PulseFS::Core {
 
 class MftScanner {
 public:
+  // Reads the MFT on `threads` threads (0 picks one per core, fewer on a
+  // small volume), each over its own range of records. The index can be
+  // searched while this runs; see ScanPublisher. Returns the journal's next
+  // USN, where monitoring should start.
   static long long Enumerate(Engine::SearchIndex &index,
-                             const std::wstring &volumePath);
+                             const std::wstring &volumePath,
+                             ScanProgress *progress = nullptr,
+                             size_t threads = 0);
+
+  // FSCTL_ENUM_USN_DATA carries no sizes or times, so this fills them in
+  // after Enumerate: it lists every directory below the index's root by file
+  // reference, on `threads` threads (0 picks one per core), and applies a
+  // SetMetadata for each entry. Directories that cannot be opened are
+  // skipped. Returns how many entries were updated.
+  static size_t CollectMetadata(Engine::SearchIndex &index,
+                                const std::wstring &volumePath,
+                                size_t threads = 0);
 };
 
 } // namespace PulseFS::Core
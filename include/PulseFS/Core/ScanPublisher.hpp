@@ -0,0 +1,95 @@
+#pragma once
+
+#include "PulseFS/Engine/IdSlotMap.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+namespace PulseFS::Core {
+
+struct ScanStats {
+  size_t entriesFound = 0;
+  // Of those, how many a search can see.
+  size_t entriesPublished = 0;
+  size_t publications = 0;
+  double seconds = 0.0;
+  double entriesPerSecond = 0.0;
+  bool finished = false;
+};
+
+// Written by a scan's threads, read by whoever shows its progress.
+class ScanProgress {
+public:
+  void Start();
+  void Found(size_t entries);
+  void Published(size_t entries);
+  void Finish();
+
+  // Lock-free; safe to poll from the UI thread.
+  [[nodiscard]] ScanStats GetStats() const;
+
+private:
+  std::atomic<size_t> m_found = 0;
+  std::atomic<size_t> m_published = 0;
+  std::atomic<size_t> m_publications = 0;
+  // steady_clock nanoseconds; m_finishNs stays 0 while running.
+  std::atomic<long long> m_startNs = 0;
+  std::atomic<long long> m_finishNs = 0;
+};
+
+// Feeds a scan into a live index a step at a time, so it can be searched
+// long before the scan ends. Each scanning thread fills its own batch
+// without locking. A batch is published with one ApplyBatch once it is full
+// or the interval has passed, and every step is consistent: an entry is held
+// back until its parent is in the index, so each path a search returns
+// resolves up to the root.
+class ScanPublisher {
+public:
+  ScanPublisher(Engine::SearchIndex &index, size_t workers,
+                ScanProgress *progress = nullptr, size_t batchSize = 4096,
+                std::chrono::milliseconds interval =
+                    std::chrono::milliseconds(250));
+
+  ScanPublisher(const ScanPublisher &) = delete;
+  ScanPublisher &operator=(const ScanPublisher &) = delete;
+
+  // Only `worker`'s own thread may add to or poll its batch.
+  void Add(size_t worker, Engine::FileEntry entry);
+  // Publishes `worker`'s batch if it is full or due.
+  void Poll(size_t worker);
+  // Publishes every batch, then whatever is still held back: entries whose
+  // parent never turned up are published as orphans.
+  void Finish();
+
+private:
+  struct Worker {
+    std::vector<Engine::FileEntry> batch;
+    std::chrono::steady_clock::time_point lastPublish;
+  };
+
+  void PublishLocked(Worker &worker);
+  void AdmitLocked(Engine::FileEntry entry);
+  bool IsPublishedLocked(unsigned long long id);
+  void ApplyLocked();
+
+  Engine::SearchIndex &m_index;
+  ScanProgress *m_progress;
+  size_t m_batchSize;
+  std::chrono::milliseconds m_interval;
+  std::vector<Worker> m_workers;
+
+  std::mutex m_mutex;
+  // Ids this scan has published; slots are unused.
+  Engine::IdSlotMap m_published;
+  // Entries waiting for their parent, by parent id.
+  std::unordered_map<unsigned long long, std::vector<Engine::FileEntry>>
+      m_waiting;
+  std::vector<Engine::FileEntry> m_released;
+  std::vector<Engine::IndexChange> m_changes;
+};
+
+} // namespace PulseFS::Core
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include <cstddef>
+#include <unordered_map>
+#include <vector>
+
+namespace PulseFS::Core {
+
+// Decodes USN_RECORD_V2 entries and coalesces them per FRN so that a batch
+// only carries the net effect of every file it touched.
+class UsnBatchDecoder {
+public:
+  // Decodes the records of a FSCTL_READ_USN_JOURNAL / FSCTL_ENUM_USN_DATA
+  // buffer, without its leading 8-byte USN/FRN header.
+  void Decode(const char *records, size_t length);
+
+  // `written`, if given, receives the files in the batch that were created
+  // or had their data changed and still exist: the journal carries no sizes
+  // or times, so the caller has to read them.
+  std::vector<Engine::IndexChange>
+  TakeBatch(std::vector<unsigned long long> *written = nullptr);
+
+  [[nodiscard]] size_t RecordCount() const { return m_recordCount; }
+  // Newest record TimeStamp (FILETIME) decoded so far; 0 before any record.
+  [[nodiscard]] long long NewestTimeStamp() const { return m_newestTimeStamp; }
+
+private:
+  struct PendingChange {
+    Engine::FileEntry state;
+    bool hasState = false;
+    bool created = false;
+    bool deleted = false;
+    bool renamed = false;
+    bool attributesChanged = false;
+    bool dataChanged = false;
+  };
+
+  std::vector<PendingChange> m_pending;
+  std::unordered_map<unsigned long long, size_t> m_pendingByFrn;
+  size_t m_recordCount = 0;
+  long long m_newestTimeStamp = 0;
+};
+
+} // namespace PulseFS::Core
@@ -1,25 +1,64 @@
 #pragma once
 
+#include "PulseFS/Core/JournalSource.hpp"
 #include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Utils/Metrics.hpp"
 #include <atomic>
+#include <memory>
 #include <string>
 #include <thread>
 
 namespace PulseFS::Core {
 
+struct JournalStats {
+  unsigned long long recordsDecoded = 0;
+  unsigned long long changesApplied = 0;
+  // Records per second over the last completed one-second window.
+  double eventsPerSecond = 0.0;
+  // Bytes of journal written but not yet read; -1 if the source has no head.
+  long long lagBytes = -1;
+  // Age of the newest applied record when it was applied; 0 once caught up.
+  double lagSeconds = 0.0;
+  Utils::HistogramSnapshot applyLatencyNs;
+};
+
 class UsnMonitor {
 public:
   explicit UsnMonitor(Engine::SearchIndex &index);
   ~UsnMonitor();
 
+#ifdef _WIN32
   void Start(const std::wstring &volumePath, long long startUsn);
+#endif
+  void Start(std::unique_ptr<JournalSource> source);
   void Stop();
 
+  // Blocks until the source reports Finished or Stop() is called.
+  void Wait();
+
+  [[nodiscard]] unsigned long long RecordsDecoded() const {
+    return m_recordsDecoded;
+  }
+  [[nodiscard]] unsigned long long ChangesApplied() const {
+    return m_changesApplied;
+  }
+
+  // Lock-free; safe to poll from the UI thread.
+  [[nodiscard]] JournalStats GetStats() const;
+
 private:
-  void MonitorLoop(std::wstring volumePath, long long startUsn);
+  void MonitorLoop(std::unique_ptr<JournalSource> source);
+  void UpdateLag(JournalSource &source, long long readUsn,
+                 long long newestTimeStamp);
 
   Engine::SearchIndex &m_index;
   std::atomic<bool> m_running;
+  std::atomic<unsigned long long> m_recordsDecoded = 0;
+  std::atomic<unsigned long long> m_changesApplied = 0;
+  std::atomic<double> m_eventsPerSecond = 0.0;
+  std::atomic<long long> m_lagBytes = -1;
+  std::atomic<double> m_lagSeconds = 0.0;
+  Utils::Histogram m_applyLatency;
   std::thread m_thread;
 };
 
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace PulseFS::Core::Usn {
+
+// Mirrors USN_RECORD_V2 so journal buffers can be decoded without <windows.h>.
+struct RecordV2 {
+  uint32_t RecordLength;
+  uint16_t MajorVersion;
+  uint16_t MinorVersion;
+  uint64_t FileReferenceNumber;
+  uint64_t ParentFileReferenceNumber;
+  int64_t Usn;
+  int64_t TimeStamp;
+  uint32_t Reason;
+  uint32_t SourceInfo;
+  uint32_t SecurityId;
+  uint32_t FileAttributes;
+  uint16_t FileNameLength;
+  uint16_t FileNameOffset;
+};
+
+inline constexpr size_t kRecordV2HeaderSize = 60;
+static_assert(offsetof(RecordV2, FileNameOffset) + sizeof(uint16_t) ==
+              kRecordV2HeaderSize);
+
+inline constexpr uint32_t kReasonDataOverwrite = 0x00000001;
+inline constexpr uint32_t kReasonDataExtend = 0x00000002;
+inline constexpr uint32_t kReasonDataTruncation = 0x00000004;
+inline constexpr uint32_t kReasonFileCreate = 0x00000100;
+inline constexpr uint32_t kReasonFileDelete = 0x00000200;
+inline constexpr uint32_t kReasonRenameOldName = 0x00001000;
+inline constexpr uint32_t kReasonRenameNewName = 0x00002000;
+inline constexpr uint32_t kReasonBasicInfoChange = 0x00008000;
+inline constexpr uint32_t kReasonClose = 0x80000000;
+
+// Appends a USN_RECORD_V2 with an 8-byte aligned length, as the kernel does.
+inline void AppendRecordV2(std::vector<char> &buffer, RecordV2 record,
+                           const std::u16string &name) {
+  record.MajorVersion = 2;
+  record.MinorVersion = 0;
+  record.FileNameOffset = static_cast<uint16_t>(kRecordV2HeaderSize);
+  record.FileNameLength =
+      static_cast<uint16_t>(name.size() * sizeof(char16_t));
+  record.RecordLength = static_cast<uint32_t>(
+      (kRecordV2HeaderSize + record.FileNameLength + 7) & ~size_t(7));
+
+  const size_t offset = buffer.size();
+  buffer.resize(offset + record.RecordLength, 0);
+  std::memcpy(&buffer[offset], &record, kRecordV2HeaderSize);
+  std::memcpy(&buffer[offset + kRecordV2HeaderSize], name.data(),
+              record.FileNameLength);
+}
+
+} // namespace PulseFS::Core::Usn
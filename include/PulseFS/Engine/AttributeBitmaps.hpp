@@ -0,0 +1,86 @@
+#pragma once
+
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace PulseFS::Engine {
+
+// Entries must carry every attribute in `require` and none in `exclude`,
+// e.g. {kAttributeDirectory, 0} for folders only.
+struct AttributeFilter {
+  unsigned long require = 0;
+  unsigned long exclude = 0;
+
+  [[nodiscard]] bool Empty() const { return require == 0 && exclude == 0; }
+  [[nodiscard]] bool Matches(unsigned long attributes) const {
+    return (attributes & require) == require && (attributes & exclude) == 0;
+  }
+  bool operator==(const AttributeFilter &) const = default;
+};
+
+// One bit per index slot, in chunks of kChunkSlots. A chunk with no bits set
+// holds no storage, so attributes that few entries carry cost almost
+// nothing and a scan skips the empty stretches 64 slots at a time.
+class SlotBitmap {
+public:
+  static constexpr size_t kChunkWords = 64;
+  static constexpr size_t kChunkSlots = kChunkWords * 64;
+
+  void Set(size_t slot);
+  void Reset(size_t slot);
+  void Clear();
+
+  // Slots word * 64 .. word * 64 + 63; zero past the end.
+  [[nodiscard]] uint64_t Word(size_t word) const {
+    const size_t chunk = word / kChunkWords;
+    if (chunk >= m_chunks.size() || !m_chunks[chunk])
+      return 0;
+    return m_chunks[chunk]->words[word % kChunkWords];
+  }
+
+  [[nodiscard]] size_t MemoryUsage() const;
+
+private:
+  struct Chunk {
+    std::array<uint64_t, kChunkWords> words{};
+    size_t count = 0;
+  };
+
+  std::vector<std::unique_ptr<Chunk>> m_chunks;
+  size_t m_allocated = 0;
+};
+
+// A SlotBitmap per attribute in kIndexedAttributes, kept in step with the
+// entry array so that attribute filters are answered a word of slots at a
+// time instead of by reading each entry.
+class AttributeBitmaps {
+public:
+  static constexpr std::array<unsigned long, 7> kIndexedAttributes = {
+      kAttributeReadOnly,     kAttributeHidden,    kAttributeSystem,
+      kAttributeDirectory,    kAttributeArchive,   kAttributeReparsePoint,
+      kAttributeCompressed};
+
+  // Records that `slot` went from `before` to `after`; zero for a slot that
+  // is empty or no longer live.
+  void Update(size_t slot, unsigned long before, unsigned long after);
+  void Clear();
+
+  // Bit i is set when slot word * 64 + i passes the indexed part of
+  // `filter`. Slots past the end of the entry array may be set too.
+  [[nodiscard]] uint64_t Candidates(size_t word,
+                                    const AttributeFilter &filter) const;
+
+  // The bits of `filter` that have no bitmap and must be checked per entry.
+  [[nodiscard]] static AttributeFilter Unindexed(const AttributeFilter &filter);
+
+  [[nodiscard]] size_t MemoryUsage() const;
+
+private:
+  std::array<SlotBitmap, kIndexedAttributes.size()> m_bitmaps;
+};
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,75 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+namespace PulseFS::Engine {
+
+// Child lists for the SearchIndex, by entry slot. Most of them live in one
+// CSR layout built in a single pass over the entries: the children of the
+// entry in slot p are m_children[m_offsets[p], m_offsets[p + 1]), in slot
+// order. Writes after the build are not merged into it:
+//  - slots added since, and built slots that moved under another parent, go
+//    into a small list kept for their parent;
+//  - built slots that moved away or were removed stay where they were built,
+//    so every candidate must be checked against the entry's current parent.
+// Drift() counts those changes; the owner rebuilds once they add up.
+class ChildIndex {
+public:
+  static constexpr uint32_t kNoSlot = ~uint32_t(0);
+
+  struct Orphan {
+    uint32_t slot;
+    unsigned long long parentId;
+  };
+
+  // parentSlots[s] is the slot of s's parent, or kNoSlot for an inactive
+  // slot, a root, or an orphan. Orphans, whose parent is not indexed yet,
+  // are listed under the parent's id instead.
+  void Rebuild(const std::vector<uint32_t> &parentSlots,
+               const std::vector<Orphan> &orphans);
+  void Clear();
+
+  // A new slot under `parentId`.
+  void Added(uint32_t slot, unsigned long long parentId);
+  // `slot` moved from `oldParentId` to `parentId`, found in `parentSlot` or
+  // kNoSlot if it is not indexed.
+  void Moved(uint32_t slot, unsigned long long oldParentId,
+             unsigned long long parentId, uint32_t parentSlot);
+  // `slot`, holding `id` under `parentId`, left the index.
+  void Retired(uint32_t slot, unsigned long long id,
+               unsigned long long parentId);
+
+  // Appends the slots that may be children of `parentId`, which is in
+  // `parentSlot` (or kNoSlot).
+  void Candidates(unsigned long long parentId, uint32_t parentSlot,
+                  std::vector<uint32_t> &slots) const;
+
+  [[nodiscard]] size_t BaseSlots() const { return m_baseSlots; }
+  [[nodiscard]] size_t Drift() const { return m_drift; }
+  [[nodiscard]] size_t MemoryUsage() const;
+
+private:
+  [[nodiscard]] std::span<const uint32_t> Built(uint32_t parentSlot) const;
+  void Link(uint32_t slot, unsigned long long parentId);
+  void Unlink(uint32_t slot, unsigned long long parentId);
+
+  std::vector<uint32_t> m_offsets;
+  std::vector<uint32_t> m_children;
+  size_t m_baseSlots = 0;
+  // Slots listed under a parent other than their built one, by parent id.
+  std::unordered_map<unsigned long long, std::vector<uint32_t>> m_moved;
+  unsigned long long m_lastParent = 0;
+  std::vector<uint32_t> *m_lastList = nullptr;
+  // Each slot's position in its m_moved list, or kNoSlot, for O(1) removal.
+  std::vector<uint32_t> m_positions;
+  // Directories that left the index while still holding built children,
+  // so an id that comes back in a new slot finds them.
+  std::unordered_map<unsigned long long, uint32_t> m_retired;
+  size_t m_drift = 0;
+};
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,90 @@
+#pragma once
+
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Engine/StandingQuery.hpp"
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PulseFS::Engine {
+
+enum class RowKind : uint8_t {
+  File,
+  Directory,
+  Image,
+};
+
+// Everything the results table draws for one entry, resolved up front.
+struct DisplayRow {
+  unsigned long long id = 0;
+  RowKind kind = RowKind::File;
+  // Native path, for shell calls.
+  std::wstring path;
+  // Shared by every file whose icon depends only on its extension.
+  std::wstring iconKey;
+  std::string pathUtf8;
+  size_t nameOffset = 0;
+  // For a directory, the bytes at any depth below it, once totaled.
+  unsigned long long size = 0;
+  bool sizeKnown = false;
+  long long lastWriteTime = 0;
+  std::string sizeText;
+  std::string timeText;
+
+  [[nodiscard]] const char *Name() const {
+    return pathUtf8.c_str() + nameOffset;
+  }
+};
+
+// The results table as rows ready to draw: directories first, then files, in
+// result order. Rebuild resolves a whole result set; Apply folds in a
+// standing-query delta and only resolves the rows that were added or changed.
+// Both, like RefreshMetadata, are meant for the search thread: SearchPanel
+// updates a copy there and only swaps the pointer on the UI thread.
+class DisplayModel {
+public:
+  using TimeFormatter = std::string (*)(long long fileTime);
+
+  explicit DisplayModel(TimeFormatter formatTime = nullptr)
+      : m_formatTime(formatTime) {}
+
+  void Rebuild(const SearchIndex &index,
+               const std::vector<unsigned long long> &ids);
+  void Apply(const SearchIndex &index, const ResultDelta &delta,
+             size_t maxRows);
+  // Directories first, then files, each by name ignoring case. For folder
+  // listings, whose order carries no meaning.
+  void SortByName();
+
+  // Re-reads size and modification time, which arrive after names and
+  // change without touching the result set, as do directory totals. Returns
+  // whether any row changed.
+  bool RefreshMetadata(const SearchIndex &index);
+
+  [[nodiscard]] const std::vector<DisplayRow> &Rows() const { return m_rows; }
+  [[nodiscard]] size_t Size() const { return m_rows.size(); }
+
+  // Index generation the metadata was last read at.
+  [[nodiscard]] uint64_t MetadataGeneration() const {
+    return m_metadataGeneration;
+  }
+
+  // Files with embedded icons are keyed by path, the rest by extension.
+  static std::wstring IconKeyFor(std::wstring_view path, bool isDirectory);
+  static bool IsImageName(std::wstring_view name);
+  static std::string FormatSize(unsigned long long bytes);
+
+private:
+  bool Resolve(const SearchIndex &index, unsigned long long id,
+               DisplayRow &row) const;
+  static void ReadSize(const SearchIndex &index, DisplayRow &row);
+  void FormatMetadata(DisplayRow &row) const;
+
+  TimeFormatter m_formatTime;
+  std::vector<DisplayRow> m_rows;
+  uint64_t m_metadataGeneration = 0;
+};
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstdint>
+
+namespace PulseFS::Engine {
+
+// Win32 FILE_ATTRIBUTE_* values. Every backend reports attributes in this
+// encoding so the UI and filters stay platform-neutral.
+inline constexpr unsigned long kAttributeReadOnly = 0x00000001;
+inline constexpr unsigned long kAttributeHidden = 0x00000002;
+inline constexpr unsigned long kAttributeSystem = 0x00000004;
+inline constexpr unsigned long kAttributeDirectory = 0x00000010;
+inline constexpr unsigned long kAttributeArchive = 0x00000020;
+inline constexpr unsigned long kAttributeReparsePoint = 0x00000400;
+inline constexpr unsigned long kAttributeCompressed = 0x00000800;
+
+// Seconds between the FILETIME epoch (1601) and the Unix epoch (1970).
+inline constexpr int64_t kUnixEpochInFileTimeSeconds = 11644473600LL;
+
+inline constexpr long long FileTimeFromUnix(int64_t seconds,
+                                            uint32_t nanoseconds) {
+  return (seconds + kUnixEpochInFileTimeSeconds) * 10000000LL +
+         nanoseconds / 100;
+}
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace PulseFS::Engine {
+
+// NtfsFrn ids are a 48-bit MFT record number plus a 16-bit sequence number.
+// Opaque ids (inodes, synthetic ids) carry no sequence and are matched as-is.
+enum class IdScheme { NtfsFrn, Opaque };
+
+// Maps file ids to slots in the SearchIndex entry array. Dense record numbers
+// resolve with a single load from a direct-indexed table; ids that are too
+// sparse for the table go to an open-addressing fallback.
+class IdSlotMap {
+public:
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  explicit IdSlotMap(IdScheme scheme = IdScheme::NtfsFrn);
+
+  void SetScheme(IdScheme scheme);
+  [[nodiscard]] IdScheme Scheme() const noexcept { return m_scheme; }
+
+  void Reserve(size_t capacity);
+  void Clear();
+
+  [[nodiscard]] size_t Find(uint64_t id) const noexcept;
+
+  // Binds id to slot. Returns the slot that was bound to the same record under
+  // an older sequence number (now stale), or npos.
+  size_t Assign(uint64_t id, size_t slot);
+
+  bool Erase(uint64_t id) noexcept;
+
+  [[nodiscard]] size_t Size() const noexcept { return m_size; }
+  [[nodiscard]] size_t MemoryUsage() const noexcept;
+
+private:
+  struct HashCell {
+    uint64_t key;
+    uint64_t slot;
+  };
+
+  static constexpr uint64_t kRecordMask = 0x0000FFFFFFFFFFFFull;
+  static constexpr uint64_t kSlotMask = 0x0000FFFFFFFFFFFFull;
+  static constexpr uint64_t kEmptyKey = ~0ull;
+  static constexpr uint64_t kTombstoneKey = ~0ull - 1;
+  static constexpr size_t kMinDirectSpan = size_t(1) << 20;
+  static constexpr size_t kDirectDensity = 4;
+
+  [[nodiscard]] uint64_t RecordOf(uint64_t id) const noexcept {
+    return m_scheme == IdScheme::NtfsFrn ? (id & kRecordMask) : id;
+  }
+  [[nodiscard]] uint64_t SequenceOf(uint64_t id) const noexcept {
+    return m_scheme == IdScheme::NtfsFrn ? (id >> 48) : 0;
+  }
+
+  bool TryDirect(uint64_t record);
+
+  [[nodiscard]] size_t HashFind(uint64_t key) const noexcept;
+  void HashInsert(uint64_t key, uint64_t packed);
+  bool HashErase(uint64_t key) noexcept;
+  void HashRehash(size_t capacity);
+
+  IdScheme m_scheme;
+
+  // Each direct cell packs (sequence << 48) | (slot + 1); zero means empty.
+  std::vector<uint64_t> m_direct;
+
+  std::vector<HashCell> m_hash;
+  size_t m_hashUsed = 0;
+  size_t m_hashTombstones = 0;
+
+  size_t m_size = 0;
+};
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace PulseFS::Engine {
+
+// Interned file names. Every distinct name is stored once and shared by all
+// the entries that carry it (a developer volume has hundreds of thousands of
+// index.js and package.json); entries hold a NameId instead. Names are
+// reference counted, and an id whose last reference goes is reused.
+class NamePool {
+public:
+  using NameId = uint32_t;
+  static constexpr NameId kNone = ~NameId(0);
+
+  // Sizes the table for up to `names` distinct names without rehashing.
+  void Reserve(size_t names);
+
+  NameId Acquire(const std::wstring &name);
+  void Release(NameId id);
+
+  [[nodiscard]] std::optional<NameId> Find(const std::wstring &name) const;
+  [[nodiscard]] const std::wstring &Get(NameId id) const {
+    return *m_names[id].text;
+  }
+
+  // One past the largest id handed out, for tables indexed by NameId.
+  [[nodiscard]] size_t IdLimit() const { return m_names.size(); }
+  [[nodiscard]] size_t Size() const { return m_byName.size(); }
+  [[nodiscard]] size_t MemoryUsage() const;
+
+  void Clear();
+
+private:
+  struct Name {
+    // Points at the key in m_byName, whose nodes never move.
+    const std::wstring *text = nullptr;
+    uint32_t references = 0;
+  };
+
+  std::unordered_map<std::wstring, NameId> m_byName;
+  std::vector<Name> m_names;
+  std::vector<NameId> m_free;
+  size_t m_textBytes = 0;
+};
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+namespace PulseFS::Engine {
+
+// Small LRU of search results, each tagged with the SearchIndex::Generation()
+// it was computed at. A lookup only hits when the generation still matches,
+// so a write anywhere in the index invalidates every entry at once. Keys are
+// case-folded like Search itself. Not thread-safe; each searching thread owns
+// its cache.
+class QueryCache {
+public:
+  explicit QueryCache(size_t capacity = 32);
+
+  // A stored result can answer any request for up to as many results, or
+  // for any count when it already held every match.
+  std::optional<std::vector<unsigned long long>>
+  Find(std::wstring_view query, size_t maxResults, uint64_t generation);
+
+  void Store(std::wstring_view query, size_t maxResults, uint64_t generation,
+             std::vector<unsigned long long> results);
+
+  void Clear();
+
+  [[nodiscard]] unsigned long long Hits() const { return m_hits; }
+  [[nodiscard]] unsigned long long Misses() const { return m_misses; }
+
+private:
+  struct Entry {
+    std::wstring key;
+    size_t maxResults;
+    uint64_t generation;
+    std::vector<unsigned long long> results;
+  };
+
+  static std::wstring Fold(std::wstring_view query);
+
+  size_t m_capacity;
+  std::list<Entry> m_entries;
+  std::unordered_map<std::wstring, std::list<Entry>::iterator> m_byKey;
+  unsigned long long m_hits = 0;
+  unsigned long long m_misses = 0;
+};
+
+} // namespace PulseFS::Engine
@@ -1,10 +1,21 @@
 #pragma once
 
+#include "PulseFS/Engine/AttributeBitmaps.hpp"
+#include "PulseFS/Engine/ChildIndex.hpp"
+#include "PulseFS/Engine/IdSlotMap.hpp"
+#include "PulseFS/Engine/NamePool.hpp"
+#include "PulseFS/Engine/StandingQuery.hpp"
+#include "PulseFS/Utils/Metrics.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <mutex>
 #include <optional>
 #include <shared_mutex>
 #include <string>
 #include <string_view>
-#include <unordered_map>
+#include <utility>
 #include <vector>
 
 namespace PulseFS::Engine {
@@ -15,6 +26,72 @@ struct FileEntry {
   unsigned long long parentId;
   unsigned long fileAttributes = 0;
   bool active = true;
+  unsigned long long size = 0;
+  // FILETIME units (100 ns ticks since 1601); 0 until metadata is known.
+  long long lastWriteTime = 0;
+};
+
+enum class ChangeKind { Insert, Remove, Rename, SetAttributes, SetMetadata };
+
+struct IndexChange {
+  ChangeKind kind;
+  FileEntry entry;
+};
+
+struct SearchRequest {
+  std::wstring_view query;
+  size_t maxResults = 20;
+  // Checked periodically; a cancelled request stops collecting results.
+  const std::atomic<bool> *cancelled = nullptr;
+  AttributeFilter filter;
+};
+
+struct LockWaitStats {
+  unsigned long long exclusiveAcquisitions = 0;
+  unsigned long long exclusiveWaitNs = 0;
+  unsigned long long exclusiveMaxWaitNs = 0;
+  unsigned long long sharedAcquisitions = 0;
+  unsigned long long sharedWaitNs = 0;
+  unsigned long long sharedMaxWaitNs = 0;
+};
+
+// Query lengths are grouped as 1, 2, 3-4, 5-8 and 9+ characters; short
+// queries match most names and cost the most.
+inline constexpr size_t kQueryLengthClasses = 5;
+size_t QueryLengthClass(size_t length);
+const char *QueryLengthClassName(size_t lengthClass);
+
+struct IndexStats {
+  std::array<Utils::HistogramSnapshot, kQueryLengthClasses> queryLatencyNs;
+  unsigned long long entriesScanned = 0;
+  // Only populated while lock tracking is on.
+  Utils::HistogramSnapshot exclusiveWaitNs;
+  Utils::HistogramSnapshot sharedWaitNs;
+  size_t liveEntries = 0;
+  size_t distinctNames = 0;
+  size_t entryBytes = 0;
+  size_t nameBytes = 0;
+  size_t idMapBytes = 0;
+  size_t attributeBytes = 0;
+  size_t childBytes = 0;
+  size_t totalsBytes = 0;
+};
+
+// What a directory holds at any depth below it.
+struct FolderTotals {
+  unsigned long long bytes = 0;
+  uint32_t files = 0;
+  uint32_t folders = 0;
+};
+
+struct ChildKey {
+  unsigned long long parentId;
+  std::wstring name;
+};
+
+struct ResolvedEntry {
+  std::wstring path;
+  unsigned long attributes = 0;
 };
 
 class SearchIndex {
@@ -27,6 +104,11 @@ public:
 
   void Reserve(size_t capacity);
 
+  void SetIdScheme(IdScheme scheme);
+  IdScheme GetIdScheme() const;
+
+  void SetPathFormat(std::wstring rootPrefix, wchar_t separator);
+
   void Insert(const FileEntry &entry);
 
   void Remove(unsigned long long id);
@@ -34,21 +116,196 @@ public:
   void Rename(unsigned long long id, const std::wstring &newName,
               unsigned long long newParentId);
 
+  void ApplyBatch(const std::vector<IndexChange> &changes);
+
+  // Folder totals are kept current along the ancestor chain by every write.
+  // Between these calls they are not; the last EndBulkLoad computes them
+  // bottom-up in one pass and rebuilds the child index. Calls may nest.
+  void BeginBulkLoad();
+  void EndBulkLoad();
+
+  // Entries the filter rules out are skipped a word of the attribute
+  // bitmaps at a time, before their names are read.
   std::vector<unsigned long long> Search(std::wstring_view query,
-                                         size_t maxResults = 20) const;
+                                         size_t maxResults = 20,
+                                         AttributeFilter filter = {}) const;
+
+  // Answers several queries in a single pass over the entries, lowering
+  // each name once for all of them.
+  std::vector<std::vector<unsigned long long>>
+  SearchMany(const std::vector<SearchRequest> &requests) const;
+
+  // Registers a standing query and fills `results` with its current
+  // matches, as Search would. If `results` already holds the answer computed
+  // at `knownGeneration` and the index has not changed since, no scan runs.
+  // From then on every write that changes the match set queues a delta on
+  // the returned object until Unsubscribe. If `cancelled` is set before
+  // registration, the scan stops early and nothing is registered: the result
+  // is null and `results` is empty.
+  std::shared_ptr<StandingQuery>
+  Subscribe(std::wstring_view query, size_t maxResults,
+            std::vector<unsigned long long> &results,
+            std::optional<uint64_t> knownGeneration = std::nullopt,
+            AttributeFilter filter = {},
+            const std::atomic<bool> *cancelled = nullptr);
+
+  void Unsubscribe(const std::shared_ptr<StandingQuery> &standing);
 
   std::wstring GetFullPath(unsigned long long id) const;
 
   unsigned long GetAttributes(unsigned long long id) const;
 
+  // Path and attributes of each id under one shared lock; an id not in the
+  // index gets an empty path.
+  std::vector<ResolvedEntry>
+  Resolve(const std::vector<unsigned long long> &ids) const;
+
+  unsigned long long GetSize(unsigned long long id) const;
+
+  long long GetLastWriteTime(unsigned long long id) const;
+
+  bool Contains(unsigned long long id) const;
+
+  // Children come from the child index, so listing a directory costs its
+  // number of children rather than the size of the index.
+  std::vector<FileEntry> GetChildren(unsigned long long parentId) const;
+  std::vector<unsigned long long>
+  GetChildIds(unsigned long long parentId) const;
+
+  // Entries that are their own parent, such as a volume's root directory.
+  std::vector<unsigned long long> GetRootIds() const;
+
+  // Recursive totals below a directory; nullopt for an id not in the index
+  // or during a bulk load.
+  std::optional<FolderTotals> GetFolderTotals(unsigned long long id) const;
+
+  // The `count` folders at any depth below `id` that hold the most bytes,
+  // largest first. Walks down from `id` only as far as the answer needs.
+  std::vector<std::pair<unsigned long long, FolderTotals>>
+  LargestFolders(unsigned long long id, size_t count) const;
+
+  // Resolves (parent, name) pairs to ids by listing each parent once.
+  std::vector<std::optional<unsigned long long>>
+  FindChildren(const std::vector<ChildKey> &keys) const;
+
   size_t Count() const;
 
+  // Bumped by every write that can change search results. Equal values mean
+  // a query would return the same ids; reading it takes no lock.
+  uint64_t Generation() const {
+    return m_generation.load(std::memory_order_acquire);
+  }
+
+  // Heap bytes held by the entry array, names, id map, attribute bitmaps,
+  // child index and folder totals.
+  size_t MemoryUsage() const;
+
+  // Off by default; when on, every lock acquisition is timed.
+  void SetLockTracking(bool enabled);
+  LockWaitStats GetLockWaitStats() const;
+
+  // Reads only atomics, so it can be polled without the index lock.
+  IndexStats GetStats() const;
+
+  // Binary snapshot of every live entry plus the id scheme and path format.
+  // Names are stored as UTF-16 so snapshots move between platforms.
+  bool SaveSnapshot(const std::string &path) const;
+  // Returns false, leaving the index as it was, for a missing, truncated or
+  // corrupt file.
+  bool LoadSnapshot(const std::string &path);
+
 private:
+  // Published by every writer before it releases the lock.
+  struct Gauges {
+    std::atomic<size_t> liveEntries = 0;
+    std::atomic<size_t> distinctNames = 0;
+    std::atomic<size_t> entryBytes = 0;
+    std::atomic<size_t> nameBytes = 0;
+    std::atomic<size_t> idMapBytes = 0;
+    std::atomic<size_t> attributeBytes = 0;
+    std::atomic<size_t> childBytes = 0;
+    std::atomic<size_t> totalsBytes = 0;
+  };
+
+  // A FileEntry as held in the index, with its name interned in m_names.
+  struct StoredEntry {
+    unsigned long long id;
+    unsigned long long parentId;
+    unsigned long long size;
+    long long lastWriteTime;
+    unsigned long fileAttributes;
+    NamePool::NameId name;
+    bool active;
+  };
+
+  FileEntry LoadEntry(const StoredEntry &file) const;
+
+  std::unique_lock<std::shared_mutex> LockExclusive() const;
+  std::shared_lock<std::shared_mutex> LockShared() const;
+
   std::wstring ResolvePathInternal(unsigned long long id) const;
+  void InsertLocked(const FileEntry &entry);
+  void RemoveLocked(unsigned long long id);
+  void RenameLocked(unsigned long long id, const std::wstring &newName,
+                    unsigned long long newParentId);
+  void PublishGaugesLocked();
+  // Rebuilds the child index once the writes since its last build would
+  // make listing noticeably slower. Called at the end of every write.
+  void MaintainChildrenLocked();
+  // Returns each slot's parent slot, as ChildIndex::Rebuild takes them.
+  std::vector<uint32_t> RebuildChildrenLocked();
+  void ChildSlotsLocked(unsigned long long parentId,
+                        std::vector<uint32_t> &slots) const;
+  // An entry's weight in its ancestors' totals: itself plus, for a
+  // directory, everything below it.
+  FolderTotals ContributionLocked(size_t slot) const;
+  void AddToAncestorsLocked(unsigned long long parentId,
+                            const FolderTotals &delta, bool subtract);
+  // Moves `slot`'s contribution, which was `before` under `oldParentId`, to
+  // what it is now. Writers take `before` ahead of changing the entry.
+  void RetotalLocked(size_t slot, unsigned long long oldParentId,
+                     const FolderTotals &before);
+  void RecomputeTotalsLocked(const std::vector<uint32_t> &parentSlots);
+  std::vector<unsigned long long> SearchLocked(std::wstring_view query,
+                                               size_t maxResults,
+                                               const AttributeFilter &filter,
+                                               const std::atomic<bool> *cancelled,
+                                               size_t &scanned) const;
+  // How an entry that stays in the index changed, as far as a row showing it
+  // is concerned.
+  enum class EntryChange { None, Attributes, Moved };
+  // file is null when the id left the index.
+  void NoteChangeLocked(unsigned long long id, const StoredEntry *file,
+                        EntryChange change = EntryChange::None);
+  void ResyncStandingLocked();
+  void RecordQuery(size_t queryLength,
+                   std::chrono::steady_clock::time_point start,
+                   size_t scanned) const;
 
-  std::vector<FileEntry> m_files;
-  std::unordered_map<unsigned long long, size_t> m_idToIndex;
+  std::vector<StoredEntry> m_files;
+  NamePool m_names;
+  IdSlotMap m_idToIndex;
+  // Indexed by slot in m_files, like m_idToIndex's values.
+  AttributeBitmaps m_attributes;
+  ChildIndex m_children;
+  // Parallel to m_files: what each directory holds below it.
+  std::vector<FolderTotals> m_totals;
+  size_t m_bulkLoads = 0;
+  std::wstring m_rootPrefix = L"C:\\";
+  wchar_t m_separator = L'\\';
   mutable std::shared_mutex m_mutex;
+  std::atomic<bool> m_trackLockWaits = false;
+  mutable Utils::Histogram m_exclusiveWaits;
+  mutable Utils::Histogram m_sharedWaits;
+  mutable std::array<Utils::Histogram, kQueryLengthClasses> m_queryLatency;
+  mutable std::atomic<unsigned long long> m_entriesScanned = 0;
+  std::atomic<uint64_t> m_generation = 0;
+  // Written under the shared lock plus m_standingMutex, read by writers
+  // under the exclusive lock.
+  std::vector<std::shared_ptr<StandingQuery>> m_standing;
+  std::mutex m_standingMutex;
+  std::wstring m_foldedName;
+  Gauges m_gauges;
 };
 
 } // namespace PulseFS::Engine
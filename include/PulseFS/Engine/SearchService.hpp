@@ -0,0 +1,122 @@
+#pragma once
+
+#include "PulseFS/Engine/QueryCache.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Engine/StandingQuery.hpp"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace PulseFS::Engine {
+
+// Lanes are served strictly in this order.
+enum class SearchPriority : uint8_t {
+  Interactive,
+  Refresh,
+  Export,
+};
+
+inline constexpr size_t kSearchPriorityCount = 3;
+
+struct SearchJob {
+  std::wstring query;
+  size_t maxResults = 100;
+  AttributeFilter filter;
+  // Lists this directory's children instead of searching; query, filter and
+  // maxResults are ignored and nothing is cached or subscribed.
+  std::optional<unsigned long long> browseParent;
+  // Runs in place of a search, for work that should stay off the caller's
+  // thread but queue behind searches of its lane; everything else but the
+  // priority is ignored, and the outcome holds no ids.
+  std::function<void()> task;
+  SearchPriority priority = SearchPriority::Interactive;
+  // Register the query as a standing query and hand it back with the
+  // results, so the caller can follow changes from there.
+  bool subscribe = false;
+  // A newer superseding job in the same lane cancels this one, whether it is
+  // still queued or already scanning. Meant for search-as-you-type.
+  bool supersede = false;
+};
+
+struct SearchOutcome {
+  std::vector<unsigned long long> ids;
+  // Index generation read before the scan started.
+  uint64_t generation = 0;
+  // Set only for subscribe jobs that were not cancelled.
+  std::shared_ptr<StandingQuery> standing;
+  std::chrono::microseconds elapsed{0};
+  bool cancelled = false;
+};
+
+using SearchCallback = std::function<void(SearchOutcome)>;
+
+struct SearchServiceOptions {
+  size_t workers = 2;
+  // Results kept across jobs, keyed by query and tagged by generation.
+  size_t cacheCapacity = 32;
+};
+
+// Runs searches against a SearchIndex on a few worker threads that sleep on a
+// condition variable while idle. Interactive jobs always go first, and
+// background lanes may occupy at most workers - 1 threads, so a keystroke
+// never waits behind an export. Stop (or the destructor) joins the workers;
+// every job still queued then completes as cancelled, so no future is left
+// hanging.
+class SearchService {
+public:
+  explicit SearchService(SearchIndex &index,
+                         const SearchServiceOptions &options = {});
+  ~SearchService();
+
+  SearchService(const SearchService &) = delete;
+  SearchService &operator=(const SearchService &) = delete;
+
+  std::future<SearchOutcome> Submit(SearchJob job);
+
+  // The callback runs on a worker thread, or on the calling thread when the
+  // job is rejected or superseded before it starts.
+  void Submit(SearchJob job, SearchCallback callback);
+
+  void Stop();
+
+private:
+  struct Pending {
+    SearchJob job;
+    SearchCallback callback;
+    std::atomic<bool> cancelled = false;
+  };
+
+  void WorkerLoop();
+  std::shared_ptr<Pending> TakeLocked();
+  SearchOutcome Run(Pending &pending);
+  static void Cancel(Pending &pending);
+
+  SearchIndex &m_index;
+  size_t m_backgroundLimit;
+
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+  std::array<std::deque<std::shared_ptr<Pending>>, kSearchPriorityCount>
+      m_lanes;
+  std::vector<std::shared_ptr<Pending>> m_running;
+  size_t m_backgroundRunning = 0;
+  bool m_stopping = false;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_cacheMutex;
+  QueryCache m_cache;
+};
+
+} // namespace PulseFS::Engine
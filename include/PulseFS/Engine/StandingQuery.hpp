@@ -0,0 +1,79 @@
+#pragma once
+
+#include "PulseFS/Engine/AttributeBitmaps.hpp"
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <mutex>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+namespace PulseFS::Engine {
+
+struct ResultDelta {
+  std::vector<unsigned long long> added;
+  std::vector<unsigned long long> removed;
+  // Members that still match but were renamed, moved or changed attributes.
+  std::vector<unsigned long long> updated;
+  // A directory was renamed or moved, so the path of any member may have
+  // changed with it.
+  bool pathsChanged = false;
+  // The query can no longer be kept current incrementally (a snapshot load,
+  // or a truncated result lost too many members); run it again.
+  bool resync = false;
+
+  [[nodiscard]] bool Empty() const {
+    return added.empty() && removed.empty() && updated.empty() &&
+           !pathsChanged && !resync;
+  }
+};
+
+// A query registered with SearchIndex::Subscribe. Writers test every changed
+// entry against it under the index lock and queue the effect here; the
+// subscriber drains the queue from its own thread. Queued changes coalesce,
+// so an id added and removed between two drains never shows up.
+class StandingQuery {
+public:
+  StandingQuery(std::wstring loweredQuery, size_t maxResults,
+                AttributeFilter filter = {})
+      : m_query(std::move(loweredQuery)), m_maxResults(maxResults),
+        m_filter(filter) {}
+
+  StandingQuery(const StandingQuery &) = delete;
+  StandingQuery &operator=(const StandingQuery &) = delete;
+
+  // Returns what changed since the last call and clears it.
+  ResultDelta TakeDelta();
+
+  // Blocks until a change is queued or the timeout passes.
+  bool WaitForDelta(std::chrono::milliseconds timeout);
+
+private:
+  friend class SearchIndex;
+
+  void QueueAdd(unsigned long long id);
+  void QueueRemove(unsigned long long id);
+  void QueueUpdate(unsigned long long id);
+  void QueuePathsChanged();
+  void QueueResync();
+
+  // Read-only after construction.
+  const std::wstring m_query;
+  const size_t m_maxResults;
+  const AttributeFilter m_filter;
+
+  // Guarded by the owning SearchIndex lock.
+  std::unordered_set<unsigned long long> m_members;
+  bool m_complete = true;
+
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+  std::unordered_set<unsigned long long> m_added;
+  std::unordered_set<unsigned long long> m_removed;
+  std::unordered_set<unsigned long long> m_updated;
+  bool m_pathsChanged = false;
+  bool m_resync = false;
+};
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,63 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+namespace PulseFS::Ipc {
+
+// A connected byte stream: a Unix domain socket, or an overlapped named pipe
+// on Windows. One thread may read while another writes.
+class Channel {
+public:
+  ~Channel();
+
+  Channel(const Channel &) = delete;
+  Channel &operator=(const Channel &) = delete;
+
+  static std::unique_ptr<Channel> Connect(const std::string &endpoint);
+
+  bool ReadExact(void *data, size_t length);
+  bool WriteAll(const void *data, size_t length);
+
+  // Unblocks a pending read on another thread; the channel is dead after.
+  void Shutdown();
+
+private:
+  friend class Listener;
+  explicit Channel(intptr_t handle);
+
+  intptr_t m_handle;
+  intptr_t m_readEvent = 0;
+  intptr_t m_writeEvent = 0;
+  std::atomic<bool> m_shutdown = false;
+};
+
+class Listener {
+public:
+  Listener() = default;
+  ~Listener();
+
+  Listener(const Listener &) = delete;
+  Listener &operator=(const Listener &) = delete;
+
+  bool Open(const std::string &endpoint);
+
+  // Blocks for the next client; returns nullptr once Close() is called.
+  std::unique_ptr<Channel> Accept();
+
+  void Close();
+
+private:
+  std::string m_endpoint;
+  intptr_t m_handle = -1;
+  intptr_t m_stopEvent = 0;
+  std::atomic<bool> m_closed = false;
+};
+
+// "/tmp/pulsefs-<uid>.sock" on Unix, "\\.\pipe\PulseFS" on Windows.
+std::string DefaultEndpoint();
+
+} // namespace PulseFS::Ipc
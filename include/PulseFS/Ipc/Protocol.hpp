@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PulseFS::Ipc {
+
+// Every message is a FrameHeader followed by `length` payload bytes, in host
+// (little-endian) order since both ends run on the same machine. Clients may
+// pipeline any number of requests; responses carry the request id and can
+// arrive out of order.
+//
+//   Query    u32 maxResults, u32 queryLength, UTF-16 query
+//   Cancel   (empty)
+//   Stats    (empty)
+//   Results  u8 status, u8[3] reserved, u32 count, then per hit:
+//            u64 id, u32 attributes, u32 pathLength, UTF-16 path
+//   StatsReply  UTF-8 JSON object
+enum class MessageType : uint8_t {
+  Query = 1,
+  Cancel = 2,
+  Stats = 3,
+  Results = 0x81,
+  StatsReply = 0x82
+};
+
+enum class QueryStatus : uint8_t { Ok = 0, Cancelled = 1, BadRequest = 2 };
+
+inline constexpr uint8_t kProtocolVersion = 1;
+inline constexpr uint32_t kMaxPayloadSize = 16 * 1024 * 1024;
+
+struct FrameHeader {
+  uint32_t length;
+  uint8_t type;
+  uint8_t version;
+  uint16_t reserved;
+  uint32_t requestId;
+};
+static_assert(sizeof(FrameHeader) == 12);
+
+struct QueryHit {
+  unsigned long long id;
+  unsigned long attributes;
+  std::wstring path;
+};
+
+struct QueryResponse {
+  uint32_t requestId = 0;
+  QueryStatus status = QueryStatus::Ok;
+  std::vector<QueryHit> hits;
+};
+
+// Each Append* writes one complete frame to the end of buffer.
+void AppendQuery(std::vector<char> &buffer, uint32_t requestId,
+                 std::wstring_view query, uint32_t maxResults);
+void AppendCancel(std::vector<char> &buffer, uint32_t requestId);
+void AppendResults(std::vector<char> &buffer, const QueryResponse &response);
+void AppendStatsRequest(std::vector<char> &buffer, uint32_t requestId);
+void AppendStatsReply(std::vector<char> &buffer, uint32_t requestId,
+                      std::string_view json);
+
+bool DecodeQuery(const char *payload, size_t length, std::wstring &query,
+                 uint32_t &maxResults);
+bool DecodeResults(const FrameHeader &header, const char *payload,
+                   QueryResponse &response);
+
+} // namespace PulseFS::Ipc
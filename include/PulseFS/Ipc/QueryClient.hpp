@@ -0,0 +1,45 @@
+#pragma once
+
+#include "PulseFS/Ipc/Channel.hpp"
+#include "PulseFS/Ipc/Protocol.hpp"
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace PulseFS::Ipc {
+
+// Client side of QueryServer. Send/Cancel/Receive allow pipelining from
+// one thread; Query is the blocking convenience for one request at a time.
+class QueryClient {
+public:
+  bool Connect(const std::string &endpoint);
+  [[nodiscard]] bool IsConnected() const { return m_channel != nullptr; }
+
+  // Returns the request id, or 0 if the connection is gone.
+  uint32_t Send(std::wstring_view query, uint32_t maxResults);
+  bool Cancel(uint32_t requestId);
+
+  // Blocks for the next response in arrival order.
+  bool Receive(QueryResponse &response);
+
+  std::optional<QueryResponse> Query(std::wstring_view query,
+                                     uint32_t maxResults);
+
+  // Server metrics as a JSON object. Results for queries still in flight
+  // are discarded while waiting, so call it between queries.
+  std::optional<std::string> Stats();
+
+private:
+  bool ReadFrame(FrameHeader &header);
+
+  std::unique_ptr<Channel> m_channel;
+  std::mutex m_writeMutex;
+  std::vector<char> m_sendBuffer;
+  std::vector<char> m_receiveBuffer;
+  uint32_t m_nextRequestId = 1;
+};
+
+} // namespace PulseFS::Ipc
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "PulseFS/Engine/QueryCache.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Ipc/Channel.hpp"
+#include "PulseFS/Ipc/Protocol.hpp"
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace PulseFS::Ipc {
+
+struct QueryServerOptions {
+  // Upper bound on queries answered by one shared scan.
+  size_t maxBatch = 64;
+  uint32_t maxResultsCap = 10000;
+  // Replies a client has not read yet; a client that falls this far behind
+  // is dropped rather than left to stall the server.
+  size_t maxOutboxBytes = size_t(64) << 20;
+};
+
+// Serves one resident SearchIndex to local clients. Each connection gets a
+// reader thread; queries from every connection funnel into one dispatcher
+// that answers whatever is queued with a single SearchMany pass. Replies go
+// into the connection's outbox and its own writer thread sends them, so a
+// client that stops reading only holds up itself.
+class QueryServer {
+public:
+  explicit QueryServer(Engine::SearchIndex &index,
+                       const QueryServerOptions &options = {});
+  ~QueryServer();
+
+  QueryServer(const QueryServer &) = delete;
+  QueryServer &operator=(const QueryServer &) = delete;
+
+  bool Start(const std::string &endpoint);
+  void Stop();
+
+  [[nodiscard]] unsigned long long QueriesServed() const {
+    return m_queriesServed;
+  }
+  [[nodiscard]] unsigned long long ScansRun() const { return m_scansRun; }
+  [[nodiscard]] unsigned long long CacheHits() const { return m_cacheHits; }
+  [[nodiscard]] unsigned long long ClientsDropped() const {
+    return m_clientsDropped;
+  }
+
+private:
+  struct Client;
+
+  struct PendingQuery {
+    std::shared_ptr<Client> client;
+    uint32_t requestId;
+    std::wstring query;
+    uint32_t maxResults;
+    std::atomic<bool> cancelled = false;
+  };
+
+  struct Client {
+    std::unique_ptr<Channel> channel;
+    std::mutex pendingMutex;
+    std::unordered_map<uint32_t, std::shared_ptr<PendingQuery>> pending;
+    std::thread reader;
+    std::thread writer;
+    std::atomic<bool> readerFinished = false;
+    std::atomic<bool> writerFinished = false;
+
+    std::mutex outboxMutex;
+    std::condition_variable outboxChanged;
+    std::deque<std::vector<char>> outbox;
+    size_t outboxBytes = 0;
+    // Set once nothing more will be queued; the writer drains and exits.
+    bool closing = false;
+  };
+
+  void AcceptLoop();
+  void ClientLoop(std::shared_ptr<Client> client);
+  void WriterLoop(std::shared_ptr<Client> client);
+  // Queues a frame, or drops the client if its outbox is full.
+  void Send(Client &client, std::vector<char> frame);
+  static void Close(Client &client);
+  void DispatchLoop();
+  void Respond(PendingQuery &query, QueryStatus status,
+               const std::vector<unsigned long long> &ids);
+  void ReapClients(bool all);
+  std::string StatsJson() const;
+
+  Engine::SearchIndex &m_index;
+  QueryServerOptions m_options;
+  Listener m_listener;
+  std::atomic<bool> m_running = false;
+  std::thread m_acceptThread;
+  std::thread m_dispatchThread;
+
+  std::mutex m_clientsMutex;
+  std::list<std::shared_ptr<Client>> m_clients;
+
+  std::mutex m_queueMutex;
+  std::condition_variable m_queueChanged;
+  std::deque<std::shared_ptr<PendingQuery>> m_queue;
+
+  // Only touched by the dispatcher.
+  Engine::QueryCache m_cache;
+
+  std::atomic<unsigned long long> m_queriesServed = 0;
+  std::atomic<unsigned long long> m_scansRun = 0;
+  std::atomic<unsigned long long> m_cacheHits = 0;
+  std::atomic<unsigned long long> m_clientsDropped = 0;
+};
+
+} // namespace PulseFS::Ipc
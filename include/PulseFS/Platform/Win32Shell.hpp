@@ -0,0 +1,13 @@
+#pragma once
+
+#include "PulseFS/UI/PanelPlatform.hpp"
+
+namespace PulseFS::Platform {
+
+// Opens results in Explorer.
+class Win32Shell : public UI::FileActions {
+public:
+  void Reveal(const std::wstring &path) override;
+};
+
+} // namespace PulseFS::Platform
@@ -1,14 +1,23 @@
 #pragma once
 
+#include "PulseFS/UI/PanelPlatform.hpp"
+#include "PulseFS/Utils/AsyncLruCache.hpp"
+#include "PulseFS/Utils/AtlasPacker.hpp"
 #include <Windows.h>
 #include <d3d11.h>
 #include <wrl/client.h>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <optional>
 #include <string>
-#include <unordered_map>
+#include <vector>
 
 namespace PulseFS::UI {
 
-class IconCache {
+// Icons are packed into shared atlas pages, so icons from the same page
+// batch into one draw.
+class IconCache : public IconSource {
 public:
   IconCache(ID3D11Device* device);
   ~IconCache();
@@ -16,24 +25,82 @@ public:
   IconCache(const IconCache&) = delete;
   IconCache& operator=(const IconCache&) = delete;
 
-  ID3D11ShaderResourceView* GetIcon(const std::wstring& path, bool isDirectory);
-  ID3D11ShaderResourceView* GetImageThumbnail(const std::wstring& path);
+  // Never blocks on the shell: a miss queues the lookup on a worker and
+  // returns the generic folder or file icon until it lands. `iconKey` is a
+  // path, or an extension such as ".txt" for files whose icon only depends
+  // on it (see Engine::DisplayModel::IconKeyFor).
+  IconView GetIcon(const std::wstring& iconKey, bool isDirectory) override;
+  // Decodes off-thread and returns null until the thumbnail is ready. Call
+  // every frame the hover lasts; once it stops, the load is cancelled.
+  IconView GetThumbnail(const std::wstring& path) override;
+
+  // Call once per frame, before any GetIcon, to take in finished loads.
+  void BeginFrame();
 
   void Clear();
 
+  [[nodiscard]] Utils::AsyncLruCacheStats IconStats() const {
+    return m_icons->Stats();
+  }
+
 private:
-  Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateIconTexture(HICON hIcon);
+  // Pixels stay on the CPU side so an icon whose atlas cell was reused can
+  // be uploaded again without another shell call.
+  struct IconImage {
+    UINT width = 0;
+    UINT height = 0;
+    std::vector<uint8_t> pixels;
+    mutable Utils::AtlasSlot slot;
+  };
+
+  using IconLru = Utils::AsyncLruCache<std::wstring, IconImage>;
+
+  static constexpr uint32_t kAtlasPageSize = 512;
+  static constexpr uint32_t kAtlasMaxPages = 4;
+
+  static constexpr size_t kIconBudgetBytes = 8u << 20;
+
+  struct Thumbnail {
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> texture;
+    UINT width = 0;
+    UINT height = 0;
+  };
+
+  using ThumbnailLru = Utils::AsyncLruCache<std::wstring, Thumbnail>;
+
+  static constexpr UINT kThumbnailSize = 256;
+  static constexpr UINT kThumbnailBandBytes = 4u << 20;
+  static constexpr size_t kThumbnailBudgetBytes = 32u << 20;
+
+  std::optional<IconLru::Loaded> LoadIconImage(const std::wstring& iconKey);
+  std::optional<ThumbnailLru::Loaded> LoadThumbnail(
+      const std::wstring& path, const std::atomic<bool>& cancelled);
+
+  Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> CreateBgraTexture(
+      const void* pixels, UINT width, UINT height, UINT stride);
+
+  std::optional<IconImage> RenderIconPixels(HICON hIcon);
+  IconView PlaceInAtlas(const IconImage& image, bool pinned);
+  bool UploadToAtlas(const Utils::AtlasSlot& slot, const std::vector<uint8_t>& pixels);
 
   HICON GetShellIcon(const std::wstring& path, bool isDirectory);
 
   ID3D11Device* m_device;
   ID3D11DeviceContext* m_deviceContext;
 
-  std::unordered_map<std::wstring, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> m_iconCache;
-  std::unordered_map<std::wstring, Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> m_thumbnailCache;
+  Utils::AtlasPacker m_atlas;
+  std::vector<Microsoft::WRL::ComPtr<ID3D11Texture2D>> m_atlasPages;
+  std::vector<Microsoft::WRL::ComPtr<ID3D11ShaderResourceView>> m_atlasViews;
+
+  std::optional<IconImage> m_folderIcon;
+  std::optional<IconImage> m_defaultFileIcon;
+
+  std::wstring m_hoveredThumbnail;
+  bool m_thumbnailRequested = false;
 
-  Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_folderIcon;
-  Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> m_defaultFileIcon;
+  // Last, so their workers are joined before anything they use is released.
+  std::unique_ptr<IconLru> m_icons;
+  std::unique_ptr<ThumbnailLru> m_thumbnails;
 };
 
 } // namespace PulseFS::UI
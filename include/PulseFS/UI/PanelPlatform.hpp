@@ -0,0 +1,41 @@
+#pragma once
+
+#include "imgui.h"
+#include <cstdint>
+#include <string>
+
+namespace PulseFS::UI {
+
+// A texture, or a sub-rectangle of one in UV coordinates, ready for
+// ImGui::Image. Width and height are the image's size in pixels.
+struct IconView {
+  ImTextureID texture{};
+  float u0 = 0.0f;
+  float v0 = 0.0f;
+  float u1 = 1.0f;
+  float v1 = 1.0f;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+// What SearchPanel draws icons and previews with. The application backs it
+// with IconCache; the headless benchmark with a fixed texture.
+class IconSource {
+public:
+  virtual ~IconSource() = default;
+
+  // Called for every visible row every frame, so it must not block.
+  virtual IconView GetIcon(const std::wstring &iconKey, bool isDirectory) = 0;
+  // No texture until the preview is ready.
+  virtual IconView GetThumbnail(const std::wstring &path) = 0;
+};
+
+// What SearchPanel does with a result outside the application.
+class FileActions {
+public:
+  virtual ~FileActions() = default;
+
+  virtual void Reveal(const std::wstring &path) = 0;
+};
+
+} // namespace PulseFS::UI
@@ -1,46 +1,88 @@
 #pragma once
 
+#include "PulseFS/Core/ScanPublisher.hpp"
+#include "PulseFS/Core/UsnMonitor.hpp"
+#include "PulseFS/Engine/DisplayModel.hpp"
 #include "PulseFS/Engine/SearchIndex.hpp"
-#include "PulseFS/Renderer/D3D11Renderer.hpp"
+#include "PulseFS/Engine/SearchService.hpp"
+#include "PulseFS/UI/PanelPlatform.hpp"
 #include <atomic>
+#include <chrono>
+#include <memory>
 #include <mutex>
 #include <string>
+#include <string_view>
 #include <vector>
 
 namespace PulseFS::UI {
 
-class IconCache;
+// Talks to the platform only through IconSource and FileActions, so it
+// renders anywhere ImGui does. With the search box empty it browses folders
+// instead, starting at the volume root.
 class SearchPanel {
 public:
-  void Initialize(Engine::SearchIndex &index, Renderer::D3D11Renderer* renderer, IconCache* iconCache);
+  void Initialize(Engine::SearchIndex &index, IconSource* icons, FileActions* files);
   void Render();
 
+  // As if typed into the search box.
+  void SetQuery(std::string_view utf8);
+  // Lists a folder, as if it had been opened in browse mode.
+  void Browse(unsigned long long folderId);
+  // Takes effect from the next search.
+  void SetMaxResults(size_t maxResults) { m_MaxResults = maxResults; }
+  size_t ResultCount();
+
+  // Results are live while scanning; the progress, if set, is shown in the
+  // status bar until SetScanning(false).
   void SetScanning(bool scanning) { m_IsScanning = scanning; }
+  void SetScanProgress(const Core::ScanProgress *progress) { m_ScanProgress = progress; }
   void SetIndexedCount(size_t count) { m_IndexedCount = count; }
+  void SetJournalMonitor(const Core::UsnMonitor *monitor) { m_Monitor = monitor; }
 
 private:
+  void OnQueryEdited();
+  void SubmitSearch(std::wstring query, Engine::SearchPriority priority);
+  void SubmitBrowse(Engine::SearchPriority priority);
+  void ApplyResultDelta();
+  void SubmitModelUpdate(Engine::ResultDelta delta);
   void RenderSearchBar();
+  void RenderBrowseBar();
   void RenderStatusBar();
+  void RenderMetricsTooltip();
   void RenderResultsTable();
-  void OpenFile(const std::wstring &path);
 
-  static std::string WideToUtf8(const std::wstring &wstr);
-  static std::wstring Utf8ToWide(const std::string &str);
-  static const char* GetFileIcon(const std::wstring &fileName, unsigned long fileAttributes);
-  static bool IsImageFile(const std::wstring &fileName);
+  static std::string FormatFileTime(long long fileTime);
+
+  static constexpr size_t kDefaultMaxResults = 100;
 
   Engine::SearchIndex *m_SearchIndex = nullptr;
-  Renderer::D3D11Renderer *m_Renderer = nullptr;
-  IconCache *m_IconCache = nullptr;
+  IconSource *m_Icons = nullptr;
+  FileActions *m_Files = nullptr;
+  size_t m_MaxResults = kDefaultMaxResults;
+  std::atomic<const Core::UsnMonitor *> m_Monitor = nullptr;
+  std::atomic<const Core::ScanProgress *> m_ScanProgress = nullptr;
   char m_SearchQueryBuf[256] = "";
   std::wstring m_CurrentQuery;
-  std::vector<unsigned long long> m_SearchResults;
+  // Never edited once published: the search thread swaps in a new model for
+  // every result set, delta and metadata refresh.
+  std::shared_ptr<const Engine::DisplayModel> m_Model;
+  // A delta or refresh is queued; the next waits in the standing query.
+  bool m_ModelUpdatePending = false;
+  std::chrono::steady_clock::time_point m_LastMetadataRefresh;
+  std::shared_ptr<Engine::StandingQuery> m_Standing;
+  // Folders opened in browse mode, the current one last; empty until the
+  // index has a root.
+  std::vector<unsigned long long> m_BrowsePath;
+  // Index generation the browsed listing was read at.
+  uint64_t m_BrowseGeneration = 0;
+  uint64_t m_SearchTicket = 0;
   std::mutex m_ResultsMutex;
 
   std::atomic<bool> m_IsScanning = true;
   std::atomic<size_t> m_IndexedCount = 0;
-  std::atomic<uint64_t> m_SearchTimeMs = 0;
-  std::atomic<bool> m_SearchPending = false;
+  std::atomic<uint64_t> m_SearchTimeUs = 0;
+  // Last, so its workers are joined before the state they write goes away.
+  std::unique_ptr<Engine::SearchService> m_Service;
 };
 
 } // namespace PulseFS::UI
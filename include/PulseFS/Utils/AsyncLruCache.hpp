@@ -0,0 +1,263 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <optional>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace PulseFS::Utils {
+
+struct AsyncLruCacheOptions {
+  size_t budgetBytes = 16u << 20;
+  size_t workers = 1;
+  // Oldest requests are dropped past this, on the theory that whatever asked
+  // for them (a row scrolled past) no longer needs them.
+  size_t maxQueued = 256;
+  // Run on each worker thread before its first load and after its last,
+  // e.g. to initialise COM.
+  std::function<void()> workerInit;
+  std::function<void()> workerExit;
+};
+
+struct AsyncLruCacheStats {
+  unsigned long long hits = 0;
+  unsigned long long misses = 0;
+  unsigned long long loads = 0;
+  unsigned long long failures = 0;
+  unsigned long long evictions = 0;
+  unsigned long long dropped = 0;
+  unsigned long long cancelled = 0;
+  size_t entries = 0;
+  size_t bytes = 0;
+};
+
+// LRU of values produced by a slow loader on background threads. The owner
+// thread calls Get, which never blocks: a miss queues one load per key
+// (later requests for the same key are folded into it) and returns null, so
+// the caller can draw a placeholder. Finished loads wait in a completion
+// queue until the owner calls Pump, which is the only place entries are
+// added or evicted; pointers returned by Get stay valid until then. Failed
+// loads are cached too, so a bad key is not retried every frame, unless the
+// load failed because it was cancelled.
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class AsyncLruCache {
+public:
+  struct Loaded {
+    Value value;
+    size_t bytes = 0;
+  };
+  // `cancelled` is raised by Cancel while the load runs; a loader that
+  // notices can give up early by returning nullopt.
+  using Loader = std::function<std::optional<Loaded>(
+      const Key &, const std::atomic<bool> &cancelled)>;
+
+  explicit AsyncLruCache(Loader loader, AsyncLruCacheOptions options = {})
+      : m_loader(std::move(loader)), m_options(std::move(options)) {
+    const size_t workers = m_options.workers ? m_options.workers : 1;
+    for (size_t i = 0; i < workers; ++i)
+      m_workers.emplace_back(&AsyncLruCache::WorkerLoop, this);
+  }
+
+  ~AsyncLruCache() {
+    {
+      std::lock_guard lock(m_queueMutex);
+      m_stopping = true;
+    }
+    m_queueChanged.notify_all();
+    for (auto &worker : m_workers)
+      worker.join();
+  }
+
+  AsyncLruCache(const AsyncLruCache &) = delete;
+  AsyncLruCache &operator=(const AsyncLruCache &) = delete;
+
+  // Owner thread only. Null while the load is pending or if it failed.
+  const Value *Get(const Key &key) {
+    if (auto it = m_index.find(key); it != m_index.end()) {
+      m_lru.splice(m_lru.begin(), m_lru, it->second);
+      m_stats.hits++;
+      return it->second->value ? &*it->second->value : nullptr;
+    }
+    m_stats.misses++;
+    if (m_inFlight.insert(key).second)
+      Request(key);
+    return nullptr;
+  }
+
+  // Owner thread only. Moves up to maxCompletions finished loads into the
+  // cache, then evicts down to the budget. Returns how many were moved.
+  size_t Pump(size_t maxCompletions = SIZE_MAX) {
+    std::vector<Completion> completed;
+    {
+      std::lock_guard lock(m_queueMutex);
+      while (!m_completed.empty() && completed.size() < maxCompletions) {
+        completed.push_back(std::move(m_completed.front()));
+        m_completed.pop_front();
+      }
+    }
+
+    for (auto &completion : completed) {
+      if (completion.epoch != m_epoch)
+        continue;
+      m_inFlight.erase(completion.key);
+      if (!completion.loaded && completion.cancelled)
+        continue;
+      Entry entry{completion.key, std::nullopt, kFailedEntryBytes};
+      if (completion.loaded) {
+        entry.bytes = completion.loaded->bytes;
+        entry.value = std::move(completion.loaded->value);
+        m_stats.loads++;
+      } else {
+        m_stats.failures++;
+      }
+      m_bytes += entry.bytes;
+      m_lru.push_front(std::move(entry));
+      m_index[completion.key] = m_lru.begin();
+    }
+
+    while (m_bytes > m_options.budgetBytes && m_lru.size() > 1) {
+      m_bytes -= m_lru.back().bytes;
+      m_index.erase(m_lru.back().key);
+      m_lru.pop_back();
+      m_stats.evictions++;
+    }
+    return completed.size();
+  }
+
+  // Owner thread only. Drops a queued load for `key`, or asks a running one
+  // to stop. A load that already finished is kept.
+  void Cancel(const Key &key) {
+    if (!m_inFlight.contains(key))
+      return;
+    std::lock_guard lock(m_queueMutex);
+    if (auto it = std::find(m_requests.begin(), m_requests.end(), key);
+        it != m_requests.end()) {
+      m_requests.erase(it);
+      m_inFlight.erase(key);
+      m_stats.cancelled++;
+      return;
+    }
+    for (auto &active : m_active) {
+      if (active.key == key && !active.cancelled.exchange(true))
+        m_stats.cancelled++;
+    }
+  }
+
+  // Owner thread only. Loads already running are discarded when they finish.
+  void Clear() {
+    {
+      std::lock_guard lock(m_queueMutex);
+      m_requests.clear();
+      m_completed.clear();
+      ++m_epoch;
+    }
+    m_inFlight.clear();
+    m_index.clear();
+    m_lru.clear();
+    m_bytes = 0;
+  }
+
+  [[nodiscard]] AsyncLruCacheStats Stats() const {
+    AsyncLruCacheStats stats = m_stats;
+    stats.entries = m_lru.size();
+    stats.bytes = m_bytes;
+    return stats;
+  }
+
+private:
+  static constexpr size_t kFailedEntryBytes = 64;
+
+  struct Entry {
+    Key key;
+    std::optional<Value> value;
+    size_t bytes;
+  };
+
+  struct Completion {
+    Key key;
+    uint64_t epoch;
+    std::optional<Loaded> loaded;
+    bool cancelled;
+  };
+
+  struct Active {
+    explicit Active(Key activeKey) : key(std::move(activeKey)) {}
+    Key key;
+    std::atomic<bool> cancelled = false;
+  };
+
+  void Request(const Key &key) {
+    {
+      std::lock_guard lock(m_queueMutex);
+      m_requests.push_back(key);
+      if (m_requests.size() > m_options.maxQueued) {
+        m_inFlight.erase(m_requests.front());
+        m_requests.pop_front();
+        m_stats.dropped++;
+      }
+    }
+    m_queueChanged.notify_one();
+  }
+
+  void WorkerLoop() {
+    if (m_options.workerInit)
+      m_options.workerInit();
+    while (true) {
+      typename std::list<Active>::iterator active;
+      uint64_t epoch;
+      {
+        std::unique_lock lock(m_queueMutex);
+        m_queueChanged.wait(
+            lock, [this] { return m_stopping || !m_requests.empty(); });
+        if (m_stopping)
+          break;
+        // Newest first: it is the one most likely still on screen.
+        active = m_active.emplace(m_active.end(), std::move(m_requests.back()));
+        m_requests.pop_back();
+        epoch = m_epoch;
+      }
+
+      std::optional<Loaded> loaded = m_loader(active->key, active->cancelled);
+
+      std::lock_guard lock(m_queueMutex);
+      m_completed.push_back({std::move(active->key), epoch, std::move(loaded),
+                             active->cancelled.load()});
+      m_active.erase(active);
+    }
+    if (m_options.workerExit)
+      m_options.workerExit();
+  }
+
+  Loader m_loader;
+  AsyncLruCacheOptions m_options;
+
+  // Owner thread only.
+  std::list<Entry> m_lru;
+  std::unordered_map<Key, typename std::list<Entry>::iterator, Hash> m_index;
+  std::unordered_set<Key, Hash> m_inFlight;
+  size_t m_bytes = 0;
+  AsyncLruCacheStats m_stats;
+
+  std::mutex m_queueMutex;
+  std::condition_variable m_queueChanged;
+  std::deque<Key> m_requests;
+  std::deque<Completion> m_completed;
+  std::list<Active> m_active;
+  uint64_t m_epoch = 0;
+  bool m_stopping = false;
+
+  std::vector<std::thread> m_workers;
+};
+
+} // namespace PulseFS::Utils
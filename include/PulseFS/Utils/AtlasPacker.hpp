@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <optional>
+#include <vector>
+
+namespace PulseFS::Utils {
+
+struct AtlasSlot {
+  uint32_t cell = 0;
+  // Zero means "never allocated".
+  uint64_t tag = 0;
+  uint32_t page = 0;
+  uint32_t x = 0;
+  uint32_t y = 0;
+  uint32_t width = 0;
+  uint32_t height = 0;
+};
+
+// Places small images on square atlas pages. Images are rounded up to a
+// power-of-two size class; each page is cut into shelves one class tall, and
+// each shelf into square cells, so freeing a cell leaves a hole that the next
+// image of that class fits exactly. When every page is full, the cell of the
+// same class that was touched longest ago is handed out again, and the slot
+// that held it stops being Valid. Failing that, the idlest run of adjacent
+// shelves tall enough for the class is cleared and re-cut for it, so pages
+// filled with one size do not lock the others out for good. Cells touched in
+// the current frame, and pinned cells, are never reused, so nothing drawn
+// this frame is overwritten under it.
+class AtlasPacker {
+public:
+  AtlasPacker(uint32_t pageSize, uint32_t maxPages);
+
+  // Nullopt when the image is larger than a page, or when every candidate
+  // cell is pinned or in use this frame.
+  std::optional<AtlasSlot> Allocate(uint32_t width, uint32_t height,
+                                    bool pinned = false);
+
+  [[nodiscard]] bool Valid(const AtlasSlot &slot) const;
+  void Touch(const AtlasSlot &slot);
+  void Release(const AtlasSlot &slot);
+
+  // Starts a new frame for the purposes of eviction.
+  void NextFrame() { ++m_frame; }
+
+  [[nodiscard]] uint32_t PageSize() const { return m_pageSize; }
+  [[nodiscard]] uint32_t PageCount() const {
+    return static_cast<uint32_t>(m_pageShelfEnd.size());
+  }
+  [[nodiscard]] unsigned long long Evictions() const { return m_evictions; }
+
+private:
+  static constexpr uint32_t kMinClass = 8;
+
+  struct Cell {
+    uint32_t page;
+    uint32_t x;
+    uint32_t y;
+    // Zero once its shelf was re-cut for another class; the index then waits
+    // in m_spareCells.
+    uint32_t size;
+    uint64_t tag = 0;
+    uint64_t lastUse = 0;
+    bool pinned = false;
+  };
+
+  struct Shelf {
+    uint32_t page;
+    uint32_t y;
+    // The band it spans, which a reclaimed shelf can leave taller than its
+    // class.
+    uint32_t height;
+    uint32_t size;
+    uint32_t nextX = 0;
+  };
+
+  std::optional<uint32_t> TakeCell(uint32_t size);
+  std::optional<uint32_t> EvictCell(uint32_t size);
+  std::optional<uint32_t> ReclaimShelves(uint32_t size);
+
+  uint32_t m_pageSize;
+  uint32_t m_maxPages;
+  std::vector<uint32_t> m_pageShelfEnd;
+  std::vector<Shelf> m_shelves;
+  std::vector<Cell> m_cells;
+  std::vector<uint32_t> m_spareCells;
+  // Indexed by log2 of the size class.
+  std::vector<std::vector<uint32_t>> m_free;
+  uint64_t m_nextTag = 1;
+  uint64_t m_frame = 1;
+  unsigned long long m_evictions = 0;
+};
+
+} // namespace PulseFS::Utils
@@ -0,0 +1,72 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace PulseFS::Utils {
+
+// Largest size with the same aspect ratio that fits in maxSide x maxSide.
+// Never upscales, and never returns a zero dimension.
+std::pair<uint32_t, uint32_t> FitWithin(uint32_t width, uint32_t height,
+                                        uint32_t maxSide);
+
+// Area-averaging (box) downscaler for 8-bit BGRA. Every destination pixel is
+// the coverage-weighted mean of the source pixels under it, so nothing is
+// skipped however large the ratio. Rows are pushed one at a time, top to
+// bottom, so a decoder can stream a huge image through a small band buffer.
+// Uses SSE2 when the target has it and plain loops otherwise; the two agree
+// to within rounding.
+class BgraDownscaler {
+public:
+  // The destination is clamped to the source size.
+  BgraDownscaler(uint32_t srcWidth, uint32_t srcHeight, uint32_t dstWidth,
+                 uint32_t dstHeight);
+
+  // `row` holds srcWidth pixels. Rows past srcHeight are ignored.
+  void PushRow(const uint8_t *row);
+
+  [[nodiscard]] bool Finished() const { return m_srcRow == m_srcHeight; }
+  [[nodiscard]] uint32_t Width() const { return m_dstWidth; }
+  [[nodiscard]] uint32_t Height() const { return m_dstHeight; }
+
+  // Tightly packed dstWidth * dstHeight * 4 bytes; complete once Finished.
+  [[nodiscard]] std::vector<uint8_t> &Pixels() { return m_pixels; }
+
+private:
+  struct Span {
+    uint32_t first;
+    uint32_t count;
+    uint32_t weightOffset;
+  };
+
+  void FilterRow(const uint8_t *row);
+  void Accumulate(std::vector<float> &into, float weight);
+  void EmitRow(uint32_t y);
+
+  uint32_t m_srcWidth;
+  uint32_t m_srcHeight;
+  uint32_t m_dstWidth;
+  uint32_t m_dstHeight;
+  double m_scaleY;
+
+  std::vector<Span> m_spans;
+  std::vector<float> m_weights;
+
+  uint32_t m_srcRow = 0;
+  uint32_t m_dstRow = 0;
+  // m_filtered is the current source row resampled to dstWidth; m_current
+  // and m_next accumulate the destination row in progress and the one after
+  // it (a source row can straddle the boundary).
+  std::vector<float> m_filtered;
+  std::vector<float> m_current;
+  std::vector<float> m_next;
+  std::vector<uint8_t> m_pixels;
+};
+
+std::vector<uint8_t> DownscaleBgra(const uint8_t *src, uint32_t srcWidth,
+                                   uint32_t srcHeight, size_t srcStride,
+                                   uint32_t dstWidth, uint32_t dstHeight);
+
+} // namespace PulseFS::Utils
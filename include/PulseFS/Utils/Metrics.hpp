@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace PulseFS::Utils {
+
+struct HistogramSnapshot {
+  uint64_t count = 0;
+  uint64_t sum = 0;
+  uint64_t max = 0;
+  std::vector<uint64_t> buckets;
+
+  // Upper bound of the bucket holding the given fraction of samples.
+  [[nodiscard]] uint64_t Percentile(double fraction) const;
+  [[nodiscard]] double Mean() const;
+};
+
+// Log-linear histogram in the style of HdrHistogram: each power of two is
+// split into kSubBuckets linear steps, so every value is reported within
+// 1/kSubBuckets of its true magnitude. Record is a handful of relaxed atomic
+// adds, safe from any thread, and never blocks a reader taking a Snapshot.
+class Histogram {
+public:
+  static constexpr unsigned kSubBucketBits = 4;
+  static constexpr size_t kSubBuckets = size_t(1) << kSubBucketBits;
+  static constexpr size_t kBucketCount = (64 - kSubBucketBits + 1) * kSubBuckets;
+
+  void Record(uint64_t value);
+  [[nodiscard]] HistogramSnapshot Snapshot() const;
+
+  static size_t BucketOf(uint64_t value);
+  static uint64_t BucketUpperBound(size_t bucket);
+
+private:
+  std::array<std::atomic<uint64_t>, kBucketCount> m_buckets{};
+  std::atomic<uint64_t> m_sum = 0;
+  std::atomic<uint64_t> m_max = 0;
+};
+
+// Appends `"key":{"count":..,"mean":..,"p50":..,"p99":..,"p999":..,"max":..}`.
+void AppendJson(std::string &out, const char *key,
+                const HistogramSnapshot &histogram);
+void AppendJsonInteger(std::string &out, const char *key,
+                       unsigned long long value);
+void AppendJsonNumber(std::string &out, const char *key, double value);
+
+} // namespace PulseFS::Utils
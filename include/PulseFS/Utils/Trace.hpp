@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace PulseFS::Utils::Trace {
+
+// Scoped spans recorded into per-thread ring buffers. While tracing is off a
+// span is a single relaxed load; while on it is two clock reads and a store
+// into the calling thread's own buffer, with no locks or shared writes.
+// Each buffer keeps the most recent kEventsPerThread spans.
+inline constexpr size_t kEventsPerThread = size_t(1) << 15;
+
+namespace Detail {
+extern std::atomic<bool> g_enabled;
+uint64_t Now();
+void Record(const char *name, const char *argName, uint64_t arg,
+            uint64_t start, uint64_t end);
+} // namespace Detail
+
+inline bool Enabled() {
+  return Detail::g_enabled.load(std::memory_order_relaxed);
+}
+
+void Enable(bool enabled);
+
+// Labels the calling thread in the trace; the pointer must stay valid.
+void SetThreadName(const char *name);
+
+// Writes every buffered span as Chrome trace JSON (chrome://tracing,
+// Perfetto). Spans keep recording while the file is written.
+bool WriteChromeJson(const std::string &path);
+
+class Span {
+public:
+  // name and argName must be string literals or otherwise outlive the trace.
+  explicit Span(const char *name) : m_name(name) {
+    if (Enabled())
+      m_start = Detail::Now();
+  }
+
+  ~Span() {
+    if (m_start)
+      Detail::Record(m_name, m_argName, m_arg, m_start, Detail::Now());
+  }
+
+  Span(const Span &) = delete;
+  Span &operator=(const Span &) = delete;
+
+  void SetArg(const char *argName, uint64_t value) {
+    m_argName = argName;
+    m_arg = value;
+  }
+
+private:
+  const char *m_name;
+  const char *m_argName = nullptr;
+  uint64_t m_arg = 0;
+  uint64_t m_start = 0;
+};
+
+// Stands in for Span when tracing is compiled out.
+struct NullSpan {
+  void SetArg(const char *, uint64_t) {}
+};
+
+} // namespace PulseFS::Utils::Trace
+
+// PULSEFS_TRACE_SPAN names the span so an argument can be attached;
+// PULSEFS_TRACE_SCOPE is the anonymous form.
+#if PULSEFS_TRACING
+#define PULSEFS_TRACE_SPAN(var, name) ::PulseFS::Utils::Trace::Span var(name)
+#else
+#define PULSEFS_TRACE_SPAN(var, name)                                          \
+  [[maybe_unused]] ::PulseFS::Utils::Trace::NullSpan var
+#endif
+#define PULSEFS_TRACE_CONCAT_(a, b) a##b
+#define PULSEFS_TRACE_CONCAT(a, b) PULSEFS_TRACE_CONCAT_(a, b)
+#define PULSEFS_TRACE_SCOPE(name)                                              \
+  PULSEFS_TRACE_SPAN(PULSEFS_TRACE_CONCAT(traceSpan_, __LINE__), name)
@@ -0,0 +1,147 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+
+namespace PulseFS::Utils {
+
+inline std::wstring WideFromUtf16(const char16_t *data, size_t length) {
+  if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+    return std::wstring(reinterpret_cast<const wchar_t *>(data), length);
+  } else {
+    std::wstring out;
+    out.reserve(length);
+    for (size_t i = 0; i < length; ++i) {
+      char32_t cp = data[i];
+      if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < length &&
+          data[i + 1] >= 0xDC00 && data[i + 1] <= 0xDFFF) {
+        cp = 0x10000 + ((cp - 0xD800) << 10) + (data[i + 1] - 0xDC00);
+        ++i;
+      }
+      out.push_back(static_cast<wchar_t>(cp));
+    }
+    return out;
+  }
+}
+
+inline std::u16string Utf16FromWide(std::wstring_view wstr) {
+  if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+    return std::u16string(reinterpret_cast<const char16_t *>(wstr.data()),
+                          wstr.size());
+  } else {
+    std::u16string out;
+    out.reserve(wstr.size());
+    for (wchar_t wc : wstr) {
+      char32_t cp = static_cast<char32_t>(wc);
+      if (cp >= 0x10000) {
+        cp -= 0x10000;
+        out.push_back(static_cast<char16_t>(0xD800 + (cp >> 10)));
+        out.push_back(static_cast<char16_t>(0xDC00 + (cp & 0x3FF)));
+      } else {
+        out.push_back(static_cast<char16_t>(cp));
+      }
+    }
+    return out;
+  }
+}
+
+// Bytes that are not valid UTF-8 map to U+DC80..U+DCFF so that arbitrary
+// POSIX file names survive a round trip through std::wstring.
+inline std::wstring WideFromUtf8(std::string_view str) {
+  std::wstring out;
+  out.reserve(str.size());
+  const auto *bytes = reinterpret_cast<const unsigned char *>(str.data());
+  const size_t length = str.size();
+
+  for (size_t i = 0; i < length;) {
+    const unsigned char lead = bytes[i];
+    size_t extra = 0;
+    char32_t cp = 0;
+    if (lead < 0x80) {
+      out.push_back(static_cast<wchar_t>(lead));
+      ++i;
+      continue;
+    } else if ((lead & 0xE0) == 0xC0) {
+      extra = 1;
+      cp = lead & 0x1F;
+    } else if ((lead & 0xF0) == 0xE0) {
+      extra = 2;
+      cp = lead & 0x0F;
+    } else if ((lead & 0xF8) == 0xF0) {
+      extra = 3;
+      cp = lead & 0x07;
+    }
+
+    bool valid = extra != 0;
+    for (size_t k = 1; valid && k <= extra; ++k) {
+      if (i + k >= length || (bytes[i + k] & 0xC0) != 0x80) {
+        valid = false;
+        break;
+      }
+      cp = (cp << 6) | (bytes[i + k] & 0x3F);
+    }
+    static constexpr char32_t kMinForLength[] = {0, 0x80, 0x800, 0x10000};
+    if (valid && (cp < kMinForLength[extra] || cp > 0x10FFFF ||
+                  (cp >= 0xD800 && cp <= 0xDFFF))) {
+      valid = false;
+    }
+
+    if (!valid) {
+      out.push_back(static_cast<wchar_t>(0xDC00 + lead));
+      ++i;
+      continue;
+    }
+
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+      if (cp >= 0x10000) {
+        cp -= 0x10000;
+        out.push_back(static_cast<wchar_t>(0xD800 + (cp >> 10)));
+        out.push_back(static_cast<wchar_t>(0xDC00 + (cp & 0x3FF)));
+      } else {
+        out.push_back(static_cast<wchar_t>(cp));
+      }
+    } else {
+      out.push_back(static_cast<wchar_t>(cp));
+    }
+    i += extra + 1;
+  }
+  return out;
+}
+
+inline std::string Utf8FromWide(std::wstring_view wstr) {
+  std::string out;
+  out.reserve(wstr.size());
+  for (size_t i = 0; i < wstr.size(); ++i) {
+    char32_t cp = static_cast<char32_t>(wstr[i]);
+    if constexpr (sizeof(wchar_t) == sizeof(char16_t)) {
+      if (cp >= 0xD800 && cp <= 0xDBFF && i + 1 < wstr.size() &&
+          wstr[i + 1] >= 0xDC00 && wstr[i + 1] <= 0xDFFF) {
+        cp = 0x10000 + ((cp - 0xD800) << 10) +
+             (static_cast<char32_t>(wstr[i + 1]) - 0xDC00);
+        ++i;
+      }
+    }
+
+    if (cp >= 0xDC80 && cp <= 0xDCFF) {
+      out.push_back(static_cast<char>(cp - 0xDC00));
+    } else if (cp < 0x80) {
+      out.push_back(static_cast<char>(cp));
+    } else if (cp < 0x800) {
+      out.push_back(static_cast<char>(0xC0 | (cp >> 6)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else if (cp < 0x10000) {
+      out.push_back(static_cast<char>(0xE0 | (cp >> 12)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    } else {
+      out.push_back(static_cast<char>(0xF0 | (cp >> 18)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 12) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | ((cp >> 6) & 0x3F)));
+      out.push_back(static_cast<char>(0x80 | (cp & 0x3F)));
+    }
+  }
+  return out;
+}
+
+} // namespace PulseFS::Utils
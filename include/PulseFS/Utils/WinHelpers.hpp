@@ -46,4 +46,23 @@ inline ScopedHandle OpenVolume(const std::wstring &volumePath) {
   return ScopedHandle(h);
 }
 
+// Opens a file or directory on `volume` by its file reference number, as
+// FSCTL_ENUM_USN_DATA and the journal report it, without following reparse
+// points.
+inline ScopedHandle OpenFileByReference(HANDLE volume,
+                                        unsigned long long reference,
+                                        DWORD access) {
+  FILE_ID_DESCRIPTOR descriptor = {0};
+  descriptor.dwSize = sizeof(descriptor);
+  descriptor.Type = FileIdType;
+  descriptor.FileId.QuadPart = static_cast<LONGLONG>(reference);
+  HANDLE h = ::OpenFileById(
+      volume, &descriptor, access,
+      FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL,
+      FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OPEN_REPARSE_POINT);
+  if (h == INVALID_HANDLE_VALUE)
+    return nullptr;
+  return ScopedHandle(h);
+}
+
 } // namespace PulseFS::Utils
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace PulseFS::Utils {
+
+// Fixed-size pool with one deque per worker. Workers push and pop their own
+// deque LIFO and steal FIFO from others when they run dry, which keeps
+// recursive fan-out (directory walks) depth-first and cache-friendly.
+class WorkStealingPool {
+public:
+  using Task = std::function<void()>;
+
+  static constexpr size_t npos = static_cast<size_t>(-1);
+
+  explicit WorkStealingPool(size_t threadCount = 0);
+  ~WorkStealingPool();
+
+  WorkStealingPool(const WorkStealingPool &) = delete;
+  WorkStealingPool &operator=(const WorkStealingPool &) = delete;
+
+  void Submit(Task task);
+
+  // Blocks until every submitted task, including tasks submitted by tasks,
+  // has finished, then rethrows the first exception a task threw since the
+  // last Wait. Other tasks still run to completion after one throws.
+  void Wait();
+
+  [[nodiscard]] size_t ThreadCount() const { return m_threads.size(); }
+
+  // Index of the calling worker in this pool, or npos for outside threads.
+  [[nodiscard]] size_t CurrentWorker() const;
+
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+
+  void WorkerLoop(size_t index);
+  bool TryTake(size_t index, Task &task);
+  void WaitIdle();
+
+  std::vector<std::unique_ptr<Queue>> m_queues;
+  std::vector<std::thread> m_threads;
+
+  std::mutex m_stateMutex;
+  std::condition_variable m_workAvailable;
+  std::condition_variable m_allDone;
+  std::atomic<size_t> m_queued = 0;
+  std::atomic<size_t> m_pending = 0;
+  std::atomic<size_t> m_nextQueue = 0;
+  bool m_stopping = false;
+  // Guarded by m_stateMutex.
+  std::exception_ptr m_error;
+};
+
+} // namespace PulseFS::Utils
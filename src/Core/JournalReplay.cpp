@@ -0,0 +1,84 @@
+#include "PulseFS/Core/JournalSource.hpp"
+#include <cstring>
+#include <thread>
+
+namespace PulseFS::Core {
+
+namespace {
+
+constexpr char kRecordingMagic[4] = {'P', 'F', 'S', 'J'};
+constexpr uint32_t kRecordingVersion = 1;
+
+struct FrameHeader {
+  uint64_t elapsedNs;
+  uint32_t length;
+  uint32_t reserved;
+};
+
+} // namespace
+
+JournalRecorder::JournalRecorder(std::unique_ptr<JournalSource> inner,
+                                 const std::string &outputPath)
+    : m_inner(std::move(inner)),
+      m_out(outputPath, std::ios::binary | std::ios::trunc),
+      m_start(std::chrono::steady_clock::now()) {
+  if (m_out) {
+    m_out.write(kRecordingMagic, sizeof(kRecordingMagic));
+    m_out.write(reinterpret_cast<const char *>(&kRecordingVersion),
+                sizeof(kRecordingVersion));
+  }
+}
+
+JournalRead JournalRecorder::Read(std::vector<char> &buffer) {
+  JournalRead status = m_inner->Read(buffer);
+  if (status != JournalRead::Data || !m_out)
+    return status;
+
+  FrameHeader frame{};
+  frame.elapsedNs = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - m_start)
+          .count());
+  frame.length = static_cast<uint32_t>(buffer.size());
+  m_out.write(reinterpret_cast<const char *>(&frame), sizeof(frame));
+  m_out.write(buffer.data(), static_cast<std::streamsize>(buffer.size()));
+  m_out.flush();
+  return status;
+}
+
+ReplayJournalSource::ReplayJournalSource(const std::string &recordingPath,
+                                         ReplayPacing pacing)
+    : m_in(recordingPath, std::ios::binary), m_pacing(pacing),
+      m_start(std::chrono::steady_clock::now()) {
+  char magic[4] = {};
+  uint32_t version = 0;
+  m_in.read(magic, sizeof(magic));
+  m_in.read(reinterpret_cast<char *>(&version), sizeof(version));
+  m_valid = m_in && std::memcmp(magic, kRecordingMagic, sizeof(magic)) == 0 &&
+            version == kRecordingVersion;
+}
+
+JournalRead ReplayJournalSource::Read(std::vector<char> &buffer) {
+  if (!m_valid)
+    return JournalRead::Finished;
+
+  FrameHeader frame{};
+  if (!m_in.read(reinterpret_cast<char *>(&frame), sizeof(frame))) {
+    m_valid = false;
+    return JournalRead::Finished;
+  }
+
+  buffer.resize(frame.length);
+  if (!m_in.read(buffer.data(), frame.length)) {
+    m_valid = false;
+    return JournalRead::Finished;
+  }
+
+  if (m_pacing == ReplayPacing::RealTime) {
+    std::this_thread::sleep_until(m_start +
+                                  std::chrono::nanoseconds(frame.elapsedNs));
+  }
+  return JournalRead::Data;
+}
+
+} // namespace PulseFS::Core
@@ -0,0 +1,423 @@
+#include "PulseFS/Core/LinuxMetadataCollector.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+#include "PulseFS/Utils/WorkStealingPool.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iterator>
+#include <linux/io_uring.h>
+#include <memory>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <utility>
+
+namespace PulseFS::Core {
+
+namespace {
+
+constexpr unsigned kStatxMask = STATX_SIZE | STATX_MTIME;
+
+Engine::IndexChange MakeMetadataChange(unsigned long long id,
+                                       const struct statx &stx) {
+  Engine::IndexChange change{Engine::ChangeKind::SetMetadata, {}};
+  change.entry.id = id;
+  change.entry.size = stx.stx_size;
+  change.entry.lastWriteTime =
+      Engine::FileTimeFromUnix(stx.stx_mtime.tv_sec, stx.stx_mtime.tv_nsec);
+  return change;
+}
+
+// Minimal io_uring submission/completion ring over the raw syscalls.
+class Ring {
+public:
+  ~Ring() {
+    if (m_sqes)
+      ::munmap(m_sqes, m_sqesSize);
+    if (m_cqRing && m_cqRing != m_sqRing)
+      ::munmap(m_cqRing, m_cqRingSize);
+    if (m_sqRing)
+      ::munmap(m_sqRing, m_sqRingSize);
+    if (m_fd >= 0)
+      ::close(m_fd);
+  }
+
+  bool Init(unsigned entries) {
+    io_uring_params params{};
+    m_fd = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (m_fd < 0)
+      return false;
+
+    m_sqRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cqRingSize =
+        params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    const bool singleMap = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (singleMap)
+      m_sqRingSize = m_cqRingSize = std::max(m_sqRingSize, m_cqRingSize);
+
+    m_sqRing = Map(m_sqRingSize, IORING_OFF_SQ_RING);
+    if (!m_sqRing)
+      return false;
+    m_cqRing = singleMap ? m_sqRing : Map(m_cqRingSize, IORING_OFF_CQ_RING);
+    m_sqesSize = params.sq_entries * sizeof(io_uring_sqe);
+    m_sqes = static_cast<io_uring_sqe *>(Map(m_sqesSize, IORING_OFF_SQES));
+    if (!m_cqRing || !m_sqes)
+      return false;
+
+    auto *sq = static_cast<char *>(m_sqRing);
+    m_sqHead = reinterpret_cast<unsigned *>(sq + params.sq_off.head);
+    m_sqTail = reinterpret_cast<unsigned *>(sq + params.sq_off.tail);
+    m_sqMask = *reinterpret_cast<unsigned *>(sq + params.sq_off.ring_mask);
+    m_sqArray = reinterpret_cast<unsigned *>(sq + params.sq_off.array);
+    m_sqEntries = params.sq_entries;
+
+    auto *cq = static_cast<char *>(m_cqRing);
+    m_cqHead = reinterpret_cast<unsigned *>(cq + params.cq_off.head);
+    m_cqTail = reinterpret_cast<unsigned *>(cq + params.cq_off.tail);
+    m_cqMask = *reinterpret_cast<unsigned *>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe *>(cq + params.cq_off.cqes);
+
+    m_localTail = *m_sqTail;
+    return true;
+  }
+
+  [[nodiscard]] unsigned Capacity() const { return m_sqEntries; }
+
+  void PrepareStatx(int directoryFd, const char *name, struct statx *out,
+                    unsigned long long userData) {
+    const unsigned index = m_localTail & m_sqMask;
+    io_uring_sqe *sqe = &m_sqes[index];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->opcode = IORING_OP_STATX;
+    sqe->fd = directoryFd;
+    sqe->addr = reinterpret_cast<unsigned long long>(name);
+    sqe->len = kStatxMask;
+    sqe->off = reinterpret_cast<unsigned long long>(out);
+    sqe->statx_flags = AT_SYMLINK_NOFOLLOW;
+    sqe->user_data = userData;
+    m_sqArray[index] = index;
+    ++m_localTail;
+    ++m_unsubmitted;
+  }
+
+  // Submits prepared entries and waits for at least waitFor completions.
+  bool Submit(unsigned waitFor) {
+    __atomic_store_n(m_sqTail, m_localTail, __ATOMIC_RELEASE);
+    while (true) {
+      long result = ::syscall(__NR_io_uring_enter, m_fd, m_unsubmitted,
+                              waitFor, waitFor ? IORING_ENTER_GETEVENTS : 0,
+                              nullptr, 0);
+      if (result >= 0) {
+        m_unsubmitted -= static_cast<unsigned>(result);
+        if (m_unsubmitted == 0 || waitFor == 0)
+          return true;
+        continue;
+      }
+      if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        return false;
+    }
+  }
+
+  template <typename Fn> unsigned Reap(Fn &&onCompletion) {
+    unsigned head = *m_cqHead;
+    const unsigned tail = __atomic_load_n(m_cqTail, __ATOMIC_ACQUIRE);
+    unsigned reaped = 0;
+    for (; head != tail; ++head, ++reaped) {
+      const io_uring_cqe &cqe = m_cqes[head & m_cqMask];
+      onCompletion(cqe.user_data, cqe.res);
+    }
+    __atomic_store_n(m_cqHead, head, __ATOMIC_RELEASE);
+    return reaped;
+  }
+
+private:
+  void *Map(size_t size, off_t offset) {
+    void *ptr = ::mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                       MAP_SHARED | MAP_POPULATE, m_fd, offset);
+    return ptr == MAP_FAILED ? nullptr : ptr;
+  }
+
+  int m_fd = -1;
+  void *m_sqRing = nullptr;
+  void *m_cqRing = nullptr;
+  size_t m_sqRingSize = 0;
+  size_t m_cqRingSize = 0;
+  io_uring_sqe *m_sqes = nullptr;
+  size_t m_sqesSize = 0;
+
+  unsigned *m_sqHead = nullptr;
+  unsigned *m_sqTail = nullptr;
+  unsigned *m_sqArray = nullptr;
+  unsigned m_sqMask = 0;
+  unsigned m_sqEntries = 0;
+  unsigned m_localTail = 0;
+  unsigned m_unsubmitted = 0;
+
+  unsigned *m_cqHead = nullptr;
+  unsigned *m_cqTail = nullptr;
+  unsigned m_cqMask = 0;
+  io_uring_cqe *m_cqes = nullptr;
+};
+
+// Kernels before 5.6 (or with io_uring disabled) reject the setup or the
+// opcode, so issue one real statx before committing to the ring.
+bool IoUringStatxWorks() {
+  Ring ring;
+  if (!ring.Init(1))
+    return false;
+  struct statx stx;
+  ring.PrepareStatx(AT_FDCWD, "/", &stx, 0);
+  if (!ring.Submit(1))
+    return false;
+  int result = -1;
+  ring.Reap([&](unsigned long long, int res) { result = res; });
+  return result == 0;
+}
+
+struct OpenDirectory {
+  explicit OpenDirectory(std::string p, std::vector<LinuxStatTarget> t)
+      : path(std::move(p)), targets(std::move(t)) {
+    fd = ::open(path.c_str(), O_PATH | O_DIRECTORY | O_CLOEXEC);
+  }
+  ~OpenDirectory() {
+    if (fd >= 0)
+      ::close(fd);
+  }
+
+  int fd;
+  std::string path;
+  std::vector<LinuxStatTarget> targets;
+};
+
+} // namespace
+
+LinuxMetadataCollector::LinuxMetadataCollector(
+    Engine::SearchIndex &index, const LinuxMetadataOptions &options)
+    : m_index(index), m_options(options) {
+  if (m_options.queueDepth == 0)
+    m_options.queueDepth = 1;
+  if (m_options.useIoUring && IoUringStatxWorks())
+    m_backend = Backend::IoUring;
+}
+
+LinuxMetadataCollector::~LinuxMetadataCollector() { Stop(); }
+
+decltype(LinuxScanOptions::onListed)
+LinuxMetadataCollector::ListingObserver() {
+  return [this](const std::string &path,
+                std::vector<LinuxStatTarget> children) {
+    Enqueue(path, std::move(children));
+  };
+}
+
+void LinuxMetadataCollector::Enqueue(std::string directoryPath,
+                                     std::vector<LinuxStatTarget> targets) {
+  {
+    std::lock_guard lock(m_queueMutex);
+    m_queue.push_back({std::move(directoryPath), std::move(targets)});
+  }
+  m_queueChanged.notify_one();
+}
+
+void LinuxMetadataCollector::Start() {
+  if (m_running)
+    return;
+  m_running = true;
+  m_error = nullptr;
+  m_thread = std::thread([this] {
+    try {
+      if (m_backend == Backend::IoUring) {
+        RunIoUring();
+      } else {
+        RunThreadPool();
+      }
+    } catch (...) {
+      m_error = std::current_exception();
+    }
+  });
+}
+
+void LinuxMetadataCollector::Wait() {
+  {
+    std::lock_guard lock(m_queueMutex);
+    m_draining = true;
+  }
+  m_queueChanged.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+  m_running = false;
+
+  {
+    std::lock_guard lock(m_queueMutex);
+    m_draining = false;
+  }
+  if (m_error)
+    std::rethrow_exception(std::exchange(m_error, nullptr));
+}
+
+void LinuxMetadataCollector::Stop() {
+  m_running = false;
+  m_queueChanged.notify_all();
+  if (m_thread.joinable())
+    m_thread.join();
+}
+
+bool LinuxMetadataCollector::PopJob(DirectoryJob &job, bool block) {
+  std::unique_lock lock(m_queueMutex);
+  if (block) {
+    m_queueChanged.wait(lock, [this] {
+      return !m_queue.empty() || m_draining || !m_running;
+    });
+  }
+  if (m_queue.empty() || !m_running)
+    return false;
+  job = std::move(m_queue.front());
+  m_queue.pop_front();
+  return true;
+}
+
+void LinuxMetadataCollector::Flush(std::vector<Engine::IndexChange> &results,
+                                   bool force) {
+  if (results.empty() || (!force && results.size() < m_options.flushSize))
+    return;
+  PULSEFS_TRACE_SCOPE("LinuxMetadataCollector::Flush");
+  m_index.ApplyBatch(results);
+  m_completed += results.size();
+  results.clear();
+}
+
+void LinuxMetadataCollector::RunIoUring() {
+  PULSEFS_TRACE_SCOPE("LinuxMetadataCollector::RunIoUring");
+  struct Slot {
+    std::shared_ptr<OpenDirectory> directory;
+    unsigned long long id = 0;
+    struct statx stx;
+  };
+
+  // Declared ahead of the ring so they outlive it: if the ring fails with
+  // requests in flight, the kernel may write into them until it is closed.
+  std::vector<Slot> slots;
+  std::shared_ptr<OpenDirectory> current;
+  size_t nextTarget = 0;
+
+  Ring ring;
+  if (!ring.Init(m_options.queueDepth)) {
+    RunThreadPool();
+    return;
+  }
+
+  const unsigned depth = ring.Capacity();
+  slots.resize(depth);
+  std::vector<unsigned> freeSlots;
+  for (unsigned i = depth; i-- > 0;)
+    freeSlots.push_back(i);
+
+  std::vector<Engine::IndexChange> results;
+  unsigned inFlight = 0;
+  bool ringFailed = false;
+
+  while (m_running) {
+    // Keep the ring full, moving on to the next directory as each one is
+    // exhausted; only block for new work when nothing is outstanding.
+    while (!freeSlots.empty()) {
+      if (!current || nextTarget == current->targets.size()) {
+        DirectoryJob job;
+        if (!PopJob(job, inFlight == 0))
+          break;
+        current = std::make_shared<OpenDirectory>(std::move(job.path),
+                                                  std::move(job.targets));
+        nextTarget = 0;
+        if (current->fd < 0) {
+          current.reset();
+          continue;
+        }
+      }
+
+      unsigned slotIndex = freeSlots.back();
+      freeSlots.pop_back();
+      Slot &slot = slots[slotIndex];
+      const LinuxStatTarget &target = current->targets[nextTarget++];
+      slot.directory = current;
+      slot.id = target.id;
+      ring.PrepareStatx(current->fd, target.name.c_str(), &slot.stx,
+                        slotIndex);
+      ++inFlight;
+    }
+
+    if (inFlight == 0) {
+      std::lock_guard lock(m_queueMutex);
+      if (m_queue.empty() && m_draining)
+        break;
+      continue;
+    }
+
+    if (!ring.Submit(1)) {
+      ringFailed = true;
+      break;
+    }
+    inFlight -= ring.Reap([&](unsigned long long userData, int res) {
+      Slot &slot = slots[userData];
+      if (res == 0)
+        results.push_back(MakeMetadataChange(slot.id, slot.stx));
+      slot.directory.reset();
+      freeSlots.push_back(static_cast<unsigned>(userData));
+    });
+    Flush(results, false);
+  }
+
+  // The kernel still owns the buffers of anything in flight.
+  while (inFlight > 0 && ring.Submit(1)) {
+    inFlight -= ring.Reap([&](unsigned long long userData, int res) {
+      if (res == 0 && m_running)
+        results.push_back(
+            MakeMetadataChange(slots[userData].id, slots[userData].stx));
+    });
+  }
+  Flush(results, true);
+  if (!ringFailed || !m_running)
+    return;
+
+  // Whatever the ring never took goes to the thread pool instead. Requests
+  // lost in flight are not retried.
+  if (current && nextTarget < current->targets.size()) {
+    std::vector<LinuxStatTarget> rest(
+        std::make_move_iterator(current->targets.begin() + nextTarget),
+        std::make_move_iterator(current->targets.end()));
+    std::lock_guard lock(m_queueMutex);
+    m_queue.push_front({current->path, std::move(rest)});
+  }
+  RunThreadPool();
+}
+
+void LinuxMetadataCollector::RunThreadPool() {
+  PULSEFS_TRACE_SCOPE("LinuxMetadataCollector::RunThreadPool");
+  Utils::WorkStealingPool pool(m_options.threads);
+  std::vector<std::vector<Engine::IndexChange>> results(pool.ThreadCount());
+
+  DirectoryJob job;
+  while (PopJob(job, true)) {
+    pool.Submit([this, &results, &pool, job = std::move(job)] {
+      OpenDirectory directory(job.path, {});
+      if (directory.fd < 0)
+        return;
+      auto &batch = results[pool.CurrentWorker()];
+      for (const auto &target : job.targets) {
+        struct statx stx;
+        if (::statx(directory.fd, target.name.c_str(), AT_SYMLINK_NOFOLLOW,
+                    kStatxMask, &stx) == 0) {
+          batch.push_back(MakeMetadataChange(target.id, stx));
+        }
+      }
+      Flush(batch, false);
+    });
+  }
+  pool.Wait();
+
+  for (auto &batch : results)
+    Flush(batch, true);
+}
+
+} // namespace PulseFS::Core
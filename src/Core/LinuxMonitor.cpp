@@ -0,0 +1,477 @@
+#include "PulseFS/Core/LinuxMonitor.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+#include <fcntl.h>
+#include <map>
+#include <poll.h>
+#include <sys/fanotify.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+namespace PulseFS::Core {
+
+namespace {
+
+constexpr uint64_t kFanotifyMask =
+    FAN_CREATE | FAN_DELETE | FAN_MOVED_FROM | FAN_MOVED_TO | FAN_ONDIR;
+constexpr uint32_t kInotifyMask = IN_CREATE | IN_DELETE | IN_MOVED_FROM |
+                                  IN_MOVED_TO | IN_ONLYDIR | IN_DONT_FOLLOW |
+                                  IN_EXCL_UNLINK;
+constexpr size_t kReadBufferSize = 64 * 1024;
+constexpr size_t kMaxBatchEvents = 65536;
+
+std::string JoinPath(const std::string &directory, const std::string &name) {
+  return directory.back() == '/' ? directory + name : directory + '/' + name;
+}
+
+bool SameTime(const struct timespec &a, const struct timespec &b) {
+  return a.tv_sec == b.tv_sec && a.tv_nsec == b.tv_nsec;
+}
+
+} // namespace
+
+LinuxMonitor::LinuxMonitor(Engine::SearchIndex &index) : m_index(index) {}
+
+LinuxMonitor::~LinuxMonitor() {
+  Stop();
+  if (m_notifyFd >= 0)
+    ::close(m_notifyFd);
+  if (m_rootFd >= 0)
+    ::close(m_rootFd);
+}
+
+bool LinuxMonitor::Open(const std::string &rootPath) {
+  m_rootPath = rootPath;
+  while (m_rootPath.size() > 1 && m_rootPath.back() == '/')
+    m_rootPath.pop_back();
+
+  m_rootFd = ::open(m_rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (m_rootFd < 0)
+    return false;
+
+  int fd = ::fanotify_init(FAN_CLASS_NOTIF | FAN_REPORT_DFID_NAME |
+                               FAN_CLOEXEC | FAN_NONBLOCK,
+                           O_RDONLY | O_LARGEFILE);
+  if (fd >= 0) {
+    if (::fanotify_mark(fd, FAN_MARK_ADD | FAN_MARK_FILESYSTEM, kFanotifyMask,
+                        AT_FDCWD, m_rootPath.c_str()) == 0) {
+      m_notifyFd = fd;
+      m_backend = Backend::Fanotify;
+      return true;
+    }
+    ::close(fd);
+  }
+
+  fd = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (fd < 0)
+    return false;
+  m_notifyFd = fd;
+  m_backend = Backend::Inotify;
+  return true;
+}
+
+decltype(LinuxScanOptions::onDirectory) LinuxMonitor::DirectoryObserver() {
+  return [this](const std::string &path, unsigned long long id,
+                const struct stat &st) { ObserveDirectory(path, id, st); };
+}
+
+void LinuxMonitor::ObserveDirectory(const std::string &path,
+                                    unsigned long long id,
+                                    const struct stat &st) {
+  std::lock_guard lock(m_directoryMutex);
+  DirectoryState &state = m_directories[id];
+  state.mtime = st.st_mtim;
+
+  if (m_backend == Backend::Inotify && state.watch < 0) {
+    int watch = ::inotify_add_watch(m_notifyFd, path.c_str(), kInotifyMask);
+    if (watch >= 0) {
+      state.watch = watch;
+      m_watches[watch] = id;
+    }
+  }
+}
+
+bool LinuxMonitor::IsTracked(unsigned long long directoryId) {
+  std::lock_guard lock(m_directoryMutex);
+  return m_directories.count(directoryId) != 0;
+}
+
+std::string LinuxMonitor::DirectoryPath(unsigned long long directoryId) const {
+  return Utils::Utf8FromWide(m_index.GetFullPath(directoryId));
+}
+
+void LinuxMonitor::Start() {
+  if (m_backend == Backend::None || m_running)
+    return;
+  m_running = true;
+  m_thread = std::thread(&LinuxMonitor::MonitorLoop, this);
+}
+
+void LinuxMonitor::Stop() {
+  m_running = false;
+  if (m_thread.joinable()) {
+    m_thread.join();
+  }
+}
+
+LinuxMonitorStats LinuxMonitor::GetStats() const {
+  LinuxMonitorStats stats;
+  stats.events = m_events;
+  stats.batches = m_batches;
+  stats.overflows = m_overflows;
+  stats.rescannedDirectories = m_rescannedDirectories;
+  stats.lastApplyLatencyUs = m_lastApplyLatencyUs;
+  stats.maxApplyLatencyUs = m_maxApplyLatencyUs;
+  return stats;
+}
+
+void LinuxMonitor::MonitorLoop() {
+  std::vector<ObservedEvent> events;
+
+  while (m_running) {
+    pollfd pfd{m_notifyFd, POLLIN, 0};
+    if (::poll(&pfd, 1, 100) <= 0)
+      continue;
+
+    auto polledAt = std::chrono::steady_clock::now();
+    events.clear();
+    if (m_backend == Backend::Fanotify) {
+      ReadFanotify(events);
+    } else {
+      ReadInotify(events);
+    }
+
+    m_events += events.size();
+    if (!events.empty()) {
+      ApplyEvents(events);
+      for (auto id : m_dirtyDirectories) {
+        if (IsTracked(id))
+          RescanDirectory(id, DirectoryPath(id));
+      }
+      m_dirtyDirectories.clear();
+      RecordApplyLatency(polledAt);
+    }
+
+    if (m_overflowed) {
+      m_overflowed = false;
+      m_overflows++;
+      RescanChangedDirectories();
+    }
+  }
+}
+
+void LinuxMonitor::ReadFanotify(std::vector<ObservedEvent> &events) {
+  alignas(fanotify_event_metadata) char buffer[kReadBufferSize];
+
+  while (events.size() < kMaxBatchEvents) {
+    ssize_t length = ::read(m_notifyFd, buffer, sizeof(buffer));
+    if (length <= 0)
+      break;
+
+    auto *metadata = reinterpret_cast<fanotify_event_metadata *>(buffer);
+    for (; FAN_EVENT_OK(metadata, length);
+         metadata = FAN_EVENT_NEXT(metadata, length)) {
+      if (metadata->vers != FANOTIFY_METADATA_VERSION)
+        continue;
+      if (metadata->mask & FAN_Q_OVERFLOW) {
+        m_overflowed = true;
+        continue;
+      }
+
+      auto *info = reinterpret_cast<fanotify_event_info_fid *>(
+          reinterpret_cast<char *>(metadata) + metadata->metadata_len);
+      if (info->hdr.info_type != FAN_EVENT_INFO_TYPE_DFID_NAME)
+        continue;
+
+      auto *handle = reinterpret_cast<file_handle *>(info->handle);
+      std::string name(
+          reinterpret_cast<const char *>(handle->f_handle + handle->handle_bytes));
+
+      int directoryFd =
+          ::open_by_handle_at(m_rootFd, handle, O_PATH | O_CLOEXEC);
+      if (directoryFd < 0)
+        continue;
+
+      struct stat directoryStat;
+      if (::fstat(directoryFd, &directoryStat) != 0 ||
+          !IsTracked(directoryStat.st_ino)) {
+        ::close(directoryFd);
+        continue;
+      }
+
+      // fanotify may merge several changes to the same name into one event;
+      // removals are emitted first and creations are confirmed by stat.
+      const unsigned long long directoryId = directoryStat.st_ino;
+      const bool isDirectory = (metadata->mask & FAN_ONDIR) != 0;
+      if (metadata->mask & FAN_DELETE)
+        events.push_back({EventKind::Delete, directoryId, name, isDirectory});
+      if (metadata->mask & FAN_MOVED_FROM)
+        events.push_back({EventKind::MovedFrom, directoryId, name, isDirectory});
+
+      if (metadata->mask & (FAN_CREATE | FAN_MOVED_TO)) {
+        ObservedEvent event{(metadata->mask & FAN_CREATE) ? EventKind::Create
+                                                          : EventKind::MovedTo,
+                            directoryId, name, isDirectory};
+        event.exists = ::fstatat(directoryFd, name.c_str(), &event.st,
+                                 AT_SYMLINK_NOFOLLOW) == 0;
+        events.push_back(std::move(event));
+      }
+      ::close(directoryFd);
+    }
+  }
+}
+
+void LinuxMonitor::ReadInotify(std::vector<ObservedEvent> &events) {
+  alignas(inotify_event) char buffer[kReadBufferSize];
+
+  while (events.size() < kMaxBatchEvents) {
+    ssize_t length = ::read(m_notifyFd, buffer, sizeof(buffer));
+    if (length <= 0)
+      break;
+
+    for (ssize_t offset = 0; offset < length;) {
+      const auto *event = reinterpret_cast<const inotify_event *>(buffer + offset);
+      offset += sizeof(inotify_event) + event->len;
+
+      if (event->mask & IN_Q_OVERFLOW) {
+        m_overflowed = true;
+        continue;
+      }
+
+      unsigned long long directoryId = 0;
+      {
+        std::lock_guard lock(m_directoryMutex);
+        auto it = m_watches.find(event->wd);
+        if (it == m_watches.end())
+          continue;
+        directoryId = it->second;
+        if (event->mask & IN_IGNORED) {
+          if (auto dir = m_directories.find(directoryId);
+              dir != m_directories.end() && dir->second.watch == event->wd) {
+            dir->second.watch = -1;
+          }
+          m_watches.erase(it);
+          continue;
+        }
+      }
+      if (event->len == 0)
+        continue;
+
+      std::string name(event->name);
+      const bool isDirectory = (event->mask & IN_ISDIR) != 0;
+      if (event->mask & (IN_DELETE | IN_MOVED_FROM)) {
+        events.push_back({(event->mask & IN_DELETE) ? EventKind::Delete
+                                                    : EventKind::MovedFrom,
+                          directoryId, std::move(name), isDirectory});
+      } else if (event->mask & (IN_CREATE | IN_MOVED_TO)) {
+        ObservedEvent observed{(event->mask & IN_CREATE) ? EventKind::Create
+                                                         : EventKind::MovedTo,
+                               directoryId, std::move(name), isDirectory};
+        std::string path = JoinPath(DirectoryPath(directoryId), observed.name);
+        observed.exists =
+            ::fstatat(AT_FDCWD, path.c_str(), &observed.st,
+                      AT_SYMLINK_NOFOLLOW) == 0;
+        // The directory may have been renamed by an event in this same read,
+        // so its indexed path is stale; list it again once the batch lands.
+        if (!observed.exists)
+          m_dirtyDirectories.insert(directoryId);
+        events.push_back(std::move(observed));
+      }
+    }
+  }
+}
+
+void LinuxMonitor::ApplyEvents(std::vector<ObservedEvent> &events) {
+  std::vector<std::optional<unsigned long long>> ids(events.size());
+  std::map<std::pair<unsigned long long, std::string>, unsigned long long>
+      namedInBatch;
+  std::vector<Engine::ChildKey> unresolvedKeys;
+  std::vector<size_t> unresolvedEvents;
+
+  for (size_t i = 0; i < events.size(); ++i) {
+    const ObservedEvent &event = events[i];
+    auto key = std::make_pair(event.directoryId, event.name);
+
+    if (event.kind == EventKind::Delete || event.kind == EventKind::MovedFrom) {
+      if (auto it = namedInBatch.find(key); it != namedInBatch.end()) {
+        ids[i] = it->second;
+        namedInBatch.erase(it);
+      } else {
+        unresolvedKeys.push_back(
+            {event.directoryId, Utils::WideFromUtf8(event.name)});
+        unresolvedEvents.push_back(i);
+      }
+    } else if (event.exists) {
+      ids[i] = event.st.st_ino;
+      namedInBatch[key] = event.st.st_ino;
+    }
+  }
+
+  auto resolved = m_index.FindChildren(unresolvedKeys);
+  for (size_t k = 0; k < resolved.size(); ++k) {
+    ids[unresolvedEvents[k]] = resolved[k];
+  }
+
+  std::vector<Engine::IndexChange> changes;
+  std::unordered_map<unsigned long long, size_t> changeById;
+  for (size_t i = 0; i < events.size(); ++i) {
+    if (!ids[i])
+      continue;
+    const ObservedEvent &event = events[i];
+    const unsigned long long id = *ids[i];
+
+    Engine::IndexChange change;
+    if (event.kind == EventKind::Delete || event.kind == EventKind::MovedFrom) {
+      change = {Engine::ChangeKind::Remove,
+                {L"", id, event.directoryId,
+                 event.isDirectory ? Engine::kAttributeDirectory : 0, true}};
+    } else {
+      change = {Engine::ChangeKind::Insert,
+                {Utils::WideFromUtf8(event.name), id, event.directoryId,
+                 LinuxScanner::AttributesFromMode(event.name.c_str(),
+                                                  event.st.st_mode),
+                 true, static_cast<unsigned long long>(event.st.st_size),
+                 Engine::FileTimeFromUnix(event.st.st_mtim.tv_sec,
+                                          event.st.st_mtim.tv_nsec)}};
+    }
+
+    if (auto it = changeById.find(id); it != changeById.end()) {
+      changes[it->second] = std::move(change);
+    } else {
+      changeById.emplace(id, changes.size());
+      changes.push_back(std::move(change));
+    }
+  }
+
+  std::vector<unsigned long long> newDirectories;
+  const size_t directChanges = changes.size();
+  for (size_t i = 0; i < directChanges; ++i) {
+    const auto &entry = changes[i].entry;
+    if (!(entry.fileAttributes & Engine::kAttributeDirectory))
+      continue;
+    if (changes[i].kind == Engine::ChangeKind::Remove) {
+      RemoveSubtree(entry.id, changes, changeById);
+    } else if (!IsTracked(entry.id)) {
+      newDirectories.push_back(entry.id);
+    }
+  }
+
+  m_index.ApplyBatch(changes);
+  m_batches++;
+
+  for (auto id : newDirectories) {
+    ScanNewDirectory(id);
+  }
+}
+
+void LinuxMonitor::RemoveSubtree(
+    unsigned long long id, std::vector<Engine::IndexChange> &changes,
+    const std::unordered_map<unsigned long long, size_t> &changeById) {
+  std::vector<unsigned long long> pending{id};
+  while (!pending.empty()) {
+    unsigned long long directoryId = pending.back();
+    pending.pop_back();
+
+    {
+      std::lock_guard lock(m_directoryMutex);
+      if (auto it = m_directories.find(directoryId);
+          it != m_directories.end()) {
+        if (it->second.watch >= 0) {
+          ::inotify_rm_watch(m_notifyFd, it->second.watch);
+          m_watches.erase(it->second.watch);
+        }
+        m_directories.erase(it);
+      }
+    }
+
+    for (auto &child : m_index.GetChildren(directoryId)) {
+      // The batch already says where it went, as for `mv a/x b/x; rmdir a`:
+      // leave it and its subtree, watches included, to that change.
+      if (changeById.count(child.id))
+        continue;
+      if (child.fileAttributes & Engine::kAttributeDirectory)
+        pending.push_back(child.id);
+      changes.push_back({Engine::ChangeKind::Remove, std::move(child)});
+    }
+  }
+}
+
+void LinuxMonitor::ScanNewDirectory(unsigned long long id) {
+  if (!m_scanPool)
+    m_scanPool = std::make_unique<Utils::WorkStealingPool>(1);
+  LinuxScanOptions options;
+  options.pool = m_scanPool.get();
+  options.onDirectory = DirectoryObserver();
+  LinuxScanner::ScanSubtree(m_index, DirectoryPath(id), id, options);
+}
+
+void LinuxMonitor::RescanChangedDirectories() {
+  std::vector<std::pair<unsigned long long, struct timespec>> known;
+  {
+    std::lock_guard lock(m_directoryMutex);
+    known.reserve(m_directories.size());
+    for (const auto &[id, state] : m_directories)
+      known.emplace_back(id, state.mtime);
+  }
+
+  for (const auto &[id, mtime] : known) {
+    std::string path = DirectoryPath(id);
+    struct stat st;
+    if (::stat(path.c_str(), &st) != 0 || st.st_ino != id)
+      continue;
+    if (SameTime(st.st_mtim, mtime))
+      continue;
+
+    {
+      std::lock_guard lock(m_directoryMutex);
+      if (auto it = m_directories.find(id); it != m_directories.end())
+        it->second.mtime = st.st_mtim;
+    }
+    RescanDirectory(id, path);
+  }
+}
+
+void LinuxMonitor::RescanDirectory(unsigned long long id,
+                                   const std::string &path) {
+  auto current = LinuxScanner::ListDirectory(path, id);
+  auto existing = m_index.GetChildren(id);
+
+  std::vector<Engine::IndexChange> changes;
+  std::unordered_map<unsigned long long, size_t> currentIds;
+  std::vector<unsigned long long> newDirectories;
+  for (auto &entry : current) {
+    currentIds.emplace(entry.id, changes.size());
+    if ((entry.fileAttributes & Engine::kAttributeDirectory) &&
+        !IsTracked(entry.id)) {
+      newDirectories.push_back(entry.id);
+    }
+    changes.push_back({Engine::ChangeKind::Insert, std::move(entry)});
+  }
+
+  for (auto &entry : existing) {
+    if (currentIds.count(entry.id))
+      continue;
+    if (entry.fileAttributes & Engine::kAttributeDirectory)
+      RemoveSubtree(entry.id, changes, currentIds);
+    changes.push_back({Engine::ChangeKind::Remove, std::move(entry)});
+  }
+
+  m_index.ApplyBatch(changes);
+  m_rescannedDirectories++;
+
+  for (auto child : newDirectories) {
+    ScanNewDirectory(child);
+  }
+}
+
+void LinuxMonitor::RecordApplyLatency(
+    std::chrono::steady_clock::time_point polledAt) {
+  double latencyUs = std::chrono::duration<double, std::micro>(
+                         std::chrono::steady_clock::now() - polledAt)
+                         .count();
+  m_lastApplyLatencyUs = latencyUs;
+  if (latencyUs > m_maxApplyLatencyUs)
+    m_maxApplyLatencyUs = latencyUs;
+}
+
+} // namespace PulseFS::Core
@@ -0,0 +1,285 @@
+#include "PulseFS/Core/LinuxScanner.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+#include "PulseFS/Utils/WorkStealingPool.hpp"
+#include <atomic>
+#include <cstring>
+#include <dirent.h>
+#include <exception>
+#include <fcntl.h>
+#include <mutex>
+#include <optional>
+#include <stdexcept>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <vector>
+
+namespace PulseFS::Core {
+
+namespace {
+
+struct LinuxDirent64 {
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[1];
+};
+
+constexpr size_t kDirentBufferSize = 256 * 1024;
+
+bool IsDotOrDotDot(const char *name) {
+  return name[0] == '.' &&
+         (name[1] == '\0' || (name[1] == '.' && name[2] == '\0'));
+}
+
+// Fills entry from a dirent; returns false if the entry vanished meanwhile.
+bool MakeEntry(int directoryFd, const LinuxDirent64 *dirent,
+               unsigned long long directoryId, Engine::FileEntry &entry,
+               bool &isDirectory) {
+  const char *name = dirent->d_name;
+  mode_t mode = DTTOIF(dirent->d_type);
+  if (dirent->d_type == DT_UNKNOWN) {
+    struct stat st;
+    if (::fstatat(directoryFd, name, &st, AT_SYMLINK_NOFOLLOW) != 0)
+      return false;
+    mode = st.st_mode;
+  }
+
+  entry = {Utils::WideFromUtf8(name), dirent->d_ino, directoryId,
+           LinuxScanner::AttributesFromMode(name, mode), true};
+  isDirectory = S_ISDIR(mode);
+  return true;
+}
+
+class TreeWalk {
+public:
+  TreeWalk(Engine::SearchIndex &index, std::string rootPath, int rootFd,
+           dev_t rootDevice, const LinuxScanOptions &options)
+      : m_rootPath(std::move(rootPath)), m_rootFd(rootFd),
+        m_rootDevice(rootDevice),
+        m_options(options),
+        m_pool(options.pool ? *options.pool
+                            : m_ownPool.emplace(options.threads)),
+        m_publisher(index, m_pool.ThreadCount(), options.progress,
+                    options.batchSize) {}
+
+  size_t Run(unsigned long long rootId) {
+    m_pool.Submit([this, rootId] { ScanDirectory(std::string(), rootId); });
+    // What was found before a task failed is still published.
+    std::exception_ptr error;
+    try {
+      m_pool.Wait();
+    } catch (...) {
+      error = std::current_exception();
+    }
+    m_publisher.Finish();
+    if (error)
+      std::rethrow_exception(error);
+    return m_entries.load();
+  }
+
+private:
+  void ScanDirectory(const std::string &relativePath,
+                     unsigned long long directoryId) {
+    int fd = ::openat(m_rootFd, relativePath.empty() ? "." : relativePath.c_str(),
+                      O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+    if (fd < 0)
+      return;
+
+    struct stat st;
+    if ((m_options.stayOnFileSystem || m_options.onDirectory) &&
+        ::fstat(fd, &st) != 0) {
+      ::close(fd);
+      return;
+    }
+    if (m_options.stayOnFileSystem && st.st_dev != m_rootDevice) {
+      ::close(fd);
+      return;
+    }
+    std::string path;
+    if (m_options.onDirectory || m_options.onListed) {
+      path = m_rootPath;
+      if (!relativePath.empty()) {
+        if (path.back() != '/')
+          path += '/';
+        path += relativePath;
+      }
+    }
+    if (m_options.onDirectory)
+      m_options.onDirectory(path, directoryId, st);
+
+    thread_local std::vector<char> buffer(kDirentBufferSize);
+    const size_t worker = m_pool.CurrentWorker();
+    std::vector<LinuxStatTarget> listed;
+
+    while (true) {
+      long bytes = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+      if (bytes <= 0)
+        break;
+
+      for (long offset = 0; offset < bytes;) {
+        const auto *dirent =
+            reinterpret_cast<const LinuxDirent64 *>(buffer.data() + offset);
+        offset += dirent->d_reclen;
+
+        if (IsDotOrDotDot(dirent->d_name))
+          continue;
+
+        Engine::FileEntry entry;
+        bool isDirectory = false;
+        if (!MakeEntry(fd, dirent, directoryId, entry, isDirectory))
+          continue;
+
+        m_publisher.Add(worker, std::move(entry));
+        m_entries.fetch_add(1, std::memory_order_relaxed);
+        if (m_options.onListed)
+          listed.push_back({dirent->d_ino, dirent->d_name});
+
+        if (isDirectory) {
+          const char *name = dirent->d_name;
+          std::string childPath =
+              relativePath.empty() ? std::string(name)
+                                   : relativePath + '/' + name;
+          unsigned long long childId = dirent->d_ino;
+          m_pool.Submit([this, childPath = std::move(childPath), childId] {
+            ScanDirectory(childPath, childId);
+          });
+        }
+      }
+
+      m_publisher.Poll(worker);
+    }
+
+    ::close(fd);
+    if (m_options.onListed && !listed.empty())
+      m_options.onListed(path, std::move(listed));
+  }
+
+  std::string m_rootPath;
+  int m_rootFd;
+  dev_t m_rootDevice;
+  LinuxScanOptions m_options;
+  std::optional<Utils::WorkStealingPool> m_ownPool;
+  Utils::WorkStealingPool &m_pool;
+  ScanPublisher m_publisher;
+  std::atomic<size_t> m_entries = 0;
+};
+
+} // namespace
+
+unsigned long LinuxScanner::AttributesFromMode(const char *name, mode_t mode) {
+  unsigned long attributes = 0;
+  if (S_ISDIR(mode))
+    attributes |= Engine::kAttributeDirectory;
+  if (S_ISLNK(mode))
+    attributes |= Engine::kAttributeReparsePoint;
+  if (name[0] == '.')
+    attributes |= Engine::kAttributeHidden;
+  return attributes;
+}
+
+size_t LinuxScanner::Enumerate(Engine::SearchIndex &index,
+                               const std::string &rootPath,
+                               const LinuxScanOptions &options) {
+  PULSEFS_TRACE_SCOPE("LinuxScanner::Enumerate");
+  int rootFd = ::open(rootPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (rootFd < 0) {
+    throw std::runtime_error("Failed to open directory for scanning.");
+  }
+
+  struct stat rootStat;
+  if (::fstat(rootFd, &rootStat) != 0) {
+    ::close(rootFd);
+    throw std::runtime_error("Failed to stat scan root.");
+  }
+
+  std::string prefix = rootPath;
+  if (prefix.empty() || prefix.back() != '/')
+    prefix += '/';
+  std::string rootName = prefix.substr(0, prefix.size() - 1);
+  rootName = rootName.substr(rootName.find_last_of('/') + 1);
+
+  index.SetIdScheme(Engine::IdScheme::Opaque);
+  index.SetPathFormat(Utils::WideFromUtf8(prefix), L'/');
+  index.Insert({Utils::WideFromUtf8(rootName), rootStat.st_ino,
+                rootStat.st_ino, Engine::kAttributeDirectory, true});
+
+  size_t entries = 0;
+  index.BeginBulkLoad();
+  try {
+    TreeWalk walk(index, rootPath, rootFd, rootStat.st_dev, options);
+    entries = walk.Run(rootStat.st_ino);
+  } catch (...) {
+    index.EndBulkLoad();
+    ::close(rootFd);
+    throw;
+  }
+  index.EndBulkLoad();
+
+  ::close(rootFd);
+  return entries;
+}
+
+size_t LinuxScanner::ScanSubtree(Engine::SearchIndex &index,
+                                 const std::string &directoryPath,
+                                 unsigned long long directoryId,
+                                 const LinuxScanOptions &options) {
+  int rootFd =
+      ::open(directoryPath.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (rootFd < 0)
+    return 0;
+
+  size_t entries = 0;
+  struct stat rootStat;
+  if (::fstat(rootFd, &rootStat) == 0) {
+    try {
+      TreeWalk walk(index, directoryPath, rootFd, rootStat.st_dev, options);
+      entries = walk.Run(directoryId);
+    } catch (...) {
+      ::close(rootFd);
+      throw;
+    }
+  }
+
+  ::close(rootFd);
+  return entries;
+}
+
+std::vector<Engine::FileEntry>
+LinuxScanner::ListDirectory(const std::string &directoryPath,
+                            unsigned long long directoryId) {
+  std::vector<Engine::FileEntry> entries;
+  int fd = ::open(directoryPath.c_str(),
+                  O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+  if (fd < 0)
+    return entries;
+
+  std::vector<char> buffer(kDirentBufferSize);
+  while (true) {
+    long bytes = ::syscall(SYS_getdents64, fd, buffer.data(), buffer.size());
+    if (bytes <= 0)
+      break;
+
+    for (long offset = 0; offset < bytes;) {
+      const auto *dirent =
+          reinterpret_cast<const LinuxDirent64 *>(buffer.data() + offset);
+      offset += dirent->d_reclen;
+
+      if (IsDotOrDotDot(dirent->d_name))
+        continue;
+
+      Engine::FileEntry entry;
+      bool isDirectory = false;
+      if (MakeEntry(fd, dirent, directoryId, entry, isDirectory))
+        entries.push_back(std::move(entry));
+    }
+  }
+
+  ::close(fd);
+  return entries;
+}
+
+} // namespace PulseFS::Core
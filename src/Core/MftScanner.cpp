@@ -1,14 +1,192 @@
 #include "PulseFS/Core/MftScanner.hpp"
+#include "PulseFS/Utils/Trace.hpp"
 #include "PulseFS/Utils/WinHelpers.hpp"
+#include "PulseFS/Utils/WorkStealingPool.hpp"
+#include <algorithm>
+#include <atomic>
+#include <exception>
 #include <iostream>
+#include <string_view>
+#include <thread>
 #include <vector>
 #include <windows.h>
 #include <winioctl.h>
 
 namespace PulseFS::Core {
 
+namespace {
+
+constexpr DWORD kBufferBytes = 65536;
+constexpr DWORDLONG kRecordMask = 0x0000FFFFFFFFFFFFull;
+// Below this many records a thread, another volume handle and enumeration
+// cost more than they save.
+constexpr DWORDLONG kMinRecordsPerThread = DWORDLONG(1) << 18;
+
+// File records the MFT has room for, in use or not; 0 if the volume will
+// not say.
+DWORDLONG MftRecordCount(HANDLE volume) {
+  NTFS_VOLUME_DATA_BUFFER data = {0};
+  DWORD bytesReturned = 0;
+  if (!::DeviceIoControl(volume, FSCTL_GET_NTFS_VOLUME_DATA, NULL, 0, &data,
+                         sizeof(data), &bytesReturned, NULL) ||
+      data.BytesPerFileRecordSegment == 0)
+    return 0;
+  return static_cast<DWORDLONG>(data.MftValidDataLength.QuadPart) /
+         data.BytesPerFileRecordSegment;
+}
+
+// Feeds the records numbered [first, end) to `publisher` as `worker`. Each
+// range opens its own handle, since I/O on one synchronous handle is
+// serialized.
+void EnumerateRange(const std::wstring &volumePath, USN highUsn,
+                    DWORDLONG first, DWORDLONG end, ScanPublisher &publisher,
+                    size_t worker) {
+  Utils::Trace::SetThreadName("MFT scan");
+  auto hVol = Utils::OpenVolume(volumePath);
+  if (!hVol) {
+    throw std::runtime_error("Failed to open volume for MFT scanning.");
+  }
+
+  MFT_ENUM_DATA med = {0};
+  med.StartFileReferenceNumber = first;
+  med.LowUsn = 0;
+  med.HighUsn = highUsn;
+  med.MinMajorVersion = 2;
+  med.MaxMajorVersion = 2;
+
+  std::vector<char> buffer(kBufferBytes);
+  DWORD bytesReturned = 0;
+  bool finished = false;
+
+  while (!finished) {
+    BOOL enumerated;
+    {
+      PULSEFS_TRACE_SCOPE("FSCTL_ENUM_USN_DATA");
+      enumerated =
+          ::DeviceIoControl(hVol.get(), FSCTL_ENUM_USN_DATA, &med, sizeof(med),
+                            &buffer[0], kBufferBytes, &bytesReturned, NULL);
+    }
+    if (!enumerated)
+      break;
+
+    PULSEFS_TRACE_SPAN(insertSpan, "MftScanner::InsertRecords");
+    size_t fileCount = 0;
+
+    DWORDLONG *pNextFileRef = (DWORDLONG *)&buffer[0];
+    med.StartFileReferenceNumber = *pNextFileRef;
+
+    DWORD offset = sizeof(DWORDLONG);
+    while (offset < bytesReturned) {
+      PUSN_RECORD_V2 pRecord = (PUSN_RECORD_V2)(&buffer[offset]);
+      offset += pRecord->RecordLength;
+
+      // Records come in record-number order; the next range starts here.
+      if ((pRecord->FileReferenceNumber & kRecordMask) >= end) {
+        finished = true;
+        break;
+      }
+
+      std::wstring fileName(pRecord->FileName,
+                            pRecord->FileNameLength / sizeof(WCHAR));
+      if (!fileName.empty()) {
+        publisher.Add(worker, {std::move(fileName),
+                               pRecord->FileReferenceNumber,
+                               pRecord->ParentFileReferenceNumber,
+                               pRecord->FileAttributes, true});
+        fileCount++;
+      }
+    }
+    insertSpan.SetArg("records", fileCount);
+    publisher.Poll(worker);
+  }
+}
+
+// Lists directories by file reference from the root down, turning each
+// listing's sizes and times into SetMetadata changes.
+class MetadataWalk {
+public:
+  MetadataWalk(Engine::SearchIndex &index, HANDLE volume, size_t threads)
+      : m_index(index), m_volume(volume), m_pool(threads),
+        m_batches(m_pool.ThreadCount()) {}
+
+  size_t Run(unsigned long long rootId) {
+    m_pool.Submit([this, rootId] { ListDirectory(rootId); });
+    m_pool.Wait();
+    for (auto &batch : m_batches)
+      Flush(batch);
+    return m_updated.load();
+  }
+
+private:
+  static constexpr size_t kFlushSize = 4096;
+
+  void ListDirectory(unsigned long long directoryId) {
+    auto directory =
+        Utils::OpenFileByReference(m_volume, directoryId, FILE_LIST_DIRECTORY);
+    if (!directory)
+      return;
+
+    auto &batch = m_batches[m_pool.CurrentWorker()];
+    std::vector<char> buffer(kBufferBytes);
+    FILE_INFO_BY_HANDLE_CLASS infoClass = FileIdBothDirectoryRestartInfo;
+    while (::GetFileInformationByHandleEx(directory.get(), infoClass,
+                                          buffer.data(), kBufferBytes)) {
+      infoClass = FileIdBothDirectoryInfo;
+      size_t offset = 0;
+      while (true) {
+        const auto *info =
+            reinterpret_cast<const FILE_ID_BOTH_DIR_INFO *>(&buffer[offset]);
+        const std::wstring_view name(info->FileName,
+                                     info->FileNameLength / sizeof(WCHAR));
+        if (name != L"." && name != L"..") {
+          const auto id = static_cast<unsigned long long>(info->FileId.QuadPart);
+          const bool isDirectory =
+              (info->FileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0;
+          Engine::IndexChange change{Engine::ChangeKind::SetMetadata, {}};
+          change.entry.id = id;
+          change.entry.size =
+              isDirectory ? 0
+                          : static_cast<unsigned long long>(
+                                info->EndOfFile.QuadPart);
+          change.entry.lastWriteTime = info->LastWriteTime.QuadPart;
+          batch.push_back(std::move(change));
+          // Junctions lead back into the volume, where the target is listed
+          // anyway.
+          if (isDirectory &&
+              !(info->FileAttributes & FILE_ATTRIBUTE_REPARSE_POINT))
+            m_pool.Submit([this, id] { ListDirectory(id); });
+        }
+        if (info->NextEntryOffset == 0)
+          break;
+        offset += info->NextEntryOffset;
+      }
+    }
+    if (batch.size() >= kFlushSize)
+      Flush(batch);
+  }
+
+  void Flush(std::vector<Engine::IndexChange> &batch) {
+    if (batch.empty())
+      return;
+    PULSEFS_TRACE_SCOPE("MftScanner::CollectMetadata flush");
+    m_index.ApplyBatch(batch);
+    m_updated += batch.size();
+    batch.clear();
+  }
+
+  Engine::SearchIndex &m_index;
+  HANDLE m_volume;
+  Utils::WorkStealingPool m_pool;
+  std::vector<std::vector<Engine::IndexChange>> m_batches;
+  std::atomic<size_t> m_updated = 0;
+};
+
+} // namespace
+
 long long MftScanner::Enumerate(Engine::SearchIndex &index,
-                                const std::wstring &volumePath) {
+                                const std::wstring &volumePath,
+                                ScanProgress *progress, size_t threads) {
+  PULSEFS_TRACE_SCOPE("MftScanner::Enumerate");
 
   auto hVol = Utils::OpenVolume(volumePath);
   if (!hVol) {
@@ -25,49 +203,68 @@ long long MftScanner::Enumerate(Engine::SearchIndex &index,
 
   USN nextUsn = journalData.NextUsn;
 
-  MFT_ENUM_DATA med = {0};
-  med.StartFileReferenceNumber = 0;
-  med.LowUsn = 0;
-  med.HighUsn = nextUsn;
-  med.MinMajorVersion = 2;
-  med.MaxMajorVersion = 2;
-
-  const int BUF_LEN = 65536;
-  std::vector<char> buffer(BUF_LEN);
+  // The MFT is split into equal record ranges, one per thread; the last
+  // range is open-ended in case the MFT grows meanwhile.
+  const DWORDLONG records = MftRecordCount(hVol.get());
+  if (threads == 0)
+    threads = (std::max)(1u, std::thread::hardware_concurrency());
+  threads = static_cast<size_t>(
+      std::clamp<DWORDLONG>(records / kMinRecordsPerThread, 1, threads));
+  const DWORDLONG span = (records + threads - 1) / threads;
 
   index.Reserve(2000000);
+  index.BeginBulkLoad();
 
-  bool finished = false;
-  size_t fileCount = 0;
-
-  while (!finished) {
-    if (::DeviceIoControl(hVol.get(), FSCTL_ENUM_USN_DATA, &med, sizeof(med),
-                          &buffer[0], BUF_LEN, &bytesReturned, NULL)) {
-
-      DWORDLONG *pNextFileRef = (DWORDLONG *)&buffer[0];
-      med.StartFileReferenceNumber = *pNextFileRef;
-
-      DWORD offset = sizeof(DWORDLONG);
-      while (offset < bytesReturned) {
-        PUSN_RECORD_V2 pRecord = (PUSN_RECORD_V2)(&buffer[offset]);
-
-        std::wstring fileName(pRecord->FileName,
-                              pRecord->FileNameLength / sizeof(WCHAR));
-        if (!fileName.empty()) {
-          index.Insert({std::move(fileName), pRecord->FileReferenceNumber,
-                        pRecord->ParentFileReferenceNumber, 
-                        pRecord->FileAttributes, true});
-          fileCount++;
-        }
-
-        offset += pRecord->RecordLength;
+  ScanPublisher publisher(index, threads, progress);
+  std::vector<std::exception_ptr> errors(threads);
+  std::vector<std::thread> workers;
+  for (size_t i = 0; i < threads; ++i) {
+    const DWORDLONG first = i * span;
+    const DWORDLONG end = i + 1 == threads ? kRecordMask + 1 : first + span;
+    workers.emplace_back([&, i, first, end] {
+      try {
+        EnumerateRange(volumePath, nextUsn, first, end, publisher, i);
+      } catch (...) {
+        errors[i] = std::current_exception();
       }
-    } else {
+    });
+  }
+  for (auto &worker : workers)
+    worker.join();
 
-      finished = true;
-    }
+  publisher.Finish();
+  index.EndBulkLoad();
+  for (const auto &error : errors) {
+    if (error)
+      std::rethrow_exception(error);
   }
 
   return nextUsn;
 }
+
+size_t MftScanner::CollectMetadata(Engine::SearchIndex &index,
+                                   const std::wstring &volumePath,
+                                   size_t threads) {
+  PULSEFS_TRACE_SCOPE("MftScanner::CollectMetadata");
+  auto hVol = Utils::OpenVolume(volumePath);
+  if (!hVol) {
+    throw std::runtime_error("Failed to open volume for metadata.");
+  }
+  const auto roots = index.GetRootIds();
+  if (roots.empty())
+    return 0;
+
+  // Sizes land in folder totals once, at the end, not per file.
+  index.BeginBulkLoad();
+  size_t updated = 0;
+  try {
+    MetadataWalk walk(index, hVol.get(), threads);
+    updated = walk.Run(roots.front());
+  } catch (...) {
+    index.EndBulkLoad();
+    throw;
+  }
+  index.EndBulkLoad();
+  return updated;
+}
 } // namespace PulseFS::Core
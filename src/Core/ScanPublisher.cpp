@@ -0,0 +1,150 @@
+#include "PulseFS/Core/ScanPublisher.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+
+namespace PulseFS::Core {
+
+namespace {
+
+long long SteadyNanoseconds() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+} // namespace
+
+void ScanProgress::Start() {
+  m_found = 0;
+  m_published = 0;
+  m_publications = 0;
+  m_finishNs = 0;
+  m_startNs = SteadyNanoseconds();
+}
+
+void ScanProgress::Found(size_t entries) {
+  m_found.fetch_add(entries, std::memory_order_relaxed);
+}
+
+void ScanProgress::Published(size_t entries) {
+  m_published.fetch_add(entries, std::memory_order_relaxed);
+  m_publications.fetch_add(1, std::memory_order_relaxed);
+}
+
+void ScanProgress::Finish() { m_finishNs = SteadyNanoseconds(); }
+
+ScanStats ScanProgress::GetStats() const {
+  ScanStats stats;
+  stats.entriesFound = m_found.load(std::memory_order_relaxed);
+  stats.entriesPublished = m_published.load(std::memory_order_relaxed);
+  stats.publications = m_publications.load(std::memory_order_relaxed);
+  const long long start = m_startNs.load();
+  const long long finish = m_finishNs.load();
+  stats.finished = finish != 0;
+  if (start != 0) {
+    const long long end = stats.finished ? finish : SteadyNanoseconds();
+    stats.seconds = (end - start) / 1e9;
+    if (stats.seconds > 0.0)
+      stats.entriesPerSecond = stats.entriesFound / stats.seconds;
+  }
+  return stats;
+}
+
+ScanPublisher::ScanPublisher(Engine::SearchIndex &index, size_t workers,
+                             ScanProgress *progress, size_t batchSize,
+                             std::chrono::milliseconds interval)
+    : m_index(index), m_progress(progress), m_batchSize(batchSize),
+      m_interval(interval), m_workers(workers),
+      m_published(index.GetIdScheme()) {
+  const auto now = std::chrono::steady_clock::now();
+  for (auto &worker : m_workers)
+    worker.lastPublish = now;
+  if (m_progress)
+    m_progress->Start();
+}
+
+void ScanPublisher::Add(size_t worker, Engine::FileEntry entry) {
+  m_workers[worker].batch.push_back(std::move(entry));
+}
+
+void ScanPublisher::Poll(size_t worker) {
+  Worker &state = m_workers[worker];
+  if (state.batch.empty())
+    return;
+  const auto now = std::chrono::steady_clock::now();
+  if (state.batch.size() < m_batchSize && now - state.lastPublish < m_interval)
+    return;
+  state.lastPublish = now;
+  std::lock_guard lock(m_mutex);
+  PublishLocked(state);
+}
+
+void ScanPublisher::Finish() {
+  std::lock_guard lock(m_mutex);
+  for (auto &worker : m_workers)
+    PublishLocked(worker);
+  for (auto &[parentId, entries] : m_waiting) {
+    for (auto &entry : entries)
+      m_changes.push_back({Engine::ChangeKind::Insert, std::move(entry)});
+  }
+  m_waiting.clear();
+  ApplyLocked();
+  if (m_progress)
+    m_progress->Finish();
+}
+
+void ScanPublisher::PublishLocked(Worker &worker) {
+  PULSEFS_TRACE_SPAN(span, "ScanPublisher publish");
+  span.SetArg("entries", worker.batch.size());
+  if (m_progress)
+    m_progress->Found(worker.batch.size());
+  for (auto &entry : worker.batch)
+    AdmitLocked(std::move(entry));
+  worker.batch.clear();
+  ApplyLocked();
+}
+
+void ScanPublisher::AdmitLocked(Engine::FileEntry entry) {
+  if (entry.id != entry.parentId && !IsPublishedLocked(entry.parentId)) {
+    m_waiting[entry.parentId].push_back(std::move(entry));
+    return;
+  }
+  // Publishing an entry releases whatever was waiting on it, and so on down.
+  m_released.push_back(std::move(entry));
+  while (!m_released.empty()) {
+    Engine::FileEntry next = std::move(m_released.back());
+    m_released.pop_back();
+    m_published.Assign(next.id, 0);
+    if (!m_waiting.empty()) {
+      if (auto it = m_waiting.find(next.id); it != m_waiting.end()) {
+        for (auto &child : it->second)
+          m_released.push_back(std::move(child));
+        m_waiting.erase(it);
+      }
+    }
+    m_changes.push_back({Engine::ChangeKind::Insert, std::move(next)});
+  }
+}
+
+bool ScanPublisher::IsPublishedLocked(unsigned long long id) {
+  if (m_published.Find(id) != Engine::IdSlotMap::npos)
+    return true;
+  // Its siblings already asked; the index will not have it either.
+  if (m_waiting.contains(id))
+    return false;
+  // Indexed before the scan started, like the root of a rescanned subtree.
+  if (!m_index.Contains(id))
+    return false;
+  m_published.Assign(id, 0);
+  return true;
+}
+
+void ScanPublisher::ApplyLocked() {
+  if (m_changes.empty())
+    return;
+  m_index.ApplyBatch(m_changes);
+  if (m_progress)
+    m_progress->Published(m_changes.size());
+  m_changes.clear();
+}
+
+} // namespace PulseFS::Core
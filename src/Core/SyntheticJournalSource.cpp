@@ -0,0 +1,163 @@
+#include "PulseFS/Core/JournalSource.hpp"
+#include "PulseFS/Core/UsnRecord.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include <cstring>
+
+namespace PulseFS::Core {
+
+namespace {
+
+constexpr unsigned long long kRootRecord = 5;
+constexpr unsigned long long kFirstDirectoryRecord = 64;
+constexpr unsigned long long kSequence = 1ull << 48;
+constexpr size_t kMaxSequenceBytes = 4 * 128;
+
+const char16_t *const kStems[] = {u"index",  u"main",   u"package", u"README",
+                                  u"build",  u"report", u"image",   u"notes",
+                                  u"module", u"test",   u"config",  u"data"};
+const char16_t *const kExtensions[] = {u".js",  u".json", u".cpp", u".h",
+                                       u".txt", u".png",  u".md",  u".tmp"};
+
+unsigned long long DirectoryFrn(size_t index) {
+  return kSequence | (kFirstDirectoryRecord + index);
+}
+
+} // namespace
+
+SyntheticJournalSource::SyntheticJournalSource(
+    const SyntheticChurnOptions &options)
+    : m_options(options), m_rng(options.seed),
+      m_nextRecord(kFirstDirectoryRecord + options.directories) {}
+
+std::vector<Engine::FileEntry> SyntheticJournalSource::InitialEntries() const {
+  std::vector<Engine::FileEntry> entries;
+  entries.reserve(m_options.directories + 1);
+  const unsigned long long root = kSequence | kRootRecord;
+  entries.push_back({L".", root, root, Engine::kAttributeDirectory, true});
+
+  std::mt19937_64 rng(m_options.seed ^ 0x9E3779B97F4A7C15ull);
+  for (size_t i = 0; i < m_options.directories; ++i) {
+    unsigned long long parent =
+        (i == 0 || rng() % 4 == 0) ? root : DirectoryFrn(rng() % i);
+    entries.push_back({L"dir_" + std::to_wstring(i), DirectoryFrn(i), parent,
+                       Engine::kAttributeDirectory, true});
+  }
+  return entries;
+}
+
+JournalRead SyntheticJournalSource::Read(std::vector<char> &buffer) {
+  if (m_options.buffers != 0 && m_buffersProduced >= m_options.buffers)
+    return JournalRead::Finished;
+
+  buffer.assign(sizeof(long long), 0);
+  if (m_options.splitSequences) {
+    FillSplit(buffer);
+  } else {
+    while (buffer.size() + kMaxSequenceBytes <= m_options.bufferSize)
+      AppendSequence(buffer);
+  }
+
+  std::memcpy(buffer.data(), &m_usn, sizeof(m_usn));
+  m_buffersProduced++;
+  return JournalRead::Data;
+}
+
+void SyntheticJournalSource::AppendSequence(std::vector<char> &buffer) {
+  const unsigned roll = static_cast<unsigned>(m_rng() % 100);
+  if (roll < 45 || m_live.empty()) {
+    AppendCreate(buffer, false);
+  } else if (roll < 65) {
+    AppendRename(buffer);
+  } else if (roll < 85) {
+    AppendDelete(buffer);
+  } else {
+    AppendCreate(buffer, true);
+  }
+}
+
+// Fills the buffer record by record, carrying the rest of a sequence over to
+// the next read. The last buffer only drains the carry, so every generated
+// record is read.
+void SyntheticJournalSource::FillSplit(std::vector<char> &buffer) {
+  const bool last = m_options.buffers != 0 &&
+                    m_buffersProduced + 1 == m_options.buffers;
+  while (true) {
+    if (m_carryOffset == m_carry.size()) {
+      if (last)
+        return;
+      m_carry.clear();
+      m_carryOffset = 0;
+      AppendSequence(m_carry);
+    }
+    uint32_t length = 0;
+    std::memcpy(&length, m_carry.data() + m_carryOffset, sizeof(length));
+    if (buffer.size() + length > m_options.bufferSize)
+      return;
+    buffer.insert(buffer.end(), m_carry.begin() + m_carryOffset,
+                  m_carry.begin() + m_carryOffset + length);
+    m_carryOffset += length;
+  }
+}
+
+std::u16string SyntheticJournalSource::MakeName() {
+  std::u16string name = kStems[m_rng() % std::size(kStems)];
+  name += u'_';
+  for (char c : std::to_string(m_rng() % 100000))
+    name += static_cast<char16_t>(c);
+  name += kExtensions[m_rng() % std::size(kExtensions)];
+  return name;
+}
+
+void SyntheticJournalSource::AppendCreate(std::vector<char> &buffer,
+                                          bool deleteAfter) {
+  LiveFile file{kSequence | m_nextRecord++,
+                m_options.directories
+                    ? DirectoryFrn(m_rng() % m_options.directories)
+                    : (kSequence | kRootRecord),
+                MakeName()};
+
+  Append(buffer, file, Usn::kReasonFileCreate);
+  if (deleteAfter) {
+    Append(buffer, file,
+           Usn::kReasonFileCreate | Usn::kReasonFileDelete | Usn::kReasonClose);
+    return;
+  }
+  Append(buffer, file, Usn::kReasonFileCreate | Usn::kReasonDataExtend);
+  Append(buffer, file,
+         Usn::kReasonFileCreate | Usn::kReasonDataExtend | Usn::kReasonClose);
+  m_live.push_back(std::move(file));
+}
+
+void SyntheticJournalSource::AppendRename(std::vector<char> &buffer) {
+  LiveFile &file = m_live[m_rng() % m_live.size()];
+  Append(buffer, file, Usn::kReasonRenameOldName);
+  file.name = MakeName();
+  if (m_options.directories && m_rng() % 2 == 0)
+    file.parent = DirectoryFrn(m_rng() % m_options.directories);
+  Append(buffer, file, Usn::kReasonRenameNewName);
+  Append(buffer, file, Usn::kReasonRenameNewName | Usn::kReasonClose);
+}
+
+void SyntheticJournalSource::AppendDelete(std::vector<char> &buffer) {
+  size_t victim = m_rng() % m_live.size();
+  Append(buffer, m_live[victim], Usn::kReasonFileDelete | Usn::kReasonClose);
+  m_live[victim] = std::move(m_live.back());
+  m_live.pop_back();
+}
+
+void SyntheticJournalSource::Append(std::vector<char> &buffer,
+                                    const LiveFile &file, uint32_t reason) {
+  Usn::RecordV2 record{};
+  record.FileReferenceNumber = file.frn;
+  record.ParentFileReferenceNumber = file.parent;
+  record.Usn = m_usn;
+  record.TimeStamp = m_usn;
+  record.Reason = reason;
+  record.FileAttributes = Engine::kAttributeArchive;
+
+  const size_t before = buffer.size();
+  Usn::AppendRecordV2(buffer, record, file.name);
+  m_usn += static_cast<long long>(buffer.size() - before);
+}
+
+} // namespace PulseFS::Core
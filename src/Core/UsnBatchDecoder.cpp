@@ -0,0 +1,102 @@
+#include "PulseFS/Core/UsnBatchDecoder.hpp"
+#include "PulseFS/Core/UsnRecord.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+#include <algorithm>
+#include <cstring>
+
+namespace PulseFS::Core {
+
+void UsnBatchDecoder::Decode(const char *records, size_t length) {
+  size_t offset = 0;
+  while (offset + Usn::kRecordV2HeaderSize <= length) {
+    Usn::RecordV2 record;
+    std::memcpy(&record, records + offset, Usn::kRecordV2HeaderSize);
+
+    if (record.RecordLength < Usn::kRecordV2HeaderSize ||
+        offset + record.RecordLength > length) {
+      break;
+    }
+    if (record.MajorVersion != 2 ||
+        record.FileNameOffset + record.FileNameLength > record.RecordLength) {
+      offset += record.RecordLength;
+      continue;
+    }
+    m_recordCount++;
+    m_newestTimeStamp = std::max<long long>(m_newestTimeStamp, record.TimeStamp);
+
+    auto [it, inserted] =
+        m_pendingByFrn.try_emplace(record.FileReferenceNumber, m_pending.size());
+    if (inserted) {
+      m_pending.emplace_back();
+      m_pending.back().state.id = record.FileReferenceNumber;
+    }
+    PendingChange &change = m_pending[it->second];
+
+    const uint32_t reason = record.Reason;
+    if (reason & Usn::kReasonFileDelete) {
+      change.deleted = true;
+    } else if (!(reason & Usn::kReasonRenameOldName)) {
+      std::u16string name(record.FileNameLength / sizeof(char16_t), u'\0');
+      std::memcpy(name.data(), records + offset + record.FileNameOffset,
+                  name.size() * sizeof(char16_t));
+
+      change.state.name = Utils::WideFromUtf16(name.data(), name.size());
+      change.state.parentId = record.ParentFileReferenceNumber;
+      change.state.fileAttributes = record.FileAttributes;
+      change.hasState = true;
+    }
+
+    if (reason & Usn::kReasonFileCreate)
+      change.created = true;
+    if (reason & Usn::kReasonRenameNewName)
+      change.renamed = true;
+    if (reason & Usn::kReasonBasicInfoChange)
+      change.attributesChanged = true;
+    if (reason & (Usn::kReasonDataOverwrite | Usn::kReasonDataExtend |
+                  Usn::kReasonDataTruncation))
+      change.dataChanged = true;
+
+    offset += record.RecordLength;
+  }
+}
+
+std::vector<Engine::IndexChange>
+UsnBatchDecoder::TakeBatch(std::vector<unsigned long long> *written) {
+  using Engine::ChangeKind;
+
+  std::vector<Engine::IndexChange> batch;
+  batch.reserve(m_pending.size());
+  if (written)
+    written->clear();
+
+  for (auto &change : m_pending) {
+    // Reasons accumulate until CLOSE, so `created` may come from a CREATE
+    // record an earlier batch already inserted. Removing an id the index
+    // does not hold is a no-op.
+    if (change.deleted) {
+      batch.push_back({ChangeKind::Remove, std::move(change.state)});
+      continue;
+    }
+    if (written && (change.created || change.dataChanged))
+      written->push_back(change.state.id);
+    if (!change.hasState)
+      continue;
+
+    if (change.created) {
+      batch.push_back({ChangeKind::Insert, std::move(change.state)});
+    } else if (change.renamed) {
+      batch.push_back({change.attributesChanged ? ChangeKind::Insert
+                                                : ChangeKind::Rename,
+                       std::move(change.state)});
+    } else if (change.attributesChanged) {
+      batch.push_back({ChangeKind::SetAttributes, std::move(change.state)});
+    }
+  }
+
+  m_pending.clear();
+  m_pendingByFrn.clear();
+  m_recordCount = 0;
+  return batch;
+}
+
+} // namespace PulseFS::Core
@@ -1,9 +1,10 @@
 #include "PulseFS/Core/UsnMonitor.hpp"
-#include "PulseFS/Utils/WinHelpers.hpp"
-#include <iostream>
+#include "PulseFS/Core/UsnBatchDecoder.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+#include <chrono>
+#include <cstring>
 #include <vector>
-#include <windows.h>
-#include <winioctl.h>
 
 namespace PulseFS::Core {
 
@@ -12,85 +13,137 @@ UsnMonitor::UsnMonitor(Engine::SearchIndex &index)
 
 UsnMonitor::~UsnMonitor() { Stop(); }
 
+#ifdef _WIN32
 void UsnMonitor::Start(const std::wstring &volumePath, long long startUsn) {
+  Start(std::make_unique<VolumeJournalSource>(volumePath, startUsn));
+}
+#endif
+
+void UsnMonitor::Start(std::unique_ptr<JournalSource> source) {
   Stop();
   m_running = true;
-  m_thread = std::thread(&UsnMonitor::MonitorLoop, this, volumePath, startUsn);
+  m_thread = std::thread(&UsnMonitor::MonitorLoop, this, std::move(source));
 }
 
 void UsnMonitor::Stop() {
   m_running = false;
+  Wait();
+}
+
+void UsnMonitor::Wait() {
   if (m_thread.joinable()) {
     m_thread.join();
   }
 }
 
-void UsnMonitor::MonitorLoop(std::wstring volumePath, long long startUsn) {
-  auto hVol = Utils::OpenVolume(volumePath);
-  if (!hVol)
-    return;
+JournalStats UsnMonitor::GetStats() const {
+  JournalStats stats;
+  stats.recordsDecoded = m_recordsDecoded;
+  stats.changesApplied = m_changesApplied;
+  stats.eventsPerSecond = m_eventsPerSecond;
+  stats.lagBytes = m_lagBytes;
+  stats.lagSeconds = m_lagSeconds;
+  stats.applyLatencyNs = m_applyLatency.Snapshot();
+  return stats;
+}
 
-  USN_JOURNAL_DATA_V0 journalData = {0};
-  DWORD bytesReturned;
-  if (!::DeviceIoControl(hVol.get(), FSCTL_QUERY_USN_JOURNAL, NULL, 0,
-                         &journalData, sizeof(journalData), &bytesReturned,
-                         NULL)) {
-    return;
-  }
+void UsnMonitor::UpdateLag(JournalSource &source, long long readUsn,
+                           long long newestTimeStamp) {
+  if (auto head = source.HeadUsn())
+    m_lagBytes = *head > readUsn ? *head - readUsn : 0;
 
-  READ_USN_JOURNAL_DATA readData = {0};
-  readData.StartUsn = startUsn;
-  readData.ReasonMask = 0xFFFFFFFF;
-  readData.ReturnOnlyOnClose = FALSE;
-  readData.Timeout = 1;
-  readData.BytesToWaitFor = 0;
-  readData.UsnJournalID = journalData.UsnJournalID;
-  readData.MinMajorVersion = 2;
-  readData.MaxMajorVersion = 2;
+  // Synthetic and replayed journals carry counters rather than wall-clock
+  // stamps; anything before 2000 is not a real time.
+  constexpr long long kPlausibleFileTime =
+      Engine::FileTimeFromUnix(946684800, 0);
+  if (newestTimeStamp < kPlausibleFileTime)
+    return;
+  const auto now = std::chrono::system_clock::now().time_since_epoch();
+  const auto seconds = std::chrono::duration_cast<std::chrono::seconds>(now);
+  const long long nowFileTime = Engine::FileTimeFromUnix(
+      seconds.count(),
+      static_cast<uint32_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(now - seconds)
+              .count()));
+  m_lagSeconds =
+      nowFileTime > newestTimeStamp
+          ? static_cast<double>(nowFileTime - newestTimeStamp) / 1e7
+          : 0.0;
+}
 
-  const int BUF_LEN = 65536;
-  std::vector<char> buffer(BUF_LEN);
+void UsnMonitor::MonitorLoop(std::unique_ptr<JournalSource> source) {
+  Utils::Trace::SetThreadName("UsnMonitor");
+  std::vector<char> buffer;
+  UsnBatchDecoder decoder;
+  std::vector<unsigned long long> written;
+  auto windowStart = std::chrono::steady_clock::now();
+  unsigned long long windowRecords = 0;
 
   while (m_running) {
-    DWORD bytesRead = 0;
-    BOOL success = ::DeviceIoControl(hVol.get(), FSCTL_READ_USN_JOURNAL,
-                                     &readData, sizeof(readData), &buffer[0],
-                                     BUF_LEN, &bytesRead, NULL);
-
-    if (success) {
-      if (bytesRead > sizeof(USN)) {
-
-        readData.StartUsn = *((USN *)&buffer[0]);
-
-        DWORD offset = sizeof(USN);
-        while (offset < bytesRead) {
-          PUSN_RECORD_V2 pRecord = (PUSN_RECORD_V2)(&buffer[offset]);
-
-          std::wstring name(pRecord->FileName,
-                            pRecord->FileNameLength / sizeof(WCHAR));
-
-          if (pRecord->Reason & USN_REASON_FILE_CREATE) {
-            m_index.Insert({name, pRecord->FileReferenceNumber,
-                            pRecord->ParentFileReferenceNumber, 
-                            pRecord->FileAttributes, true});
-
-          } else if (pRecord->Reason & USN_REASON_FILE_DELETE) {
-            m_index.Remove(pRecord->FileReferenceNumber);
-          } else if (pRecord->Reason & USN_REASON_RENAME_NEW_NAME) {
-            m_index.Rename(pRecord->FileReferenceNumber, name,
-                           pRecord->ParentFileReferenceNumber);
-          }
+    JournalRead status;
+    {
+      PULSEFS_TRACE_SCOPE("JournalSource::Read");
+      status = source->Read(buffer);
+    }
+    switch (status) {
+    case JournalRead::Data: {
+      if (buffer.size() <= sizeof(long long))
+        break;
+      long long readUsn = 0;
+      std::memcpy(&readUsn, buffer.data(), sizeof(readUsn));
+      {
+        PULSEFS_TRACE_SPAN(decodeSpan, "UsnBatchDecoder::Decode");
+        decoder.Decode(buffer.data() + sizeof(long long),
+                       buffer.size() - sizeof(long long));
+        decodeSpan.SetArg("records", decoder.RecordCount());
+      }
+      m_recordsDecoded += decoder.RecordCount();
+      windowRecords += decoder.RecordCount();
 
-          offset += pRecord->RecordLength;
+      std::vector<Engine::IndexChange> batch;
+      {
+        PULSEFS_TRACE_SCOPE("UsnBatchDecoder::TakeBatch");
+        batch = decoder.TakeBatch(&written);
+      }
+      if (!written.empty()) {
+        PULSEFS_TRACE_SPAN(metadataSpan, "JournalSource::ReadMetadata");
+        metadataSpan.SetArg("files", written.size());
+        for (auto id : written) {
+          Engine::IndexChange change{Engine::ChangeKind::SetMetadata, {}};
+          change.entry.id = id;
+          if (source->ReadMetadata(id, change.entry))
+            batch.push_back(std::move(change));
         }
-
-      } else {
-
-        readData.StartUsn = *((USN *)&buffer[0]);
       }
-    } else {
-
+      m_changesApplied += batch.size();
+      const auto start = std::chrono::steady_clock::now();
+      m_index.ApplyBatch(batch);
+      m_applyLatency.Record(static_cast<uint64_t>(
+          std::chrono::duration_cast<std::chrono::nanoseconds>(
+              std::chrono::steady_clock::now() - start)
+              .count()));
+      UpdateLag(*source, readUsn, decoder.NewestTimeStamp());
+      break;
+    }
+    case JournalRead::Idle:
+      if (m_lagBytes > 0)
+        m_lagBytes = 0;
+      m_lagSeconds = 0.0;
+      std::this_thread::sleep_for(std::chrono::milliseconds(50));
+      break;
+    case JournalRead::Failed:
       std::this_thread::sleep_for(std::chrono::milliseconds(500));
+      break;
+    case JournalRead::Finished:
+      return;
+    }
+
+    const auto now = std::chrono::steady_clock::now();
+    const std::chrono::duration<double> window = now - windowStart;
+    if (window.count() >= 1.0) {
+      m_eventsPerSecond = static_cast<double>(windowRecords) / window.count();
+      windowRecords = 0;
+      windowStart = now;
     }
   }
 }
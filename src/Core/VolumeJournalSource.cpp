@@ -0,0 +1,98 @@
+#include "PulseFS/Core/JournalSource.hpp"
+#include <windows.h>
+#include <winioctl.h>
+
+namespace PulseFS::Core {
+
+VolumeJournalSource::VolumeJournalSource(std::wstring volumePath,
+                                         long long startUsn)
+    : m_volumePath(std::move(volumePath)), m_nextUsn(startUsn) {}
+
+bool VolumeJournalSource::Open() {
+  m_volume = Utils::OpenVolume(m_volumePath);
+  if (!m_volume)
+    return false;
+
+  USN_JOURNAL_DATA_V0 journalData = {0};
+  DWORD bytesReturned;
+  if (!::DeviceIoControl(m_volume.get(), FSCTL_QUERY_USN_JOURNAL, NULL, 0,
+                         &journalData, sizeof(journalData), &bytesReturned,
+                         NULL)) {
+    m_volume.reset();
+    return false;
+  }
+
+  m_journalId = journalData.UsnJournalID;
+  return true;
+}
+
+JournalRead VolumeJournalSource::Read(std::vector<char> &buffer) {
+  if (!m_volume && !Open())
+    return JournalRead::Finished;
+
+  READ_USN_JOURNAL_DATA readData = {0};
+  readData.StartUsn = m_nextUsn;
+  readData.ReasonMask = 0xFFFFFFFF;
+  readData.ReturnOnlyOnClose = FALSE;
+  readData.Timeout = 1;
+  readData.BytesToWaitFor = 0;
+  readData.UsnJournalID = m_journalId;
+  readData.MinMajorVersion = 2;
+  readData.MaxMajorVersion = 2;
+
+  const int BUF_LEN = 65536;
+  buffer.resize(BUF_LEN);
+
+  DWORD bytesRead = 0;
+  if (!::DeviceIoControl(m_volume.get(), FSCTL_READ_USN_JOURNAL, &readData,
+                         sizeof(readData), &buffer[0], BUF_LEN, &bytesRead,
+                         NULL)) {
+    buffer.clear();
+    return JournalRead::Failed;
+  }
+
+  buffer.resize(bytesRead);
+  if (bytesRead < sizeof(USN))
+    return JournalRead::Idle;
+
+  m_nextUsn = *((USN *)&buffer[0]);
+  return bytesRead > sizeof(USN) ? JournalRead::Data : JournalRead::Idle;
+}
+
+std::optional<long long> VolumeJournalSource::HeadUsn() {
+  if (!m_volume)
+    return std::nullopt;
+
+  USN_JOURNAL_DATA_V0 journalData = {0};
+  DWORD bytesReturned;
+  if (!::DeviceIoControl(m_volume.get(), FSCTL_QUERY_USN_JOURNAL, NULL, 0,
+                         &journalData, sizeof(journalData), &bytesReturned,
+                         NULL))
+    return std::nullopt;
+  return journalData.NextUsn;
+}
+
+bool VolumeJournalSource::ReadMetadata(unsigned long long id,
+                                       Engine::FileEntry &entry) {
+  if (!m_volume)
+    return false;
+  auto file =
+      Utils::OpenFileByReference(m_volume.get(), id, FILE_READ_ATTRIBUTES);
+  if (!file)
+    return false;
+
+  FILE_BASIC_INFO basic = {0};
+  FILE_STANDARD_INFO standard = {0};
+  if (!::GetFileInformationByHandleEx(file.get(), FileBasicInfo, &basic,
+                                      sizeof(basic)) ||
+      !::GetFileInformationByHandleEx(file.get(), FileStandardInfo, &standard,
+                                      sizeof(standard)))
+    return false;
+  entry.size = standard.Directory
+                   ? 0
+                   : static_cast<unsigned long long>(standard.EndOfFile.QuadPart);
+  entry.lastWriteTime = basic.LastWriteTime.QuadPart;
+  return true;
+}
+
+} // namespace PulseFS::Core
@@ -0,0 +1,102 @@
+#include "PulseFS/Engine/AttributeBitmaps.hpp"
+
+namespace PulseFS::Engine {
+
+namespace {
+
+constexpr unsigned long IndexedMask() {
+  unsigned long mask = 0;
+  for (unsigned long attribute : AttributeBitmaps::kIndexedAttributes)
+    mask |= attribute;
+  return mask;
+}
+
+} // namespace
+
+void SlotBitmap::Set(size_t slot) {
+  const size_t chunk = slot / kChunkSlots;
+  if (chunk >= m_chunks.size())
+    m_chunks.resize(chunk + 1);
+  if (!m_chunks[chunk]) {
+    m_chunks[chunk] = std::make_unique<Chunk>();
+    m_allocated++;
+  }
+  uint64_t &word = m_chunks[chunk]->words[(slot / 64) % kChunkWords];
+  const uint64_t bit = uint64_t(1) << (slot % 64);
+  if (!(word & bit)) {
+    word |= bit;
+    m_chunks[chunk]->count++;
+  }
+}
+
+void SlotBitmap::Reset(size_t slot) {
+  const size_t chunk = slot / kChunkSlots;
+  if (chunk >= m_chunks.size() || !m_chunks[chunk])
+    return;
+  uint64_t &word = m_chunks[chunk]->words[(slot / 64) % kChunkWords];
+  const uint64_t bit = uint64_t(1) << (slot % 64);
+  if (!(word & bit))
+    return;
+  word &= ~bit;
+  if (--m_chunks[chunk]->count == 0) {
+    m_chunks[chunk].reset();
+    m_allocated--;
+  }
+}
+
+void SlotBitmap::Clear() {
+  m_chunks.clear();
+  m_allocated = 0;
+}
+
+size_t SlotBitmap::MemoryUsage() const {
+  return m_chunks.capacity() * sizeof(m_chunks[0]) +
+         m_allocated * sizeof(Chunk);
+}
+
+void AttributeBitmaps::Update(size_t slot, unsigned long before,
+                              unsigned long after) {
+  if (before == after)
+    return;
+  for (size_t i = 0; i < kIndexedAttributes.size(); ++i) {
+    const unsigned long attribute = kIndexedAttributes[i];
+    if ((before & attribute) == (after & attribute))
+      continue;
+    if (after & attribute)
+      m_bitmaps[i].Set(slot);
+    else
+      m_bitmaps[i].Reset(slot);
+  }
+}
+
+void AttributeBitmaps::Clear() {
+  for (auto &bitmap : m_bitmaps)
+    bitmap.Clear();
+}
+
+uint64_t AttributeBitmaps::Candidates(size_t word,
+                                      const AttributeFilter &filter) const {
+  uint64_t bits = ~uint64_t(0);
+  for (size_t i = 0; i < kIndexedAttributes.size() && bits; ++i) {
+    const unsigned long attribute = kIndexedAttributes[i];
+    if (filter.require & attribute)
+      bits &= m_bitmaps[i].Word(word);
+    else if (filter.exclude & attribute)
+      bits &= ~m_bitmaps[i].Word(word);
+  }
+  return bits;
+}
+
+AttributeFilter AttributeBitmaps::Unindexed(const AttributeFilter &filter) {
+  constexpr unsigned long kIndexed = IndexedMask();
+  return {filter.require & ~kIndexed, filter.exclude & ~kIndexed};
+}
+
+size_t AttributeBitmaps::MemoryUsage() const {
+  size_t bytes = 0;
+  for (const auto &bitmap : m_bitmaps)
+    bytes += bitmap.MemoryUsage();
+  return bytes;
+}
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,140 @@
+#include "PulseFS/Engine/ChildIndex.hpp"
+#include <algorithm>
+
+namespace PulseFS::Engine {
+
+void ChildIndex::Rebuild(const std::vector<uint32_t> &parentSlots,
+                         const std::vector<Orphan> &orphans) {
+  Clear();
+  const size_t slots = parentSlots.size();
+
+  // Counting sort by parent: count, turn counts into starts, then place each
+  // child and advance its parent's start, which leaves every offset at the
+  // end of its range until they are shifted back by one.
+  m_offsets.assign(slots + 1, 0);
+  for (uint32_t parent : parentSlots) {
+    if (parent != kNoSlot)
+      m_offsets[parent + 1]++;
+  }
+  for (size_t p = 0; p < slots; ++p)
+    m_offsets[p + 1] += m_offsets[p];
+  m_children.resize(m_offsets[slots]);
+  for (size_t s = 0; s < slots; ++s) {
+    if (const uint32_t parent = parentSlots[s]; parent != kNoSlot)
+      m_children[m_offsets[parent]++] = static_cast<uint32_t>(s);
+  }
+  for (size_t p = slots; p > 0; --p)
+    m_offsets[p] = m_offsets[p - 1];
+  m_offsets[0] = 0;
+  m_baseSlots = slots;
+
+  for (const auto &orphan : orphans)
+    Link(orphan.slot, orphan.parentId);
+}
+
+void ChildIndex::Clear() {
+  m_offsets.clear();
+  m_children.clear();
+  m_baseSlots = 0;
+  m_moved.clear();
+  m_lastList = nullptr;
+  m_positions.clear();
+  m_retired.clear();
+  m_drift = 0;
+}
+
+std::span<const uint32_t> ChildIndex::Built(uint32_t parentSlot) const {
+  if (parentSlot >= m_baseSlots)
+    return {};
+  return std::span<const uint32_t>(m_children)
+      .subspan(m_offsets[parentSlot],
+               m_offsets[parentSlot + 1] - m_offsets[parentSlot]);
+}
+
+void ChildIndex::Added(uint32_t slot, unsigned long long parentId) {
+  m_drift++;
+  Link(slot, parentId);
+}
+
+void ChildIndex::Moved(uint32_t slot, unsigned long long oldParentId,
+                       unsigned long long parentId, uint32_t parentSlot) {
+  m_drift++;
+  Unlink(slot, oldParentId);
+
+  // Back under the parent it was built under: its old place lists it again.
+  auto builtUnder = [&](uint32_t parent) {
+    const auto range = Built(parent);
+    return std::binary_search(range.begin(), range.end(), slot);
+  };
+  if (builtUnder(parentSlot))
+    return;
+  if (auto it = m_retired.find(parentId);
+      it != m_retired.end() && builtUnder(it->second))
+    return;
+  Link(slot, parentId);
+}
+
+void ChildIndex::Retired(uint32_t slot, unsigned long long id,
+                         unsigned long long parentId) {
+  m_drift++;
+  Unlink(slot, parentId);
+  if (!Built(slot).empty())
+    m_retired[id] = slot;
+}
+
+void ChildIndex::Candidates(unsigned long long parentId, uint32_t parentSlot,
+                            std::vector<uint32_t> &slots) const {
+  const auto built = Built(parentSlot);
+  slots.insert(slots.end(), built.begin(), built.end());
+  if (auto it = m_retired.find(parentId);
+      it != m_retired.end() && it->second != parentSlot) {
+    const auto retired = Built(it->second);
+    slots.insert(slots.end(), retired.begin(), retired.end());
+  }
+  if (auto it = m_moved.find(parentId); it != m_moved.end())
+    slots.insert(slots.end(), it->second.begin(), it->second.end());
+}
+
+void ChildIndex::Link(uint32_t slot, unsigned long long parentId) {
+  if (slot >= m_positions.size())
+    m_positions.resize(std::max<size_t>(slot + 1, m_positions.size() * 2),
+                       kNoSlot);
+  // Scans and batches add runs of siblings; skip the lookup for those.
+  if (!m_lastList || m_lastParent != parentId) {
+    m_lastParent = parentId;
+    m_lastList = &m_moved[parentId];
+  }
+  m_positions[slot] = static_cast<uint32_t>(m_lastList->size());
+  m_lastList->push_back(slot);
+}
+
+void ChildIndex::Unlink(uint32_t slot, unsigned long long parentId) {
+  if (slot >= m_positions.size() || m_positions[slot] == kNoSlot)
+    return;
+  auto list = m_moved.find(parentId);
+  const uint32_t position = m_positions[slot];
+  const uint32_t last = list->second.back();
+  list->second[position] = last;
+  m_positions[last] = position;
+  m_positions[slot] = kNoSlot;
+  list->second.pop_back();
+  if (list->second.empty()) {
+    if (m_lastList == &list->second)
+      m_lastList = nullptr;
+    m_moved.erase(list);
+  }
+}
+
+size_t ChildIndex::MemoryUsage() const {
+  // Published after every write, so the side lists are estimated from their
+  // counts rather than walked.
+  constexpr size_t kListBytes =
+      sizeof(unsigned long long) + sizeof(std::vector<uint32_t>);
+  return (m_offsets.capacity() + m_children.capacity() +
+          m_positions.capacity()) *
+             sizeof(uint32_t) +
+         m_moved.size() * kListBytes +
+         m_retired.size() * sizeof(std::pair<unsigned long long, uint32_t>);
+}
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,213 @@
+#include "PulseFS/Engine/DisplayModel.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+#include <algorithm>
+#include <cstdio>
+#include <cwctype>
+#include <unordered_set>
+
+namespace PulseFS::Engine {
+
+namespace {
+
+std::wstring LowerExtension(std::wstring_view name) {
+  const size_t dot = name.find_last_of(L'.');
+  if (dot == std::wstring_view::npos || dot + 1 == name.size())
+    return {};
+  std::wstring ext(name.substr(dot));
+  std::transform(ext.begin(), ext.end(), ext.begin(),
+                 [](wchar_t c) { return std::towlower(c); });
+  return ext;
+}
+
+bool IsDirectoryFirst(const DisplayRow &row) {
+  return row.kind == RowKind::Directory;
+}
+
+} // namespace
+
+std::wstring DisplayModel::IconKeyFor(std::wstring_view path,
+                                      bool isDirectory) {
+  if (isDirectory)
+    return std::wstring(path);
+  std::wstring ext = LowerExtension(path);
+  if (ext.empty())
+    return L".unknown";
+  const bool hasCustomIcon = ext == L".exe" || ext == L".lnk" ||
+                             ext == L".ico" || ext == L".dll" ||
+                             ext == L".scr" || ext == L".cpl";
+  return hasCustomIcon ? std::wstring(path) : ext;
+}
+
+bool DisplayModel::IsImageName(std::wstring_view name) {
+  const std::wstring ext = LowerExtension(name);
+  return ext == L".jpg" || ext == L".jpeg" || ext == L".png" ||
+         ext == L".bmp" || ext == L".gif" || ext == L".ico" ||
+         ext == L".tiff" || ext == L".tif" || ext == L".webp";
+}
+
+std::string DisplayModel::FormatSize(unsigned long long bytes) {
+  static const char *units[] = {"B", "KB", "MB", "GB", "TB"};
+  double value = static_cast<double>(bytes);
+  int unit = 0;
+  while (value >= 1024.0 && unit < 4) {
+    value /= 1024.0;
+    ++unit;
+  }
+  char buffer[32];
+  std::snprintf(buffer, sizeof(buffer), unit == 0 ? "%.0f %s" : "%.1f %s",
+                value, units[unit]);
+  return buffer;
+}
+
+bool DisplayModel::Resolve(const SearchIndex &index, unsigned long long id,
+                           DisplayRow &row) const {
+  row.path = index.GetFullPath(id);
+  if (row.path.empty())
+    return false;
+
+  row.id = id;
+  const bool isDirectory =
+      (index.GetAttributes(id) & kAttributeDirectory) != 0;
+  const size_t slash = row.path.find_last_of(L"\\/");
+  const std::wstring_view name =
+      slash == std::wstring::npos
+          ? std::wstring_view(row.path)
+          : std::wstring_view(row.path).substr(slash + 1);
+  row.kind = isDirectory          ? RowKind::Directory
+             : IsImageName(name) ? RowKind::Image
+                                 : RowKind::File;
+  row.iconKey = IconKeyFor(row.path, isDirectory);
+
+  // Convert the parent and the name separately so the name's offset in the
+  // UTF-8 path is known without searching it again.
+  const size_t nameStart = row.path.size() - name.size();
+  row.pathUtf8 =
+      Utils::Utf8FromWide(std::wstring_view(row.path).substr(0, nameStart));
+  row.nameOffset = row.pathUtf8.size();
+  row.pathUtf8 += Utils::Utf8FromWide(name);
+
+  ReadSize(index, row);
+  row.lastWriteTime = index.GetLastWriteTime(id);
+  FormatMetadata(row);
+  return true;
+}
+
+void DisplayModel::ReadSize(const SearchIndex &index, DisplayRow &row) {
+  if (row.kind != RowKind::Directory) {
+    row.size = index.GetSize(row.id);
+    row.sizeKnown = true;
+    return;
+  }
+  const auto totals = index.GetFolderTotals(row.id);
+  row.size = totals ? totals->bytes : 0;
+  row.sizeKnown = totals.has_value();
+}
+
+void DisplayModel::FormatMetadata(DisplayRow &row) const {
+  // Metadata arrives after names, so these stay blank until it does.
+  row.sizeText.clear();
+  row.timeText.clear();
+  if (row.lastWriteTime == 0)
+    return;
+  if (row.sizeKnown)
+    row.sizeText = FormatSize(row.size);
+  if (m_formatTime)
+    row.timeText = m_formatTime(row.lastWriteTime);
+}
+
+void DisplayModel::Rebuild(const SearchIndex &index,
+                           const std::vector<unsigned long long> &ids) {
+  m_metadataGeneration = index.Generation();
+  m_rows.clear();
+  m_rows.reserve(ids.size());
+  for (unsigned long long id : ids) {
+    DisplayRow row;
+    if (Resolve(index, id, row))
+      m_rows.push_back(std::move(row));
+  }
+  std::stable_partition(m_rows.begin(), m_rows.end(), IsDirectoryFirst);
+}
+
+void DisplayModel::Apply(const SearchIndex &index, const ResultDelta &delta,
+                         size_t maxRows) {
+  if (!delta.removed.empty()) {
+    std::unordered_set<unsigned long long> removed(delta.removed.begin(),
+                                                   delta.removed.end());
+    std::erase_if(m_rows, [&](const DisplayRow &row) {
+      return removed.contains(row.id);
+    });
+  }
+
+  // Renamed rows, or every row once a directory moved, are read again; a
+  // row can turn from file into directory, so the partition is redone.
+  if (delta.pathsChanged || !delta.updated.empty()) {
+    std::unordered_set<unsigned long long> updated(delta.updated.begin(),
+                                                   delta.updated.end());
+    std::erase_if(m_rows, [&](DisplayRow &row) {
+      if (!delta.pathsChanged && !updated.contains(row.id))
+        return false;
+      return !Resolve(index, row.id, row);
+    });
+    std::stable_partition(m_rows.begin(), m_rows.end(), IsDirectoryFirst);
+  }
+
+  for (unsigned long long id : delta.added) {
+    if (m_rows.size() >= maxRows)
+      break;
+    DisplayRow row;
+    if (!Resolve(index, id, row))
+      continue;
+    // New directories go after the existing ones, new files at the end.
+    auto position = row.kind == RowKind::Directory
+                        ? std::partition_point(m_rows.begin(), m_rows.end(),
+                                               IsDirectoryFirst)
+                        : m_rows.end();
+    m_rows.insert(position, std::move(row));
+  }
+}
+
+void DisplayModel::SortByName() {
+  auto folded = [](const DisplayRow &row) {
+    std::wstring name(std::wstring_view(row.path).substr(
+        row.path.find_last_of(L"\\/") + 1));
+    std::transform(name.begin(), name.end(), name.begin(),
+                   [](wchar_t c) { return std::towlower(c); });
+    return name;
+  };
+  std::vector<std::pair<std::wstring, size_t>> keys;
+  keys.reserve(m_rows.size());
+  for (size_t i = 0; i < m_rows.size(); ++i)
+    keys.emplace_back(folded(m_rows[i]), i);
+  std::sort(keys.begin(), keys.end(), [&](const auto &a, const auto &b) {
+    const bool aDir = IsDirectoryFirst(m_rows[a.second]);
+    const bool bDir = IsDirectoryFirst(m_rows[b.second]);
+    return aDir != bDir ? aDir : a.first < b.first;
+  });
+
+  std::vector<DisplayRow> sorted;
+  sorted.reserve(m_rows.size());
+  for (const auto &key : keys)
+    sorted.push_back(std::move(m_rows[key.second]));
+  m_rows = std::move(sorted);
+}
+
+bool DisplayModel::RefreshMetadata(const SearchIndex &index) {
+  m_metadataGeneration = index.Generation();
+  bool changed = false;
+  for (auto &row : m_rows) {
+    const unsigned long long size = row.size;
+    const bool sizeKnown = row.sizeKnown;
+    const long long lastWriteTime = row.lastWriteTime;
+    ReadSize(index, row);
+    row.lastWriteTime = index.GetLastWriteTime(row.id);
+    if (row.size == size && row.sizeKnown == sizeKnown &&
+        row.lastWriteTime == lastWriteTime)
+      continue;
+    FormatMetadata(row);
+    changed = true;
+  }
+  return changed;
+}
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,204 @@
+#include "PulseFS/Engine/IdSlotMap.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+#include <algorithm>
+
+namespace PulseFS::Engine {
+
+namespace {
+
+uint64_t Mix(uint64_t key) {
+  key ^= key >> 30;
+  key *= 0xBF58476D1CE4E5B9ull;
+  key ^= key >> 27;
+  key *= 0x94D049BB133111EBull;
+  key ^= key >> 31;
+  return key;
+}
+
+} // namespace
+
+IdSlotMap::IdSlotMap(IdScheme scheme) : m_scheme(scheme) {}
+
+void IdSlotMap::SetScheme(IdScheme scheme) {
+  if (scheme == m_scheme)
+    return;
+  Clear();
+  m_scheme = scheme;
+}
+
+void IdSlotMap::Reserve(size_t capacity) {
+  if (capacity > m_direct.size()) {
+    m_direct.resize(capacity, 0);
+  }
+}
+
+void IdSlotMap::Clear() {
+  m_direct.clear();
+  m_hash.clear();
+  m_hashUsed = 0;
+  m_hashTombstones = 0;
+  m_size = 0;
+}
+
+size_t IdSlotMap::Find(uint64_t id) const noexcept {
+  const uint64_t record = RecordOf(id);
+  uint64_t cell = 0;
+  if (record < m_direct.size()) {
+    cell = m_direct[record];
+  }
+  if (cell == 0 && m_hashUsed != 0) {
+    size_t pos = HashFind(record);
+    if (pos != npos)
+      cell = m_hash[pos].slot;
+  }
+  if (cell == 0 || (cell >> 48) != SequenceOf(id))
+    return npos;
+  return static_cast<size_t>((cell & kSlotMask) - 1);
+}
+
+size_t IdSlotMap::Assign(uint64_t id, size_t slot) {
+  const uint64_t record = RecordOf(id);
+  const uint64_t sequence = SequenceOf(id);
+  const uint64_t packed = (sequence << 48) | ((slot + 1) & kSlotMask);
+
+  uint64_t previous = 0;
+  if (TryDirect(record)) {
+    previous = m_direct[record];
+    if (previous == 0 && m_hashUsed != 0) {
+      size_t pos = HashFind(record);
+      if (pos != npos) {
+        previous = m_hash[pos].slot;
+        HashErase(record);
+      }
+    }
+    m_direct[record] = packed;
+  } else {
+    size_t pos = HashFind(record);
+    if (pos != npos) {
+      previous = m_hash[pos].slot;
+      m_hash[pos].slot = packed;
+    } else {
+      HashInsert(record, packed);
+    }
+  }
+
+  if (previous == 0) {
+    ++m_size;
+    return npos;
+  }
+  if ((previous >> 48) != sequence)
+    return static_cast<size_t>((previous & kSlotMask) - 1);
+  return npos;
+}
+
+bool IdSlotMap::Erase(uint64_t id) noexcept {
+  const uint64_t record = RecordOf(id);
+  const uint64_t sequence = SequenceOf(id);
+
+  if (record < m_direct.size() && m_direct[record] != 0) {
+    if ((m_direct[record] >> 48) != sequence)
+      return false;
+    m_direct[record] = 0;
+    --m_size;
+    return true;
+  }
+
+  if (m_hashUsed == 0)
+    return false;
+  size_t pos = HashFind(record);
+  if (pos == npos || (m_hash[pos].slot >> 48) != sequence)
+    return false;
+  HashErase(record);
+  --m_size;
+  return true;
+}
+
+size_t IdSlotMap::MemoryUsage() const noexcept {
+  return m_direct.capacity() * sizeof(uint64_t) +
+         m_hash.capacity() * sizeof(HashCell);
+}
+
+bool IdSlotMap::TryDirect(uint64_t record) {
+  if (record < m_direct.size())
+    return true;
+  if (record > kRecordMask)
+    return false;
+
+  const size_t limit = std::max(kMinDirectSpan, kDirectDensity * (m_size + 1));
+  if (record >= limit)
+    return false;
+
+  size_t grown = std::max(static_cast<size_t>(record) + 1, m_direct.size() * 2);
+  PULSEFS_TRACE_SPAN(span, "IdSlotMap grow direct table");
+  span.SetArg("cells", std::min(grown, limit));
+  m_direct.resize(std::min(grown, limit), 0);
+  return true;
+}
+
+size_t IdSlotMap::HashFind(uint64_t key) const noexcept {
+  if (m_hash.empty())
+    return npos;
+  const size_t mask = m_hash.size() - 1;
+  for (size_t pos = Mix(key) & mask;; pos = (pos + 1) & mask) {
+    const uint64_t probe = m_hash[pos].key;
+    if (probe == key)
+      return pos;
+    if (probe == kEmptyKey)
+      return npos;
+  }
+}
+
+void IdSlotMap::HashInsert(uint64_t key, uint64_t packed) {
+  if ((m_hashUsed + m_hashTombstones + 1) * 10 >= m_hash.size() * 7) {
+    HashRehash(std::max<size_t>(64, (m_hashUsed + 1) * 2));
+  }
+  const size_t mask = m_hash.size() - 1;
+  for (size_t pos = Mix(key) & mask;; pos = (pos + 1) & mask) {
+    uint64_t &probe = m_hash[pos].key;
+    if (probe == kEmptyKey || probe == kTombstoneKey) {
+      if (probe == kTombstoneKey)
+        --m_hashTombstones;
+      probe = key;
+      m_hash[pos].slot = packed;
+      ++m_hashUsed;
+      return;
+    }
+  }
+}
+
+bool IdSlotMap::HashErase(uint64_t key) noexcept {
+  size_t pos = HashFind(key);
+  if (pos == npos)
+    return false;
+  m_hash[pos].key = kTombstoneKey;
+  m_hash[pos].slot = 0;
+  --m_hashUsed;
+  ++m_hashTombstones;
+  return true;
+}
+
+void IdSlotMap::HashRehash(size_t capacity) {
+  PULSEFS_TRACE_SPAN(span, "IdSlotMap::HashRehash");
+  span.SetArg("capacity", capacity);
+  size_t size = 64;
+  while (size < capacity)
+    size <<= 1;
+
+  std::vector<HashCell> old = std::move(m_hash);
+  m_hash.assign(size, HashCell{kEmptyKey, 0});
+  m_hashUsed = 0;
+  m_hashTombstones = 0;
+
+  const size_t mask = size - 1;
+  for (const auto &cell : old) {
+    if (cell.key == kEmptyKey || cell.key == kTombstoneKey)
+      continue;
+    size_t pos = Mix(cell.key) & mask;
+    while (m_hash[pos].key != kEmptyKey)
+      pos = (pos + 1) & mask;
+    m_hash[pos] = cell;
+    ++m_hashUsed;
+  }
+}
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,77 @@
+#include "PulseFS/Engine/NamePool.hpp"
+
+namespace PulseFS::Engine {
+
+namespace {
+
+size_t NameHeapBytes(const std::wstring &name) {
+  constexpr size_t kInlineCapacity = std::wstring().capacity();
+  return name.capacity() > kInlineCapacity
+             ? (name.capacity() + 1) * sizeof(wchar_t)
+             : 0;
+}
+
+} // namespace
+
+void NamePool::Reserve(size_t names) {
+  m_byName.reserve(names);
+}
+
+NamePool::NameId NamePool::Acquire(const std::wstring &name) {
+  auto [it, inserted] = m_byName.try_emplace(name, kNone);
+  if (!inserted) {
+    m_names[it->second].references++;
+    return it->second;
+  }
+
+  NameId id;
+  if (!m_free.empty()) {
+    id = m_free.back();
+    m_free.pop_back();
+  } else {
+    id = static_cast<NameId>(m_names.size());
+    m_names.emplace_back();
+  }
+  it->second = id;
+  m_names[id] = {&it->first, 1};
+  m_textBytes += NameHeapBytes(it->first);
+  return id;
+}
+
+void NamePool::Release(NameId id) {
+  if (id == kNone)
+    return;
+  Name &name = m_names[id];
+  if (--name.references != 0)
+    return;
+  m_textBytes -= NameHeapBytes(*name.text);
+  // Erased by iterator: the key it would be looked up by is the node's own.
+  m_byName.erase(m_byName.find(*name.text));
+  name = {};
+  m_free.push_back(id);
+}
+
+std::optional<NamePool::NameId>
+NamePool::Find(const std::wstring &name) const {
+  if (auto it = m_byName.find(name); it != m_byName.end())
+    return it->second;
+  return std::nullopt;
+}
+
+size_t NamePool::MemoryUsage() const {
+  // Hash nodes hold the key, the id, the next pointer and the cached hash.
+  constexpr size_t kNodeBytes =
+      sizeof(std::wstring) + sizeof(NameId) + 2 * sizeof(void *);
+  return m_byName.bucket_count() * sizeof(void *) +
+         m_byName.size() * kNodeBytes + m_textBytes +
+         m_names.capacity() * sizeof(Name) + m_free.capacity() * sizeof(NameId);
+}
+
+void NamePool::Clear() {
+  m_byName.clear();
+  m_names.clear();
+  m_free.clear();
+  m_textBytes = 0;
+}
+
+} // namespace PulseFS::Engine
@@ -0,0 +1,70 @@
+#include "PulseFS/Engine/QueryCache.hpp"
+#include <algorithm>
+#include <cwctype>
+
+namespace PulseFS::Engine {
+
+QueryCache::QueryCache(size_t capacity)
+    : m_capacity(std::max<size_t>(capacity, 1)) {}
+
+std::wstring QueryCache::Fold(std::wstring_view query) {
+  std::wstring key(query.size(), L'\0');
+  std::transform(query.begin(), query.end(), key.begin(),
+                 [](wchar_t c) { return std::towlower(c); });
+  return key;
+}
+
+std::optional<std::vector<unsigned long long>>
+QueryCache::Find(std::wstring_view query, size_t maxResults,
+                 uint64_t generation) {
+  auto it = m_byKey.find(Fold(query));
+  if (it == m_byKey.end()) {
+    m_misses++;
+    return std::nullopt;
+  }
+
+  Entry &entry = *it->second;
+  const bool complete = entry.results.size() < entry.maxResults;
+  if (entry.generation != generation ||
+      (maxResults > entry.maxResults && !complete)) {
+    m_misses++;
+    return std::nullopt;
+  }
+
+  m_entries.splice(m_entries.begin(), m_entries, it->second);
+  m_hits++;
+  const size_t count = std::min(maxResults, entry.results.size());
+  return std::vector<unsigned long long>(entry.results.begin(),
+                                         entry.results.begin() + count);
+}
+
+void QueryCache::Store(std::wstring_view query, size_t maxResults,
+                       uint64_t generation,
+                       std::vector<unsigned long long> results) {
+  std::wstring key = Fold(query);
+  if (auto it = m_byKey.find(key); it != m_byKey.end()) {
+    m_entries.splice(m_entries.begin(), m_entries, it->second);
+    // Keep a longer result computed at the same generation.
+    if (it->second->generation == generation &&
+        it->second->maxResults >= maxResults)
+      return;
+    it->second->maxResults = maxResults;
+    it->second->generation = generation;
+    it->second->results = std::move(results);
+    return;
+  }
+
+  if (m_entries.size() >= m_capacity) {
+    m_byKey.erase(m_entries.back().key);
+    m_entries.pop_back();
+  }
+  m_entries.push_front({key, maxResults, generation, std::move(results)});
+  m_byKey.emplace(std::move(key), m_entries.begin());
+}
+
+void QueryCache::Clear() {
+  m_entries.clear();
+  m_byKey.clear();
+}
+
+} // namespace PulseFS::Engine
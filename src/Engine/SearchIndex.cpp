@@ -1,83 +1,689 @@
 #include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
 #include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
 #include <cwctype>
+#include <fstream>
 #include <iostream>
+#include <mutex>
+#include <queue>
+#include <unordered_map>
 
 namespace PulseFS::Engine {
 
+namespace {
+
+constexpr char kSnapshotMagic[4] = {'P', 'F', 'S', 'I'};
+constexpr uint32_t kSnapshotVersion = 1;
+
+struct SnapshotEntry {
+  uint64_t id;
+  uint64_t parentId;
+  uint64_t size;
+  int64_t lastWriteTime;
+  uint32_t fileAttributes;
+  uint32_t nameLength;
+};
+
+template <typename T> void WritePod(std::ostream &out, const T &value) {
+  out.write(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+template <typename T> bool ReadPod(std::istream &in, T &value) {
+  return static_cast<bool>(
+      in.read(reinterpret_cast<char *>(&value), sizeof(value)));
+}
+
+void WriteString(std::ostream &out, std::wstring_view text) {
+  std::u16string utf16 = Utils::Utf16FromWide(text);
+  WritePod(out, static_cast<uint32_t>(utf16.size()));
+  out.write(reinterpret_cast<const char *>(utf16.data()),
+            static_cast<std::streamsize>(utf16.size() * sizeof(char16_t)));
+}
+
+bool ReadUtf16(std::istream &in, uint32_t length, std::u16string &buffer,
+               std::wstring &text) {
+  buffer.resize(length);
+  if (!in.read(reinterpret_cast<char *>(buffer.data()),
+               static_cast<std::streamsize>(length * sizeof(char16_t))))
+    return false;
+  text = Utils::WideFromUtf16(buffer.data(), buffer.size());
+  return true;
+}
+
+// Remembers, per distinct name, whether it matched each query of the
+// current search, so a name carried by many entries is tested once. Each
+// searching thread has its own; rows are stamped with the search they
+// belong to instead of being cleared between searches.
+class NameVerdicts {
+public:
+  void Begin(size_t nameIds, size_t queries) {
+    const size_t words = std::max<size_t>(1, (queries + 63) / 64);
+    if (words != m_words) {
+      m_words = words;
+      m_bits.clear();
+      m_stamps.clear();
+    }
+    if (m_stamps.size() < nameIds) {
+      m_stamps.resize(nameIds, 0);
+      m_bits.resize(nameIds * m_words);
+    }
+    if (++m_search == 0) {
+      std::fill(m_stamps.begin(), m_stamps.end(), 0);
+      m_search = 1;
+    }
+  }
+
+  // Null until Record is called for the name in this search.
+  const uint64_t *Find(NamePool::NameId name) const {
+    return m_stamps[name] == m_search ? &m_bits[name * m_words] : nullptr;
+  }
+
+  uint64_t *Record(NamePool::NameId name) {
+    m_stamps[name] = m_search;
+    uint64_t *row = &m_bits[name * m_words];
+    std::fill(row, row + m_words, 0);
+    return row;
+  }
+
+private:
+  std::vector<uint32_t> m_stamps;
+  std::vector<uint64_t> m_bits;
+  size_t m_words = 0;
+  uint32_t m_search = 0;
+};
+
+thread_local NameVerdicts t_verdicts;
+
+// Slots added or moved since the child index was built sit in side lists,
+// which cost more per child than the CSR layout; past this many changes, or
+// half the built slots, it is rebuilt.
+constexpr size_t kMinChildDrift = 65536;
+
+uint32_t ChildSlot(size_t slot) {
+  return slot == IdSlotMap::npos ? ChildIndex::kNoSlot
+                                 : static_cast<uint32_t>(slot);
+}
+
+// Ancestor walks stop here, as ResolvePathInternal does, should a journal
+// race ever leave a cycle in the parent chain.
+constexpr size_t kMaxFolderDepth = 256;
+
+// Entries a scan visits between looks at its cancel flag.
+constexpr size_t kCancelCheckInterval = 4096;
+
+void Accumulate(FolderTotals &into, const FolderTotals &delta,
+                bool subtract) {
+  if (subtract) {
+    into.bytes -= delta.bytes;
+    into.files -= delta.files;
+    into.folders -= delta.folders;
+  } else {
+    into.bytes += delta.bytes;
+    into.files += delta.files;
+    into.folders += delta.folders;
+  }
+}
+
+bool SameTotals(const FolderTotals &a, const FolderTotals &b) {
+  return a.bytes == b.bytes && a.files == b.files && a.folders == b.folders;
+}
+
+unsigned long long NanosecondsSince(std::chrono::steady_clock::time_point start) {
+  return static_cast<unsigned long long>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(
+          std::chrono::steady_clock::now() - start)
+          .count());
+}
+
+} // namespace
+
+size_t QueryLengthClass(size_t length) {
+  if (length <= 2)
+    return length == 0 ? 0 : length - 1;
+  if (length <= 4)
+    return 2;
+  return length <= 8 ? 3 : 4;
+}
+
+const char *QueryLengthClassName(size_t lengthClass) {
+  static const char *const kNames[kQueryLengthClasses] = {"1", "2", "3-4",
+                                                          "5-8", "9+"};
+  return lengthClass < kQueryLengthClasses ? kNames[lengthClass] : "";
+}
+
 SearchIndex::SearchIndex() {
 
   m_files.reserve(100000);
-  m_idToIndex.reserve(100000);
+  PublishGaugesLocked();
 }
 
 SearchIndex::~SearchIndex() = default;
 
 void SearchIndex::Reserve(size_t capacity) {
-  std::unique_lock lock(m_mutex);
+  PULSEFS_TRACE_SPAN(span, "SearchIndex::Reserve");
+  span.SetArg("capacity", capacity);
+  auto lock = LockExclusive();
   m_files.reserve(capacity);
-  m_idToIndex.reserve(capacity);
+  m_idToIndex.Reserve(capacity);
+  m_names.Reserve(capacity);
+  m_totals.reserve(capacity);
+  PublishGaugesLocked();
+}
+
+void SearchIndex::SetIdScheme(IdScheme scheme) {
+  auto lock = LockExclusive();
+  if (m_idToIndex.Scheme() == scheme)
+    return;
+  m_files.clear();
+  m_names.Clear();
+  m_attributes.Clear();
+  m_children.Clear();
+  m_totals.clear();
+  m_idToIndex.SetScheme(scheme);
+  ResyncStandingLocked();
+  m_generation.fetch_add(1, std::memory_order_release);
+  PublishGaugesLocked();
+}
+
+IdScheme SearchIndex::GetIdScheme() const {
+  auto lock = LockShared();
+  return m_idToIndex.Scheme();
+}
+
+void SearchIndex::SetPathFormat(std::wstring rootPrefix, wchar_t separator) {
+  auto lock = LockExclusive();
+  m_rootPrefix = std::move(rootPrefix);
+  m_separator = separator;
 }
 
 void SearchIndex::Insert(const FileEntry &entry) {
-  std::unique_lock lock(m_mutex);
+  auto lock = LockExclusive();
+  InsertLocked(entry);
+  m_generation.fetch_add(1, std::memory_order_release);
+  MaintainChildrenLocked();
+  PublishGaugesLocked();
+}
 
-  if (auto it = m_idToIndex.find(entry.id); it != m_idToIndex.end()) {
-    size_t idx = it->second;
-    m_files[idx] = entry;
-    m_files[idx].active = true;
-  } else {
-    m_files.push_back(entry);
-    m_idToIndex[entry.id] = m_files.size() - 1;
+void SearchIndex::InsertLocked(const FileEntry &entry) {
+  if (size_t idx = m_idToIndex.Find(entry.id); idx != IdSlotMap::npos) {
+    StoredEntry &file = m_files[idx];
+    const FolderTotals before = ContributionLocked(idx);
+    const unsigned long long oldParentId = file.parentId;
+    // Acquired before the old name is released, in case they are the same.
+    const NamePool::NameId name = m_names.Acquire(entry.name);
+    const EntryChange change =
+        name != file.name || oldParentId != entry.parentId
+            ? EntryChange::Moved
+        : file.fileAttributes != entry.fileAttributes ? EntryChange::Attributes
+                                                      : EntryChange::None;
+    m_names.Release(file.name);
+    m_attributes.Update(idx, file.fileAttributes, entry.fileAttributes);
+    if (file.parentId != entry.parentId) {
+      m_children.Moved(ChildSlot(idx), file.parentId, entry.parentId,
+                       ChildSlot(m_idToIndex.Find(entry.parentId)));
+    }
+    file.name = name;
+    file.parentId = entry.parentId;
+    file.fileAttributes = entry.fileAttributes;
+    file.active = true;
+    // A re-listing without metadata must not wipe what a stat pass found.
+    if (entry.lastWriteTime != 0) {
+      file.size = entry.size;
+      file.lastWriteTime = entry.lastWriteTime;
+    }
+    RetotalLocked(idx, oldParentId, before);
+    NoteChangeLocked(file.id, &file, change);
+    return;
+  }
+
+  if (m_files.size() == m_files.capacity()) {
+    PULSEFS_TRACE_SPAN(span, "SearchIndex grow entries");
+    span.SetArg("capacity", m_files.capacity());
+    m_files.reserve(std::max<size_t>(1024, m_files.capacity() * 2));
   }
+  m_files.push_back({entry.id, entry.parentId, entry.size,
+                     entry.lastWriteTime, entry.fileAttributes,
+                     m_names.Acquire(entry.name), true});
+  m_totals.emplace_back();
+  const size_t slot = m_files.size() - 1;
+  m_attributes.Update(slot, 0, entry.fileAttributes);
+  if (entry.id != entry.parentId)
+    m_children.Added(ChildSlot(slot), entry.parentId);
+  size_t stale = m_idToIndex.Assign(entry.id, slot);
+  if (stale != IdSlotMap::npos) {
+    StoredEntry &file = m_files[stale];
+    const FolderTotals before = ContributionLocked(stale);
+    file.active = false;
+    m_attributes.Update(stale, file.fileAttributes, 0);
+    m_names.Release(file.name);
+    file.name = NamePool::kNone;
+    m_children.Retired(ChildSlot(stale), file.id, file.parentId);
+    RetotalLocked(stale, file.parentId, before);
+    NoteChangeLocked(file.id, nullptr);
+  }
+  // Children can arrive before their directory, journal events especially.
+  if (!m_bulkLoads) {
+    std::vector<uint32_t> children;
+    ChildSlotsLocked(entry.id, children);
+    for (uint32_t child : children)
+      Accumulate(m_totals[slot], ContributionLocked(child), false);
+  }
+  RetotalLocked(slot, entry.parentId, {});
+  NoteChangeLocked(entry.id, &m_files.back());
 }
 
 void SearchIndex::Remove(unsigned long long id) {
-  std::unique_lock lock(m_mutex);
-  if (auto it = m_idToIndex.find(id); it != m_idToIndex.end()) {
-    size_t idx = it->second;
-    m_files[idx].active = false;
-    m_idToIndex.erase(it);
+  auto lock = LockExclusive();
+  RemoveLocked(id);
+  m_generation.fetch_add(1, std::memory_order_release);
+  MaintainChildrenLocked();
+  PublishGaugesLocked();
+}
+
+void SearchIndex::RemoveLocked(unsigned long long id) {
+  if (size_t idx = m_idToIndex.Find(id); idx != IdSlotMap::npos) {
+    StoredEntry &file = m_files[idx];
+    const FolderTotals before = ContributionLocked(idx);
+    file.active = false;
+    m_attributes.Update(idx, file.fileAttributes, 0);
+    m_names.Release(file.name);
+    file.name = NamePool::kNone;
+    m_children.Retired(ChildSlot(idx), id, file.parentId);
+    RetotalLocked(idx, file.parentId, before);
+    m_idToIndex.Erase(id);
+    NoteChangeLocked(id, nullptr);
   }
 }
 
 void SearchIndex::Rename(unsigned long long id, const std::wstring &newName,
                          unsigned long long newParentId) {
-  std::unique_lock lock(m_mutex);
-  if (auto it = m_idToIndex.find(id); it != m_idToIndex.end()) {
-    size_t idx = it->second;
-    m_files[idx].name = newName;
-    m_files[idx].parentId = newParentId;
-    m_files[idx].active = true;
+  auto lock = LockExclusive();
+  RenameLocked(id, newName, newParentId);
+  m_generation.fetch_add(1, std::memory_order_release);
+  MaintainChildrenLocked();
+  PublishGaugesLocked();
+}
+
+void SearchIndex::RenameLocked(unsigned long long id,
+                               const std::wstring &newName,
+                               unsigned long long newParentId) {
+  if (size_t idx = m_idToIndex.Find(id); idx != IdSlotMap::npos) {
+    StoredEntry &file = m_files[idx];
+    const NamePool::NameId name = m_names.Acquire(newName);
+    const bool moved = name != file.name || file.parentId != newParentId;
+    m_names.Release(file.name);
+    if (file.parentId != newParentId) {
+      const FolderTotals before = ContributionLocked(idx);
+      const unsigned long long oldParentId = file.parentId;
+      m_children.Moved(ChildSlot(idx), file.parentId, newParentId,
+                       ChildSlot(m_idToIndex.Find(newParentId)));
+      file.parentId = newParentId;
+      RetotalLocked(idx, oldParentId, before);
+    }
+    file.name = name;
+    file.active = true;
+    NoteChangeLocked(id, &file,
+                     moved ? EntryChange::Moved : EntryChange::None);
   } else {
 
-    Insert({newName, id, newParentId, true});
+    InsertLocked({newName, id, newParentId, 0, true});
   }
 }
 
+void SearchIndex::ApplyBatch(const std::vector<IndexChange> &changes) {
+  if (changes.empty())
+    return;
+
+  PULSEFS_TRACE_SPAN(span, "SearchIndex::ApplyBatch");
+  span.SetArg("changes", changes.size());
+  std::unique_lock<std::shared_mutex> lock;
+  {
+    PULSEFS_TRACE_SCOPE("SearchIndex::ApplyBatch lock wait");
+    lock = LockExclusive();
+  }
+  for (const auto &change : changes) {
+    const FileEntry &entry = change.entry;
+    switch (change.kind) {
+    case ChangeKind::Insert:
+      InsertLocked(entry);
+      break;
+    case ChangeKind::Remove:
+      RemoveLocked(entry.id);
+      break;
+    case ChangeKind::Rename:
+      if (m_idToIndex.Find(entry.id) != IdSlotMap::npos) {
+        RenameLocked(entry.id, entry.name, entry.parentId);
+      } else {
+        InsertLocked(entry);
+      }
+      break;
+    case ChangeKind::SetAttributes:
+      if (size_t idx = m_idToIndex.Find(entry.id); idx != IdSlotMap::npos) {
+        const FolderTotals before = ContributionLocked(idx);
+        const EntryChange change =
+            m_files[idx].fileAttributes != entry.fileAttributes
+                ? EntryChange::Attributes
+                : EntryChange::None;
+        m_attributes.Update(idx, m_files[idx].fileAttributes,
+                            entry.fileAttributes);
+        m_files[idx].fileAttributes = entry.fileAttributes;
+        RetotalLocked(idx, m_files[idx].parentId, before);
+        // Attribute filters make this a membership change too.
+        NoteChangeLocked(entry.id, &m_files[idx], change);
+      } else {
+        InsertLocked(entry);
+      }
+      break;
+    case ChangeKind::SetMetadata:
+      if (size_t idx = m_idToIndex.Find(entry.id); idx != IdSlotMap::npos) {
+        const FolderTotals before = ContributionLocked(idx);
+        m_files[idx].size = entry.size;
+        m_files[idx].lastWriteTime = entry.lastWriteTime;
+        RetotalLocked(idx, m_files[idx].parentId, before);
+      }
+      break;
+    }
+  }
+  m_generation.fetch_add(1, std::memory_order_release);
+  MaintainChildrenLocked();
+  PublishGaugesLocked();
+}
+
+void SearchIndex::BeginBulkLoad() {
+  auto lock = LockExclusive();
+  m_bulkLoads++;
+}
+
+void SearchIndex::EndBulkLoad() {
+  auto lock = LockExclusive();
+  if (m_bulkLoads == 0 || --m_bulkLoads > 0)
+    return;
+  RecomputeTotalsLocked(RebuildChildrenLocked());
+  PublishGaugesLocked();
+}
+
+void SearchIndex::PublishGaugesLocked() {
+  m_gauges.liveEntries.store(m_idToIndex.Size(), std::memory_order_relaxed);
+  m_gauges.distinctNames.store(m_names.Size(), std::memory_order_relaxed);
+  m_gauges.entryBytes.store(m_files.capacity() * sizeof(StoredEntry),
+                            std::memory_order_relaxed);
+  m_gauges.nameBytes.store(m_names.MemoryUsage(), std::memory_order_relaxed);
+  m_gauges.idMapBytes.store(m_idToIndex.MemoryUsage(),
+                            std::memory_order_relaxed);
+  m_gauges.attributeBytes.store(m_attributes.MemoryUsage(),
+                                std::memory_order_relaxed);
+  m_gauges.childBytes.store(m_children.MemoryUsage(),
+                            std::memory_order_relaxed);
+  m_gauges.totalsBytes.store(m_totals.capacity() * sizeof(FolderTotals),
+                             std::memory_order_relaxed);
+}
+
+void SearchIndex::RecordQuery(size_t queryLength,
+                              std::chrono::steady_clock::time_point start,
+                              size_t scanned) const {
+  m_queryLatency[QueryLengthClass(queryLength)].Record(NanosecondsSince(start));
+  if (scanned)
+    m_entriesScanned.fetch_add(scanned, std::memory_order_relaxed);
+}
+
 std::vector<unsigned long long> SearchIndex::Search(std::wstring_view query,
-                                                    size_t maxResults) const {
-  std::shared_lock lock(m_mutex);
+                                                    size_t maxResults,
+                                                    AttributeFilter filter) const {
+  PULSEFS_TRACE_SPAN(span, "SearchIndex::Search");
+  const auto start = std::chrono::steady_clock::now();
+  std::shared_lock<std::shared_mutex> lock;
+  {
+    PULSEFS_TRACE_SCOPE("SearchIndex::Search lock wait");
+    lock = LockShared();
+  }
+  size_t scanned = 0;
+  std::vector<unsigned long long> results =
+      SearchLocked(query, maxResults, filter, nullptr, scanned);
+  RecordQuery(query.size(), start, scanned);
+  span.SetArg("scanned", scanned);
+  return results;
+}
+
+std::vector<unsigned long long>
+SearchIndex::SearchLocked(std::wstring_view query, size_t maxResults,
+                          const AttributeFilter &filter,
+                          const std::atomic<bool> *cancelled,
+                          size_t &scanned) const {
   std::vector<unsigned long long> results;
-  results.reserve(maxResults);
+  results.reserve(std::min<size_t>(maxResults, 1024));
+  if (maxResults == 0)
+    return results;
+
+  const AttributeFilter unindexed = AttributeBitmaps::Unindexed(filter);
+  t_verdicts.Begin(m_names.IdLimit(), 1);
+  const size_t slots = m_files.size();
+  for (size_t word = 0; word * 64 < slots; ++word) {
+    uint64_t candidates = filter.Empty()
+                              ? ~uint64_t(0)
+                              : m_attributes.Candidates(word, filter);
+    while (candidates) {
+      const size_t slot = word * 64 + std::countr_zero(candidates);
+      candidates &= candidates - 1;
+      if (slot >= slots)
+        break;
 
-  int count = 0;
+      if (++scanned % kCancelCheckInterval == 0 && cancelled &&
+          cancelled->load())
+        return results;
+      const StoredEntry &file = m_files[slot];
+      if (!file.active || !unindexed.Matches(file.fileAttributes))
+        continue;
 
-  for (const auto &file : m_files) {
-    if (!file.active)
-      continue;
+      const uint64_t *verdict = t_verdicts.Find(file.name);
+      if (!verdict) {
+        const std::wstring &name = m_names.Get(file.name);
+        auto it = std::search(name.begin(), name.end(), query.begin(),
+                              query.end(), [](wchar_t a, wchar_t b) {
+                                return std::towlower(a) == std::towlower(b);
+                              });
+        uint64_t *row = t_verdicts.Record(file.name);
+        row[0] = it != name.end();
+        verdict = row;
+      }
+
+      if (verdict[0]) {
+        results.push_back(file.id);
+        if (results.size() >= maxResults)
+          return results;
+      }
+    }
+  }
+  return results;
+}
+
+std::shared_ptr<StandingQuery>
+SearchIndex::Subscribe(std::wstring_view query, size_t maxResults,
+                       std::vector<unsigned long long> &results,
+                       std::optional<uint64_t> knownGeneration,
+                       AttributeFilter filter,
+                       const std::atomic<bool> *cancelled) {
+  PULSEFS_TRACE_SPAN(span, "SearchIndex::Subscribe");
+  std::wstring lowered(query.size(), L'\0');
+  std::transform(query.begin(), query.end(), lowered.begin(),
+                 [](wchar_t c) { return std::towlower(c); });
+  auto standing =
+      std::make_shared<StandingQuery>(std::move(lowered), maxResults, filter);
+
+  auto lock = LockShared();
+  // Writers bump the generation under the exclusive lock, so it cannot move
+  // while we hold the shared one.
+  if (knownGeneration != Generation()) {
+    const auto start = std::chrono::steady_clock::now();
+    size_t scanned = 0;
+    results = SearchLocked(query, maxResults, filter, cancelled, scanned);
+    RecordQuery(query.size(), start, scanned);
+  }
+  // A cancelled scan stopped short; its results are not the match set.
+  if (cancelled && cancelled->load()) {
+    results.clear();
+    return nullptr;
+  }
+  standing->m_members.insert(results.begin(), results.end());
+  standing->m_complete = results.size() < maxResults;
+
+  std::lock_guard guard(m_standingMutex);
+  m_standing.push_back(standing);
+  return standing;
+}
+
+void SearchIndex::Unsubscribe(const std::shared_ptr<StandingQuery> &standing) {
+  if (!standing)
+    return;
+  auto lock = LockShared();
+  std::lock_guard guard(m_standingMutex);
+  std::erase(m_standing, standing);
+}
+
+void SearchIndex::NoteChangeLocked(unsigned long long id,
+                                   const StoredEntry *file,
+                                   EntryChange change) {
+  if (m_standing.empty())
+    return;
+  // Every path below a moved directory changed with it, and nothing cheap
+  // says which members lie below it.
+  const bool movedDirectory = change == EntryChange::Moved && file &&
+                              (file->fileAttributes & kAttributeDirectory);
+
+  if (file) {
+    const std::wstring &name = m_names.Get(file->name);
+    m_foldedName.resize(name.size());
+    std::transform(name.begin(), name.end(), m_foldedName.begin(),
+                   [](wchar_t c) { return std::towlower(c); });
+  }
 
-    auto it = std::search(file.name.begin(), file.name.end(), query.begin(),
-                          query.end(), [](wchar_t a, wchar_t b) {
-                            return std::towlower(a) == std::towlower(b);
-                          });
+  for (const auto &standing : m_standing) {
+    const bool matches =
+        file && standing->m_filter.Matches(file->fileAttributes) &&
+        m_foldedName.find(standing->m_query) != std::wstring::npos;
+    auto &members = standing->m_members;
+    if (movedDirectory && !members.empty())
+      standing->QueuePathsChanged();
+    if (members.contains(id)) {
+      if (matches) {
+        if (change != EntryChange::None)
+          standing->QueueUpdate(id);
+        continue;
+      }
+      members.erase(id);
+      standing->QueueRemove(id);
+      // Matches beyond the window were never tracked; once the visible
+      // results thin out, only a fresh scan can refill them.
+      if (!standing->m_complete && members.size() < standing->m_maxResults / 2)
+        standing->QueueResync();
+    } else if (matches) {
+      if (members.size() < standing->m_maxResults) {
+        members.insert(id);
+        standing->QueueAdd(id);
+      } else {
+        standing->m_complete = false;
+      }
+    }
+  }
+}
+
+void SearchIndex::ResyncStandingLocked() {
+  for (const auto &standing : m_standing) {
+    standing->m_members.clear();
+    standing->QueueResync();
+  }
+}
+
+std::vector<std::vector<unsigned long long>>
+SearchIndex::SearchMany(const std::vector<SearchRequest> &requests) const {
+  PULSEFS_TRACE_SPAN(span, "SearchIndex::SearchMany");
+  span.SetArg("queries", requests.size());
+  const auto start = std::chrono::steady_clock::now();
+  std::vector<std::vector<unsigned long long>> results(requests.size());
+  std::vector<std::wstring> lowered(requests.size());
+  std::vector<size_t> active;
+  for (size_t i = 0; i < requests.size(); ++i) {
+    lowered[i].resize(requests[i].query.size());
+    std::transform(requests[i].query.begin(), requests[i].query.end(),
+                   lowered[i].begin(),
+                   [](wchar_t c) { return std::towlower(c); });
+    if (requests[i].maxResults > 0)
+      active.push_back(i);
+  }
+
+  auto lock = LockShared();
+  std::wstring name;
+  size_t scanned = 0;
+  // Per request, the slots of the current word its filter lets through.
+  std::vector<uint64_t> candidates(requests.size());
+  t_verdicts.Begin(m_names.IdLimit(), requests.size());
+  const size_t slots = m_files.size();
+  for (size_t word = 0; word * 64 < slots && !active.empty(); ++word) {
+    uint64_t wanted = 0;
+    for (size_t i : active) {
+      const AttributeFilter &filter = requests[i].filter;
+      candidates[i] = filter.Empty() ? ~uint64_t(0)
+                                     : m_attributes.Candidates(word, filter);
+      wanted |= candidates[i];
+    }
 
-    if (it != file.name.end()) {
-      results.push_back(file.id);
-      if (++count >= static_cast<int>(maxResults))
+    while (wanted && !active.empty()) {
+      const unsigned bit = static_cast<unsigned>(std::countr_zero(wanted));
+      wanted &= wanted - 1;
+      const size_t slot = word * 64 + bit;
+      if (slot >= slots)
         break;
+      if (++scanned % kCancelCheckInterval == 0) {
+        std::erase_if(active, [&](size_t i) {
+          return requests[i].cancelled && requests[i].cancelled->load();
+        });
+      }
+      const StoredEntry &file = m_files[slot];
+      if (!file.active)
+        continue;
+
+      // Requests that finish later drop out of `active`, never in, so a
+      // verdict recorded for the requests active now stays good.
+      const uint64_t *verdict = t_verdicts.Find(file.name);
+      if (!verdict) {
+        const std::wstring &text = m_names.Get(file.name);
+        name.resize(text.size());
+        std::transform(text.begin(), text.end(), name.begin(),
+                       [](wchar_t c) { return std::towlower(c); });
+        uint64_t *row = t_verdicts.Record(file.name);
+        for (size_t i : active) {
+          if (name.find(lowered[i]) != std::wstring::npos)
+            row[i / 64] |= uint64_t(1) << (i % 64);
+        }
+        verdict = row;
+      }
+
+      for (size_t k = 0; k < active.size();) {
+        const size_t i = active[k];
+        if (((candidates[i] >> bit) & 1) &&
+            ((verdict[i / 64] >> (i % 64)) & 1) &&
+            AttributeBitmaps::Unindexed(requests[i].filter)
+                .Matches(file.fileAttributes)) {
+          results[i].push_back(file.id);
+          if (results[i].size() >= requests[i].maxResults) {
+            active[k] = active.back();
+            active.pop_back();
+            continue;
+          }
+        }
+        ++k;
+      }
     }
   }
+  lock.unlock();
+
+  // The pass is counted once, but every request waited for all of it.
+  for (size_t i = 0; i < requests.size(); ++i)
+    RecordQuery(requests[i].query.size(), start, i == 0 ? scanned : 0);
   return results;
 }
 
@@ -86,47 +692,498 @@ std::wstring SearchIndex::ResolvePathInternal(unsigned long long id) const {
   unsigned long long currentId = id;
   int safety = 0;
 
-  auto it = m_idToIndex.find(currentId);
-  if (it == m_idToIndex.end())
+  size_t idx = m_idToIndex.Find(currentId);
+  if (idx == IdSlotMap::npos)
     return L"";
 
-  path = m_files[it->second].name;
-  currentId = m_files[it->second].parentId;
+  // A root's path is the prefix itself; its name ("x" under "/home/x/", or
+  // the MFT's ".") only stands in for it in the tree.
+  if (m_files[idx].id == m_files[idx].parentId) {
+    std::wstring root = m_rootPrefix;
+    if (root.size() > 1 && root.back() == m_separator &&
+        root[root.size() - 2] != L':')
+      root.pop_back();
+    return root;
+  }
+
+  path = m_names.Get(m_files[idx].name);
+  currentId = m_files[idx].parentId;
 
   while (safety++ < 256) {
-    auto parentIt = m_idToIndex.find(currentId);
-    if (parentIt == m_idToIndex.end())
+    size_t parentIdx = m_idToIndex.Find(currentId);
+    if (parentIdx == IdSlotMap::npos)
       break;
 
-    const auto &file = m_files[parentIt->second];
-
-    if (file.id == file.parentId) {
+    const auto &file = m_files[parentIdx];
 
+    if (file.id == file.parentId)
       break;
-    }
 
-    path = file.name + L"\\" + path;
+    path = m_names.Get(file.name) + m_separator + path;
     currentId = file.parentId;
   }
-  return L"C:\\" + path;
+  return m_rootPrefix + path;
 }
 
 std::wstring SearchIndex::GetFullPath(unsigned long long id) const {
-  std::shared_lock lock(m_mutex);
+  auto lock = LockShared();
   return ResolvePathInternal(id);
 }
 
 unsigned long SearchIndex::GetAttributes(unsigned long long id) const {
-  std::shared_lock lock(m_mutex);
-  if (auto it = m_idToIndex.find(id); it != m_idToIndex.end()) {
-    size_t idx = it->second;
+  auto lock = LockShared();
+  if (size_t idx = m_idToIndex.Find(id); idx != IdSlotMap::npos) {
     return m_files[idx].fileAttributes;
   }
   return 0;
 }
 
+std::vector<ResolvedEntry>
+SearchIndex::Resolve(const std::vector<unsigned long long> &ids) const {
+  std::vector<ResolvedEntry> entries(ids.size());
+  if (ids.empty())
+    return entries;
+  auto lock = LockShared();
+  for (size_t i = 0; i < ids.size(); ++i) {
+    if (size_t idx = m_idToIndex.Find(ids[i]); idx != IdSlotMap::npos) {
+      entries[i].path = ResolvePathInternal(ids[i]);
+      entries[i].attributes = m_files[idx].fileAttributes;
+    }
+  }
+  return entries;
+}
+
+unsigned long long SearchIndex::GetSize(unsigned long long id) const {
+  auto lock = LockShared();
+  if (size_t idx = m_idToIndex.Find(id); idx != IdSlotMap::npos) {
+    return m_files[idx].size;
+  }
+  return 0;
+}
+
+long long SearchIndex::GetLastWriteTime(unsigned long long id) const {
+  auto lock = LockShared();
+  if (size_t idx = m_idToIndex.Find(id); idx != IdSlotMap::npos) {
+    return m_files[idx].lastWriteTime;
+  }
+  return 0;
+}
+
+bool SearchIndex::Contains(unsigned long long id) const {
+  auto lock = LockShared();
+  return m_idToIndex.Find(id) != IdSlotMap::npos;
+}
+
+void SearchIndex::MaintainChildrenLocked() {
+  if (m_children.Drift() >
+      std::max(kMinChildDrift, m_children.BaseSlots() / 2))
+    RebuildChildrenLocked();
+}
+
+std::vector<uint32_t> SearchIndex::RebuildChildrenLocked() {
+  PULSEFS_TRACE_SPAN(span, "SearchIndex rebuild children");
+  span.SetArg("entries", m_files.size());
+  std::vector<uint32_t> parentSlots(m_files.size(), ChildIndex::kNoSlot);
+  std::vector<ChildIndex::Orphan> orphans;
+  for (size_t slot = 0; slot < m_files.size(); ++slot) {
+    const StoredEntry &file = m_files[slot];
+    if (!file.active || file.id == file.parentId)
+      continue;
+    const size_t parent = m_idToIndex.Find(file.parentId);
+    if (parent != IdSlotMap::npos)
+      parentSlots[slot] = ChildSlot(parent);
+    else
+      orphans.push_back({ChildSlot(slot), file.parentId});
+  }
+  m_children.Rebuild(parentSlots, orphans);
+  return parentSlots;
+}
+
+void SearchIndex::ChildSlotsLocked(unsigned long long parentId,
+                                   std::vector<uint32_t> &slots) const {
+  const size_t parentSlot = m_idToIndex.Find(parentId);
+  const size_t firstCandidate = slots.size();
+  m_children.Candidates(parentId, ChildSlot(parentSlot), slots);
+  // Built ranges go stale as entries move; keep only current children.
+  auto isChild = [&](size_t slot) {
+    const StoredEntry &file = m_files[slot];
+    return file.active && file.parentId == parentId && slot != parentSlot;
+  };
+  slots.erase(std::remove_if(slots.begin() + firstCandidate, slots.end(),
+                             [&](uint32_t slot) { return !isChild(slot); }),
+              slots.end());
+}
+
+FolderTotals SearchIndex::ContributionLocked(size_t slot) const {
+  const StoredEntry &file = m_files[slot];
+  FolderTotals contribution = m_totals[slot];
+  if (file.fileAttributes & kAttributeDirectory) {
+    contribution.folders++;
+  } else {
+    contribution.bytes += file.size;
+    contribution.files++;
+  }
+  return contribution;
+}
+
+void SearchIndex::AddToAncestorsLocked(unsigned long long parentId,
+                                       const FolderTotals &delta,
+                                       bool subtract) {
+  for (size_t depth = 0; depth < kMaxFolderDepth; ++depth) {
+    const size_t slot = m_idToIndex.Find(parentId);
+    if (slot == IdSlotMap::npos)
+      return;
+    Accumulate(m_totals[slot], delta, subtract);
+    const StoredEntry &parent = m_files[slot];
+    if (parent.id == parent.parentId)
+      return;
+    parentId = parent.parentId;
+  }
+}
+
+void SearchIndex::RetotalLocked(size_t slot, unsigned long long oldParentId,
+                                const FolderTotals &before) {
+  if (m_bulkLoads)
+    return;
+  const StoredEntry &file = m_files[slot];
+  const FolderTotals after =
+      file.active ? ContributionLocked(slot) : FolderTotals{};
+  // A root is its own parent and adds nothing above itself.
+  if (oldParentId == file.parentId) {
+    if (file.parentId == file.id || SameTotals(before, after))
+      return;
+    // Unsigned, so the difference wraps and adding it still lands right.
+    FolderTotals delta = after;
+    Accumulate(delta, before, true);
+    AddToAncestorsLocked(file.parentId, delta, false);
+    return;
+  }
+  if (oldParentId != file.id)
+    AddToAncestorsLocked(oldParentId, before, true);
+  if (file.parentId != file.id)
+    AddToAncestorsLocked(file.parentId, after, false);
+}
+
+void SearchIndex::RecomputeTotalsLocked(
+    const std::vector<uint32_t> &parentSlots) {
+  PULSEFS_TRACE_SPAN(span, "SearchIndex recompute totals");
+  span.SetArg("entries", m_files.size());
+  // Children before parents: a slot is folded into its parent once all of
+  // its own children have been folded into it.
+  m_totals.assign(m_files.size(), {});
+  std::vector<uint32_t> pending(m_files.size(), 0);
+  for (uint32_t parent : parentSlots) {
+    if (parent != ChildIndex::kNoSlot)
+      pending[parent]++;
+  }
+  std::vector<uint32_t> ready;
+  for (size_t slot = 0; slot < m_files.size(); ++slot) {
+    if (pending[slot] == 0)
+      ready.push_back(static_cast<uint32_t>(slot));
+  }
+  while (!ready.empty()) {
+    const uint32_t slot = ready.back();
+    ready.pop_back();
+    const uint32_t parent = parentSlots[slot];
+    if (parent == ChildIndex::kNoSlot)
+      continue;
+    Accumulate(m_totals[parent], ContributionLocked(slot), false);
+    if (--pending[parent] == 0)
+      ready.push_back(parent);
+  }
+}
+
+std::optional<FolderTotals>
+SearchIndex::GetFolderTotals(unsigned long long id) const {
+  auto lock = LockShared();
+  const size_t idx = m_idToIndex.Find(id);
+  if (idx == IdSlotMap::npos || m_bulkLoads)
+    return std::nullopt;
+  return m_totals[idx];
+}
+
+std::vector<std::pair<unsigned long long, FolderTotals>>
+SearchIndex::LargestFolders(unsigned long long id, size_t count) const {
+  PULSEFS_TRACE_SPAN(span, "SearchIndex::LargestFolders");
+  std::vector<std::pair<unsigned long long, FolderTotals>> largest;
+  auto lock = LockShared();
+  if (m_bulkLoads || count == 0)
+    return largest;
+
+  // No folder holds more than its parent, so expanding the largest folder
+  // seen so far yields the answer in order and leaves the rest unvisited.
+  std::priority_queue<std::pair<unsigned long long, uint32_t>> frontier;
+  std::vector<uint32_t> children;
+  auto expand = [&](unsigned long long parentId) {
+    children.clear();
+    ChildSlotsLocked(parentId, children);
+    for (uint32_t slot : children) {
+      if (m_files[slot].fileAttributes & kAttributeDirectory)
+        frontier.emplace(m_totals[slot].bytes, slot);
+    }
+  };
+  expand(id);
+  while (!frontier.empty() && largest.size() < count) {
+    const uint32_t slot = frontier.top().second;
+    frontier.pop();
+    largest.emplace_back(m_files[slot].id, m_totals[slot]);
+    expand(m_files[slot].id);
+  }
+  span.SetArg("frontier", frontier.size());
+  return largest;
+}
+
+std::vector<FileEntry>
+SearchIndex::GetChildren(unsigned long long parentId) const {
+  auto lock = LockShared();
+  std::vector<uint32_t> slots;
+  ChildSlotsLocked(parentId, slots);
+  std::vector<FileEntry> children;
+  children.reserve(slots.size());
+  for (uint32_t slot : slots)
+    children.push_back(LoadEntry(m_files[slot]));
+  return children;
+}
+
+std::vector<unsigned long long>
+SearchIndex::GetChildIds(unsigned long long parentId) const {
+  auto lock = LockShared();
+  std::vector<uint32_t> slots;
+  ChildSlotsLocked(parentId, slots);
+  std::vector<unsigned long long> ids;
+  ids.reserve(slots.size());
+  for (uint32_t slot : slots)
+    ids.push_back(m_files[slot].id);
+  return ids;
+}
+
+std::vector<unsigned long long> SearchIndex::GetRootIds() const {
+  auto lock = LockShared();
+  std::vector<unsigned long long> roots;
+  for (const auto &file : m_files) {
+    if (file.active && file.id == file.parentId)
+      roots.push_back(file.id);
+  }
+  return roots;
+}
+
+std::vector<std::optional<unsigned long long>>
+SearchIndex::FindChildren(const std::vector<ChildKey> &keys) const {
+  std::vector<std::optional<unsigned long long>> ids(keys.size());
+  if (keys.empty())
+    return ids;
+
+  auto lock = LockShared();
+  // Names are compared by id; a name the index has never seen has no child.
+  std::unordered_map<unsigned long long,
+                     std::vector<std::pair<NamePool::NameId, size_t>>>
+      byParent;
+  for (size_t i = 0; i < keys.size(); ++i) {
+    if (auto name = m_names.Find(keys[i].name))
+      byParent[keys[i].parentId].emplace_back(*name, i);
+  }
+  std::vector<uint32_t> slots;
+  for (const auto &[parentId, names] : byParent) {
+    slots.clear();
+    ChildSlotsLocked(parentId, slots);
+    for (uint32_t slot : slots) {
+      for (const auto &[name, keyIndex] : names) {
+        if (name == m_files[slot].name)
+          ids[keyIndex] = m_files[slot].id;
+      }
+    }
+  }
+  return ids;
+}
+
 size_t SearchIndex::Count() const {
+  auto lock = LockShared();
+  return m_idToIndex.Size();
+}
+
+void SearchIndex::SetLockTracking(bool enabled) {
+  m_trackLockWaits = enabled;
+}
+
+LockWaitStats SearchIndex::GetLockWaitStats() const {
+  const auto exclusive = m_exclusiveWaits.Snapshot();
+  const auto shared = m_sharedWaits.Snapshot();
+  LockWaitStats stats;
+  stats.exclusiveAcquisitions = exclusive.count;
+  stats.exclusiveWaitNs = exclusive.sum;
+  stats.exclusiveMaxWaitNs = exclusive.max;
+  stats.sharedAcquisitions = shared.count;
+  stats.sharedWaitNs = shared.sum;
+  stats.sharedMaxWaitNs = shared.max;
+  return stats;
+}
+
+IndexStats SearchIndex::GetStats() const {
+  IndexStats stats;
+  for (size_t i = 0; i < kQueryLengthClasses; ++i)
+    stats.queryLatencyNs[i] = m_queryLatency[i].Snapshot();
+  stats.entriesScanned = m_entriesScanned.load(std::memory_order_relaxed);
+  stats.exclusiveWaitNs = m_exclusiveWaits.Snapshot();
+  stats.sharedWaitNs = m_sharedWaits.Snapshot();
+  stats.liveEntries = m_gauges.liveEntries.load(std::memory_order_relaxed);
+  stats.distinctNames =
+      m_gauges.distinctNames.load(std::memory_order_relaxed);
+  stats.entryBytes = m_gauges.entryBytes.load(std::memory_order_relaxed);
+  stats.nameBytes = m_gauges.nameBytes.load(std::memory_order_relaxed);
+  stats.idMapBytes = m_gauges.idMapBytes.load(std::memory_order_relaxed);
+  stats.attributeBytes =
+      m_gauges.attributeBytes.load(std::memory_order_relaxed);
+  stats.childBytes = m_gauges.childBytes.load(std::memory_order_relaxed);
+  stats.totalsBytes = m_gauges.totalsBytes.load(std::memory_order_relaxed);
+  return stats;
+}
+
+FileEntry SearchIndex::LoadEntry(const StoredEntry &file) const {
+  FileEntry entry;
+  entry.name = m_names.Get(file.name);
+  entry.id = file.id;
+  entry.parentId = file.parentId;
+  entry.fileAttributes = file.fileAttributes;
+  entry.active = file.active;
+  entry.size = file.size;
+  entry.lastWriteTime = file.lastWriteTime;
+  return entry;
+}
+
+std::unique_lock<std::shared_mutex> SearchIndex::LockExclusive() const {
+  if (!m_trackLockWaits.load(std::memory_order_relaxed))
+    return std::unique_lock(m_mutex);
+  const auto start = std::chrono::steady_clock::now();
+  std::unique_lock lock(m_mutex);
+  m_exclusiveWaits.Record(NanosecondsSince(start));
+  return lock;
+}
+
+std::shared_lock<std::shared_mutex> SearchIndex::LockShared() const {
+  if (!m_trackLockWaits.load(std::memory_order_relaxed))
+    return std::shared_lock(m_mutex);
+  const auto start = std::chrono::steady_clock::now();
   std::shared_lock lock(m_mutex);
-  return m_idToIndex.size();
+  m_sharedWaits.Record(NanosecondsSince(start));
+  return lock;
+}
+
+size_t SearchIndex::MemoryUsage() const {
+  return m_gauges.entryBytes.load(std::memory_order_relaxed) +
+         m_gauges.nameBytes.load(std::memory_order_relaxed) +
+         m_gauges.idMapBytes.load(std::memory_order_relaxed) +
+         m_gauges.attributeBytes.load(std::memory_order_relaxed) +
+         m_gauges.childBytes.load(std::memory_order_relaxed) +
+         m_gauges.totalsBytes.load(std::memory_order_relaxed);
+}
+
+bool SearchIndex::SaveSnapshot(const std::string &path) const {
+  PULSEFS_TRACE_SCOPE("SearchIndex::SaveSnapshot");
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  if (!out)
+    return false;
+
+  auto lock = LockShared();
+  out.write(kSnapshotMagic, sizeof(kSnapshotMagic));
+  WritePod(out, kSnapshotVersion);
+  WritePod(out, static_cast<uint32_t>(m_idToIndex.Scheme()));
+  WritePod(out, static_cast<uint32_t>(m_separator));
+  WriteString(out, m_rootPrefix);
+  WritePod(out, static_cast<uint64_t>(m_idToIndex.Size()));
+
+  for (const auto &file : m_files) {
+    if (!file.active)
+      continue;
+    std::u16string name = Utils::Utf16FromWide(m_names.Get(file.name));
+    SnapshotEntry record{file.id,
+                         file.parentId,
+                         file.size,
+                         file.lastWriteTime,
+                         static_cast<uint32_t>(file.fileAttributes),
+                         static_cast<uint32_t>(name.size())};
+    WritePod(out, record);
+    out.write(reinterpret_cast<const char *>(name.data()),
+              static_cast<std::streamsize>(name.size() * sizeof(char16_t)));
+  }
+  return static_cast<bool>(out);
+}
+
+bool SearchIndex::LoadSnapshot(const std::string &path) {
+  PULSEFS_TRACE_SCOPE("SearchIndex::LoadSnapshot");
+  std::ifstream in(path, std::ios::binary | std::ios::ate);
+  if (!in)
+    return false;
+  // Every length in the file is checked against what is left of it, so a
+  // truncated or corrupt snapshot fails instead of allocating on its word.
+  const std::streamoff fileSize = in.tellg();
+  in.seekg(0);
+  auto remaining = [&] {
+    const std::streamoff position = in.tellg();
+    return position < 0 ? uint64_t(0)
+                        : static_cast<uint64_t>(fileSize - position);
+  };
+
+  char magic[sizeof(kSnapshotMagic)];
+  uint32_t version = 0, scheme = 0, separator = 0, prefixLength = 0;
+  if (!in.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, kSnapshotMagic, sizeof(magic)) != 0 ||
+      !ReadPod(in, version) || version != kSnapshotVersion ||
+      !ReadPod(in, scheme) || !ReadPod(in, separator) ||
+      !ReadPod(in, prefixLength))
+    return false;
+  if (scheme != static_cast<uint32_t>(IdScheme::NtfsFrn) &&
+      scheme != static_cast<uint32_t>(IdScheme::Opaque))
+    return false;
+
+  std::u16string buffer;
+  std::wstring rootPrefix;
+  uint64_t count = 0;
+  if (uint64_t(prefixLength) * sizeof(char16_t) > remaining() ||
+      !ReadUtf16(in, prefixLength, buffer, rootPrefix) || !ReadPod(in, count))
+    return false;
+  if (count > remaining() / sizeof(SnapshotEntry))
+    return false;
+
+  std::vector<FileEntry> files;
+  files.reserve(static_cast<size_t>(count));
+  for (uint64_t i = 0; i < count; ++i) {
+    SnapshotEntry record;
+    FileEntry entry;
+    if (!ReadPod(in, record) ||
+        uint64_t(record.nameLength) * sizeof(char16_t) > remaining() ||
+        !ReadUtf16(in, record.nameLength, buffer, entry.name))
+      return false;
+    entry.id = record.id;
+    entry.parentId = record.parentId;
+    entry.fileAttributes = record.fileAttributes;
+    entry.size = record.size;
+    entry.lastWriteTime = record.lastWriteTime;
+    files.push_back(std::move(entry));
+  }
+
+  auto lock = LockExclusive();
+  m_files.clear();
+  m_names.Clear();
+  m_attributes.Clear();
+  m_children.Clear();
+  m_totals.clear();
+  m_idToIndex.SetScheme(static_cast<IdScheme>(scheme));
+  m_idToIndex.Clear();
+  ResyncStandingLocked();
+  m_idToIndex.Reserve(files.size());
+  m_rootPrefix = std::move(rootPrefix);
+  m_separator = static_cast<wchar_t>(separator);
+  m_files.reserve(files.size());
+  m_totals.reserve(files.size());
+  // Inserted as a bulk load, unless one is already running.
+  m_bulkLoads++;
+  for (const auto &entry : files)
+    InsertLocked(entry);
+  const std::vector<uint32_t> parentSlots = RebuildChildrenLocked();
+  if (--m_bulkLoads == 0)
+    RecomputeTotalsLocked(parentSlots);
+  m_generation.fetch_add(1, std::memory_order_release);
+  PublishGaugesLocked();
+  return true;
 }
 } // namespace PulseFS::Engine
@@ -0,0 +1,219 @@
+#include "PulseFS/Engine/SearchService.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+#include <algorithm>
+
+namespace PulseFS::Engine {
+
+SearchService::SearchService(SearchIndex &index,
+                             const SearchServiceOptions &options)
+    : m_index(index), m_cache(options.cacheCapacity) {
+  const size_t workers = std::max<size_t>(options.workers, 1);
+  m_backgroundLimit = std::max<size_t>(workers - 1, 1);
+  m_threads.reserve(workers);
+  for (size_t i = 0; i < workers; ++i)
+    m_threads.emplace_back(&SearchService::WorkerLoop, this);
+}
+
+SearchService::~SearchService() { Stop(); }
+
+std::future<SearchOutcome> SearchService::Submit(SearchJob job) {
+  auto promise = std::make_shared<std::promise<SearchOutcome>>();
+  std::future<SearchOutcome> future = promise->get_future();
+  Submit(std::move(job), [promise](SearchOutcome outcome) {
+    promise->set_value(std::move(outcome));
+  });
+  return future;
+}
+
+void SearchService::Submit(SearchJob job, SearchCallback callback) {
+  auto pending = std::make_shared<Pending>();
+  pending->job = std::move(job);
+  pending->callback = std::move(callback);
+
+  std::vector<std::shared_ptr<Pending>> superseded;
+  {
+    std::lock_guard lock(m_mutex);
+    if (m_stopping) {
+      superseded.push_back(std::move(pending));
+    } else {
+      const SearchPriority priority = pending->job.priority;
+      auto &lane = m_lanes[static_cast<size_t>(priority)];
+      if (pending->job.supersede) {
+        for (auto it = lane.begin(); it != lane.end();) {
+          if ((*it)->job.supersede) {
+            superseded.push_back(std::move(*it));
+            it = lane.erase(it);
+          } else {
+            ++it;
+          }
+        }
+        for (const auto &running : m_running) {
+          if (running->job.supersede && running->job.priority == priority)
+            running->cancelled = true;
+        }
+      }
+      lane.push_back(std::move(pending));
+    }
+  }
+  m_changed.notify_one();
+
+  for (const auto &stale : superseded)
+    Cancel(*stale);
+}
+
+void SearchService::Stop() {
+  {
+    std::lock_guard lock(m_mutex);
+    if (m_stopping)
+      return;
+    m_stopping = true;
+    for (const auto &running : m_running)
+      running->cancelled = true;
+  }
+  m_changed.notify_all();
+  for (auto &thread : m_threads) {
+    if (thread.joinable())
+      thread.join();
+  }
+
+  std::vector<std::shared_ptr<Pending>> leftover;
+  {
+    std::lock_guard lock(m_mutex);
+    for (auto &lane : m_lanes) {
+      leftover.insert(leftover.end(), lane.begin(), lane.end());
+      lane.clear();
+    }
+  }
+  for (const auto &pending : leftover)
+    Cancel(*pending);
+}
+
+std::shared_ptr<SearchService::Pending> SearchService::TakeLocked() {
+  auto &interactive = m_lanes[static_cast<size_t>(SearchPriority::Interactive)];
+  if (!interactive.empty()) {
+    auto pending = std::move(interactive.front());
+    interactive.pop_front();
+    return pending;
+  }
+  // Keep a worker free for the next keystroke.
+  if (m_backgroundRunning >= m_backgroundLimit)
+    return nullptr;
+  for (size_t i = 1; i < kSearchPriorityCount; ++i) {
+    if (!m_lanes[i].empty()) {
+      auto pending = std::move(m_lanes[i].front());
+      m_lanes[i].pop_front();
+      m_backgroundRunning++;
+      return pending;
+    }
+  }
+  return nullptr;
+}
+
+void SearchService::WorkerLoop() {
+  Utils::Trace::SetThreadName("SearchService worker");
+  while (true) {
+    std::shared_ptr<Pending> pending;
+    {
+      std::unique_lock lock(m_mutex);
+      m_changed.wait(lock, [&] {
+        if (m_stopping)
+          return true;
+        pending = TakeLocked();
+        return pending != nullptr;
+      });
+      // Whatever is still queued is cancelled by Stop.
+      if (m_stopping)
+        return;
+      m_running.push_back(pending);
+    }
+
+    SearchOutcome outcome = Run(*pending);
+
+    const bool background =
+        pending->job.priority != SearchPriority::Interactive;
+    {
+      std::lock_guard lock(m_mutex);
+      std::erase(m_running, pending);
+      if (background)
+        m_backgroundRunning--;
+    }
+    // A finished background job may unblock another worker waiting for a
+    // background slot.
+    if (background)
+      m_changed.notify_all();
+
+    pending->callback(std::move(outcome));
+  }
+}
+
+SearchOutcome SearchService::Run(Pending &pending) {
+  PULSEFS_TRACE_SPAN(span, "SearchService::Run");
+  span.SetArg("priority", static_cast<uint64_t>(pending.job.priority));
+  const SearchJob &job = pending.job;
+  const auto start = std::chrono::steady_clock::now();
+
+  SearchOutcome outcome;
+  outcome.generation = m_index.Generation();
+  if (pending.cancelled) {
+    outcome.cancelled = true;
+    return outcome;
+  }
+
+  if (job.task) {
+    job.task();
+    outcome.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return outcome;
+  }
+
+  if (job.browseParent) {
+    outcome.ids = m_index.GetChildIds(*job.browseParent);
+    outcome.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start);
+    return outcome;
+  }
+
+  // The cache is keyed by query text alone.
+  const bool cacheable = job.filter.Empty();
+  std::optional<uint64_t> knownGeneration;
+  if (cacheable) {
+    std::lock_guard lock(m_cacheMutex);
+    if (auto cached =
+            m_cache.Find(job.query, job.maxResults, outcome.generation)) {
+      outcome.ids = std::move(*cached);
+      knownGeneration = outcome.generation;
+    }
+  }
+
+  if (job.subscribe) {
+    outcome.standing = m_index.Subscribe(job.query, job.maxResults,
+                                         outcome.ids, knownGeneration,
+                                         job.filter, &pending.cancelled);
+  } else if (!knownGeneration) {
+    SearchRequest request{job.query, job.maxResults, &pending.cancelled,
+                          job.filter};
+    outcome.ids = std::move(m_index.SearchMany({request}).front());
+  }
+
+  outcome.cancelled = pending.cancelled;
+  if (outcome.cancelled) {
+    m_index.Unsubscribe(outcome.standing);
+    outcome.standing.reset();
+    outcome.ids.clear();
+  } else if (!knownGeneration && cacheable) {
+    std::lock_guard lock(m_cacheMutex);
+    m_cache.Store(job.query, job.maxResults, outcome.generation, outcome.ids);
+  }
+
+  outcome.elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::steady_clock::now() - start);
+  return outcome;
+}
+
+void SearchService::Cancel(Pending &pending) {
+  SearchOutcome outcome;
+  outcome.cancelled = true;
+  pending.callback(std::move(outcome));
+}
+
+} // namespace PulseFS::Engine
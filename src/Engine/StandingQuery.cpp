@@ -0,0 +1,78 @@
+#include "PulseFS/Engine/StandingQuery.hpp"
+
+namespace PulseFS::Engine {
+
+ResultDelta StandingQuery::TakeDelta() {
+  ResultDelta delta;
+  std::lock_guard lock(m_mutex);
+  delta.added.assign(m_added.begin(), m_added.end());
+  delta.removed.assign(m_removed.begin(), m_removed.end());
+  delta.updated.assign(m_updated.begin(), m_updated.end());
+  delta.pathsChanged = m_pathsChanged;
+  delta.resync = m_resync;
+  m_added.clear();
+  m_removed.clear();
+  m_updated.clear();
+  m_pathsChanged = false;
+  m_resync = false;
+  return delta;
+}
+
+bool StandingQuery::WaitForDelta(std::chrono::milliseconds timeout) {
+  std::unique_lock lock(m_mutex);
+  return m_changed.wait_for(lock, timeout, [this] {
+    return !m_added.empty() || !m_removed.empty() || !m_updated.empty() ||
+           m_pathsChanged || m_resync;
+  });
+}
+
+void StandingQuery::QueueAdd(unsigned long long id) {
+  {
+    std::lock_guard lock(m_mutex);
+    // Removed and back since the last drain: the subscriber still holds the
+    // row, but whatever made it leave may have changed it.
+    if (m_removed.erase(id) == 0)
+      m_added.insert(id);
+    else
+      m_updated.insert(id);
+  }
+  m_changed.notify_all();
+}
+
+void StandingQuery::QueueRemove(unsigned long long id) {
+  {
+    std::lock_guard lock(m_mutex);
+    m_updated.erase(id);
+    if (m_added.erase(id) == 0)
+      m_removed.insert(id);
+  }
+  m_changed.notify_all();
+}
+
+void StandingQuery::QueueUpdate(unsigned long long id) {
+  {
+    std::lock_guard lock(m_mutex);
+    // An id added since the last drain is read in full anyway.
+    if (!m_added.contains(id))
+      m_updated.insert(id);
+  }
+  m_changed.notify_all();
+}
+
+void StandingQuery::QueuePathsChanged() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_pathsChanged = true;
+  }
+  m_changed.notify_all();
+}
+
+void StandingQuery::QueueResync() {
+  {
+    std::lock_guard lock(m_mutex);
+    m_resync = true;
+  }
+  m_changed.notify_all();
+}
+
+} // namespace PulseFS::Engine
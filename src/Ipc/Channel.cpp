@@ -0,0 +1,272 @@
+#include "PulseFS/Ipc/Channel.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <cstring>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace PulseFS::Ipc {
+
+#ifdef _WIN32
+
+namespace {
+
+constexpr DWORD kPipeBufferSize = 64 * 1024;
+
+HANDLE AsHandle(intptr_t value) { return reinterpret_cast<HANDLE>(value); }
+
+intptr_t NewEvent() {
+  return reinterpret_cast<intptr_t>(
+      ::CreateEventW(nullptr, TRUE, FALSE, nullptr));
+}
+
+// Runs one overlapped read or write to completion on the given event.
+bool Transfer(HANDLE pipe, HANDLE event, void *data, DWORD length, bool write,
+              DWORD &transferred) {
+  OVERLAPPED overlapped = {};
+  overlapped.hEvent = event;
+  BOOL ok = write ? ::WriteFile(pipe, data, length, nullptr, &overlapped)
+                  : ::ReadFile(pipe, data, length, nullptr, &overlapped);
+  if (!ok && ::GetLastError() != ERROR_IO_PENDING)
+    return false;
+  return ::GetOverlappedResult(pipe, &overlapped, &transferred, TRUE) &&
+         transferred > 0;
+}
+
+} // namespace
+
+Channel::Channel(intptr_t handle)
+    : m_handle(handle), m_readEvent(NewEvent()), m_writeEvent(NewEvent()) {}
+
+Channel::~Channel() {
+  ::CloseHandle(AsHandle(m_handle));
+  ::CloseHandle(AsHandle(m_readEvent));
+  ::CloseHandle(AsHandle(m_writeEvent));
+}
+
+std::unique_ptr<Channel> Channel::Connect(const std::string &endpoint) {
+  const std::wstring name = Utils::WideFromUtf8(endpoint);
+  for (int attempt = 0; attempt < 2; ++attempt) {
+    HANDLE pipe = ::CreateFileW(name.c_str(), GENERIC_READ | GENERIC_WRITE, 0,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_OVERLAPPED,
+                                nullptr);
+    if (pipe != INVALID_HANDLE_VALUE)
+      return std::unique_ptr<Channel>(
+          new Channel(reinterpret_cast<intptr_t>(pipe)));
+    if (::GetLastError() != ERROR_PIPE_BUSY ||
+        !::WaitNamedPipeW(name.c_str(), 2000))
+      break;
+  }
+  return nullptr;
+}
+
+bool Channel::ReadExact(void *data, size_t length) {
+  auto *bytes = static_cast<char *>(data);
+  while (length > 0) {
+    DWORD transferred = 0;
+    if (m_shutdown ||
+        !Transfer(AsHandle(m_handle), AsHandle(m_readEvent), bytes,
+                  static_cast<DWORD>(length), false, transferred))
+      return false;
+    bytes += transferred;
+    length -= transferred;
+  }
+  return true;
+}
+
+bool Channel::WriteAll(const void *data, size_t length) {
+  auto *bytes = static_cast<char *>(const_cast<void *>(data));
+  while (length > 0) {
+    DWORD transferred = 0;
+    if (m_shutdown ||
+        !Transfer(AsHandle(m_handle), AsHandle(m_writeEvent), bytes,
+                  static_cast<DWORD>(length), true, transferred))
+      return false;
+    bytes += transferred;
+    length -= transferred;
+  }
+  return true;
+}
+
+void Channel::Shutdown() {
+  m_shutdown = true;
+  ::CancelIoEx(AsHandle(m_handle), nullptr);
+}
+
+Listener::~Listener() {
+  Close();
+  if (m_stopEvent)
+    ::CloseHandle(AsHandle(m_stopEvent));
+}
+
+bool Listener::Open(const std::string &endpoint) {
+  m_endpoint = endpoint;
+  m_stopEvent = NewEvent();
+  return m_stopEvent != 0;
+}
+
+std::unique_ptr<Channel> Listener::Accept() {
+  const std::wstring name = Utils::WideFromUtf8(m_endpoint);
+  HANDLE pipe = ::CreateNamedPipeW(
+      name.c_str(), PIPE_ACCESS_DUPLEX | FILE_FLAG_OVERLAPPED,
+      PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT |
+          PIPE_REJECT_REMOTE_CLIENTS,
+      PIPE_UNLIMITED_INSTANCES, kPipeBufferSize, kPipeBufferSize, 0, nullptr);
+  if (pipe == INVALID_HANDLE_VALUE)
+    return nullptr;
+
+  auto channel =
+      std::unique_ptr<Channel>(new Channel(reinterpret_cast<intptr_t>(pipe)));
+  OVERLAPPED overlapped = {};
+  overlapped.hEvent = AsHandle(channel->m_readEvent);
+  if (!::ConnectNamedPipe(pipe, &overlapped)) {
+    DWORD error = ::GetLastError();
+    if (error == ERROR_IO_PENDING) {
+      HANDLE waits[2] = {overlapped.hEvent, AsHandle(m_stopEvent)};
+      if (::WaitForMultipleObjects(2, waits, FALSE, INFINITE) !=
+          WAIT_OBJECT_0) {
+        ::CancelIoEx(pipe, &overlapped);
+        DWORD ignored = 0;
+        ::GetOverlappedResult(pipe, &overlapped, &ignored, TRUE);
+        return nullptr;
+      }
+      DWORD ignored = 0;
+      if (!::GetOverlappedResult(pipe, &overlapped, &ignored, FALSE))
+        return nullptr;
+    } else if (error != ERROR_PIPE_CONNECTED) {
+      return nullptr;
+    }
+  }
+  return m_closed ? nullptr : std::move(channel);
+}
+
+void Listener::Close() {
+  m_closed = true;
+  if (m_stopEvent)
+    ::SetEvent(AsHandle(m_stopEvent));
+}
+
+std::string DefaultEndpoint() { return "\\\\.\\pipe\\PulseFS"; }
+
+#else
+
+Channel::Channel(intptr_t handle) : m_handle(handle) {}
+
+Channel::~Channel() { ::close(static_cast<int>(m_handle)); }
+
+std::unique_ptr<Channel> Channel::Connect(const std::string &endpoint) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (endpoint.size() >= sizeof(address.sun_path))
+    return nullptr;
+  std::memcpy(address.sun_path, endpoint.c_str(), endpoint.size() + 1);
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return nullptr;
+  if (::connect(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) !=
+      0) {
+    ::close(fd);
+    return nullptr;
+  }
+  return std::unique_ptr<Channel>(new Channel(fd));
+}
+
+bool Channel::ReadExact(void *data, size_t length) {
+  auto *bytes = static_cast<char *>(data);
+  while (length > 0) {
+    ssize_t received = ::recv(static_cast<int>(m_handle), bytes, length, 0);
+    if (received <= 0) {
+      if (received < 0 && errno == EINTR && !m_shutdown)
+        continue;
+      return false;
+    }
+    bytes += received;
+    length -= static_cast<size_t>(received);
+  }
+  return true;
+}
+
+bool Channel::WriteAll(const void *data, size_t length) {
+  const auto *bytes = static_cast<const char *>(data);
+  while (length > 0) {
+    ssize_t sent =
+        ::send(static_cast<int>(m_handle), bytes, length, MSG_NOSIGNAL);
+    if (sent < 0) {
+      if (errno == EINTR && !m_shutdown)
+        continue;
+      return false;
+    }
+    bytes += sent;
+    length -= static_cast<size_t>(sent);
+  }
+  return true;
+}
+
+void Channel::Shutdown() {
+  m_shutdown = true;
+  ::shutdown(static_cast<int>(m_handle), SHUT_RDWR);
+}
+
+Listener::~Listener() {
+  Close();
+  if (m_handle >= 0) {
+    ::close(static_cast<int>(m_handle));
+    ::unlink(m_endpoint.c_str());
+  }
+}
+
+bool Listener::Open(const std::string &endpoint) {
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (endpoint.size() >= sizeof(address.sun_path))
+    return false;
+  std::memcpy(address.sun_path, endpoint.c_str(), endpoint.size() + 1);
+
+  int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return false;
+
+  // A stale socket file from a crashed daemon would make bind fail.
+  ::unlink(endpoint.c_str());
+  if (::bind(fd, reinterpret_cast<sockaddr *>(&address), sizeof(address)) !=
+          0 ||
+      ::listen(fd, SOMAXCONN) != 0) {
+    ::close(fd);
+    return false;
+  }
+  m_endpoint = endpoint;
+  m_handle = fd;
+  return true;
+}
+
+std::unique_ptr<Channel> Listener::Accept() {
+  while (!m_closed) {
+    int fd = ::accept4(static_cast<int>(m_handle), nullptr, nullptr,
+                       SOCK_CLOEXEC);
+    if (fd >= 0)
+      return std::unique_ptr<Channel>(new Channel(fd));
+    if (errno != EINTR && errno != ECONNABORTED)
+      break;
+  }
+  return nullptr;
+}
+
+void Listener::Close() {
+  if (!m_closed.exchange(true) && m_handle >= 0)
+    ::shutdown(static_cast<int>(m_handle), SHUT_RDWR);
+}
+
+std::string DefaultEndpoint() {
+  return "/tmp/pulsefs-" + std::to_string(::getuid()) + ".sock";
+}
+
+#endif
+
+} // namespace PulseFS::Ipc
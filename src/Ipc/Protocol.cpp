@@ -0,0 +1,142 @@
+#include "PulseFS/Ipc/Protocol.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+#include <cstring>
+
+namespace PulseFS::Ipc {
+
+namespace {
+
+size_t BeginFrame(std::vector<char> &buffer, MessageType type,
+                  uint32_t requestId) {
+  FrameHeader header{0, static_cast<uint8_t>(type), kProtocolVersion, 0,
+                     requestId};
+  const size_t offset = buffer.size();
+  buffer.resize(offset + sizeof(header));
+  std::memcpy(&buffer[offset], &header, sizeof(header));
+  return offset;
+}
+
+void EndFrame(std::vector<char> &buffer, size_t offset) {
+  const uint32_t length =
+      static_cast<uint32_t>(buffer.size() - offset - sizeof(FrameHeader));
+  std::memcpy(&buffer[offset], &length, sizeof(length));
+}
+
+template <typename T> void Put(std::vector<char> &buffer, const T &value) {
+  const size_t offset = buffer.size();
+  buffer.resize(offset + sizeof(value));
+  std::memcpy(&buffer[offset], &value, sizeof(value));
+}
+
+void PutString(std::vector<char> &buffer, std::wstring_view text) {
+  std::u16string utf16 = Utils::Utf16FromWide(text);
+  Put(buffer, static_cast<uint32_t>(utf16.size()));
+  const size_t offset = buffer.size();
+  buffer.resize(offset + utf16.size() * sizeof(char16_t));
+  std::memcpy(&buffer[offset], utf16.data(), utf16.size() * sizeof(char16_t));
+}
+
+class Reader {
+public:
+  Reader(const char *data, size_t length) : m_data(data), m_left(length) {}
+
+  template <typename T> bool Get(T &value) {
+    if (m_left < sizeof(value))
+      return false;
+    std::memcpy(&value, m_data, sizeof(value));
+    m_data += sizeof(value);
+    m_left -= sizeof(value);
+    return true;
+  }
+
+  bool GetString(std::wstring &text) {
+    uint32_t units = 0;
+    if (!Get(units) || m_left / sizeof(char16_t) < units)
+      return false;
+    m_scratch.resize(units);
+    std::memcpy(m_scratch.data(), m_data, units * sizeof(char16_t));
+    m_data += units * sizeof(char16_t);
+    m_left -= units * sizeof(char16_t);
+    text = Utils::WideFromUtf16(m_scratch.data(), m_scratch.size());
+    return true;
+  }
+
+private:
+  const char *m_data;
+  size_t m_left;
+  std::u16string m_scratch;
+};
+
+} // namespace
+
+void AppendQuery(std::vector<char> &buffer, uint32_t requestId,
+                 std::wstring_view query, uint32_t maxResults) {
+  const size_t frame = BeginFrame(buffer, MessageType::Query, requestId);
+  Put(buffer, maxResults);
+  PutString(buffer, query);
+  EndFrame(buffer, frame);
+}
+
+void AppendCancel(std::vector<char> &buffer, uint32_t requestId) {
+  EndFrame(buffer, BeginFrame(buffer, MessageType::Cancel, requestId));
+}
+
+void AppendStatsRequest(std::vector<char> &buffer, uint32_t requestId) {
+  EndFrame(buffer, BeginFrame(buffer, MessageType::Stats, requestId));
+}
+
+void AppendStatsReply(std::vector<char> &buffer, uint32_t requestId,
+                      std::string_view json) {
+  const size_t frame = BeginFrame(buffer, MessageType::StatsReply, requestId);
+  buffer.insert(buffer.end(), json.begin(), json.end());
+  EndFrame(buffer, frame);
+}
+
+void AppendResults(std::vector<char> &buffer, const QueryResponse &response) {
+  const size_t frame =
+      BeginFrame(buffer, MessageType::Results, response.requestId);
+  const uint8_t header[4] = {static_cast<uint8_t>(response.status), 0, 0, 0};
+  Put(buffer, header);
+  Put(buffer, static_cast<uint32_t>(response.hits.size()));
+  for (const auto &hit : response.hits) {
+    Put(buffer, static_cast<uint64_t>(hit.id));
+    Put(buffer, static_cast<uint32_t>(hit.attributes));
+    PutString(buffer, hit.path);
+  }
+  EndFrame(buffer, frame);
+}
+
+bool DecodeQuery(const char *payload, size_t length, std::wstring &query,
+                 uint32_t &maxResults) {
+  Reader reader(payload, length);
+  return reader.Get(maxResults) && reader.GetString(query);
+}
+
+bool DecodeResults(const FrameHeader &header, const char *payload,
+                   QueryResponse &response) {
+  Reader reader(payload, header.length);
+  uint8_t status[4];
+  uint32_t count = 0;
+  // Each hit needs at least 16 bytes, which bounds a hostile count.
+  if (!reader.Get(status) || !reader.Get(count) || count > header.length / 16)
+    return false;
+
+  response.requestId = header.requestId;
+  response.status = static_cast<QueryStatus>(status[0]);
+  response.hits.clear();
+  response.hits.reserve(count);
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t id = 0;
+    uint32_t attributes = 0;
+    QueryHit hit;
+    if (!reader.Get(id) || !reader.Get(attributes) ||
+        !reader.GetString(hit.path))
+      return false;
+    hit.id = id;
+    hit.attributes = attributes;
+    response.hits.push_back(std::move(hit));
+  }
+  return true;
+}
+
+} // namespace PulseFS::Ipc
@@ -0,0 +1,95 @@
+#include "PulseFS/Ipc/QueryClient.hpp"
+
+namespace PulseFS::Ipc {
+
+bool QueryClient::Connect(const std::string &endpoint) {
+  m_channel = Channel::Connect(endpoint);
+  return m_channel != nullptr;
+}
+
+uint32_t QueryClient::Send(std::wstring_view query, uint32_t maxResults) {
+  if (!m_channel)
+    return 0;
+
+  std::lock_guard lock(m_writeMutex);
+  const uint32_t requestId = m_nextRequestId++;
+  if (m_nextRequestId == 0)
+    m_nextRequestId = 1;
+
+  m_sendBuffer.clear();
+  AppendQuery(m_sendBuffer, requestId, query, maxResults);
+  return m_channel->WriteAll(m_sendBuffer.data(), m_sendBuffer.size())
+             ? requestId
+             : 0;
+}
+
+bool QueryClient::Cancel(uint32_t requestId) {
+  if (!m_channel)
+    return false;
+
+  std::lock_guard lock(m_writeMutex);
+  m_sendBuffer.clear();
+  AppendCancel(m_sendBuffer, requestId);
+  return m_channel->WriteAll(m_sendBuffer.data(), m_sendBuffer.size());
+}
+
+bool QueryClient::ReadFrame(FrameHeader &header) {
+  if (!m_channel)
+    return false;
+
+  if (!m_channel->ReadExact(&header, sizeof(header)) ||
+      header.version != kProtocolVersion || header.length > kMaxPayloadSize)
+    return false;
+
+  m_receiveBuffer.resize(header.length);
+  return header.length == 0 ||
+         m_channel->ReadExact(m_receiveBuffer.data(), m_receiveBuffer.size());
+}
+
+bool QueryClient::Receive(QueryResponse &response) {
+  FrameHeader header;
+  return ReadFrame(header) &&
+         header.type == static_cast<uint8_t>(MessageType::Results) &&
+         DecodeResults(header, m_receiveBuffer.data(), response);
+}
+
+std::optional<QueryResponse> QueryClient::Query(std::wstring_view query,
+                                                uint32_t maxResults) {
+  const uint32_t requestId = Send(query, maxResults);
+  if (requestId == 0)
+    return std::nullopt;
+
+  QueryResponse response;
+  while (Receive(response)) {
+    if (response.requestId == requestId)
+      return response;
+  }
+  return std::nullopt;
+}
+
+std::optional<std::string> QueryClient::Stats() {
+  if (!m_channel)
+    return std::nullopt;
+
+  uint32_t requestId = 0;
+  {
+    std::lock_guard lock(m_writeMutex);
+    requestId = m_nextRequestId++;
+    if (m_nextRequestId == 0)
+      m_nextRequestId = 1;
+    m_sendBuffer.clear();
+    AppendStatsRequest(m_sendBuffer, requestId);
+    if (!m_channel->WriteAll(m_sendBuffer.data(), m_sendBuffer.size()))
+      return std::nullopt;
+  }
+
+  FrameHeader header;
+  while (ReadFrame(header)) {
+    if (header.type == static_cast<uint8_t>(MessageType::StatsReply) &&
+        header.requestId == requestId)
+      return std::string(m_receiveBuffer.begin(), m_receiveBuffer.end());
+  }
+  return std::nullopt;
+}
+
+} // namespace PulseFS::Ipc
@@ -0,0 +1,318 @@
+#include "PulseFS/Ipc/QueryServer.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+#include <algorithm>
+#include <chrono>
+
+namespace PulseFS::Ipc {
+
+QueryServer::QueryServer(Engine::SearchIndex &index,
+                         const QueryServerOptions &options)
+    : m_index(index), m_options(options) {}
+
+QueryServer::~QueryServer() { Stop(); }
+
+bool QueryServer::Start(const std::string &endpoint) {
+  if (m_running || !m_listener.Open(endpoint))
+    return false;
+  m_running = true;
+  m_dispatchThread = std::thread(&QueryServer::DispatchLoop, this);
+  m_acceptThread = std::thread(&QueryServer::AcceptLoop, this);
+  return true;
+}
+
+void QueryServer::Stop() {
+  if (!m_running.exchange(false))
+    return;
+
+  m_listener.Close();
+  if (m_acceptThread.joinable())
+    m_acceptThread.join();
+
+  // Shut the channels first so no reader or writer is left blocked on a
+  // client that stopped responding.
+  {
+    std::lock_guard lock(m_clientsMutex);
+    for (auto &client : m_clients) {
+      Close(*client);
+      client->channel->Shutdown();
+    }
+  }
+
+  m_queueChanged.notify_all();
+  if (m_dispatchThread.joinable())
+    m_dispatchThread.join();
+
+  ReapClients(true);
+
+  std::lock_guard lock(m_queueMutex);
+  m_queue.clear();
+}
+
+void QueryServer::AcceptLoop() {
+  while (m_running) {
+    auto channel = m_listener.Accept();
+    if (!channel) {
+      if (m_running)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      continue;
+    }
+
+    auto client = std::make_shared<Client>();
+    client->channel = std::move(channel);
+    client->reader = std::thread(&QueryServer::ClientLoop, this, client);
+    client->writer = std::thread(&QueryServer::WriterLoop, this, client);
+
+    ReapClients(false);
+    std::lock_guard lock(m_clientsMutex);
+    m_clients.push_back(std::move(client));
+  }
+}
+
+void QueryServer::ReapClients(bool all) {
+  std::list<std::shared_ptr<Client>> done;
+  {
+    std::lock_guard lock(m_clientsMutex);
+    for (auto it = m_clients.begin(); it != m_clients.end();) {
+      auto next = std::next(it);
+      if (all || ((*it)->readerFinished && (*it)->writerFinished))
+        done.splice(done.end(), m_clients, it);
+      it = next;
+    }
+  }
+  for (auto &client : done) {
+    if (client->reader.joinable())
+      client->reader.join();
+    if (client->writer.joinable())
+      client->writer.join();
+  }
+}
+
+void QueryServer::ClientLoop(std::shared_ptr<Client> client) {
+  FrameHeader header;
+  std::vector<char> payload;
+
+  while (m_running && client->channel->ReadExact(&header, sizeof(header))) {
+    if (header.version != kProtocolVersion || header.length > kMaxPayloadSize)
+      break;
+    payload.resize(header.length);
+    if (header.length > 0 &&
+        !client->channel->ReadExact(payload.data(), payload.size()))
+      break;
+
+    const auto type = static_cast<MessageType>(header.type);
+    if (type == MessageType::Stats) {
+      std::vector<char> buffer;
+      AppendStatsReply(buffer, header.requestId, StatsJson());
+      Send(*client, std::move(buffer));
+      continue;
+    }
+    if (type == MessageType::Cancel) {
+      std::lock_guard lock(client->pendingMutex);
+      if (auto it = client->pending.find(header.requestId);
+          it != client->pending.end())
+        it->second->cancelled = true;
+      continue;
+    }
+    if (type != MessageType::Query)
+      break;
+
+    auto query = std::make_shared<PendingQuery>();
+    query->client = client;
+    query->requestId = header.requestId;
+    if (!DecodeQuery(payload.data(), payload.size(), query->query,
+                     query->maxResults)) {
+      Respond(*query, QueryStatus::BadRequest, {});
+      continue;
+    }
+    query->maxResults = std::min(query->maxResults, m_options.maxResultsCap);
+
+    {
+      std::lock_guard lock(client->pendingMutex);
+      client->pending[header.requestId] = query;
+    }
+    {
+      std::lock_guard lock(m_queueMutex);
+      m_queue.push_back(std::move(query));
+    }
+    m_queueChanged.notify_one();
+  }
+
+  // Whatever this client still has queued is no longer wanted.
+  {
+    std::lock_guard lock(client->pendingMutex);
+    for (auto &[id, query] : client->pending)
+      query->cancelled = true;
+    client->pending.clear();
+  }
+  Close(*client);
+  client->readerFinished = true;
+}
+
+void QueryServer::WriterLoop(std::shared_ptr<Client> client) {
+  Utils::Trace::SetThreadName("QueryServer writer");
+  std::unique_lock lock(client->outboxMutex);
+  while (true) {
+    client->outboxChanged.wait(
+        lock, [&] { return !client->outbox.empty() || client->closing; });
+    if (client->outbox.empty())
+      break;
+    std::vector<char> frame = std::move(client->outbox.front());
+    client->outbox.pop_front();
+    client->outboxBytes -= frame.size();
+    lock.unlock();
+    const bool written = client->channel->WriteAll(frame.data(), frame.size());
+    lock.lock();
+    if (!written) {
+      client->closing = true;
+      client->outbox.clear();
+      client->outboxBytes = 0;
+      lock.unlock();
+      // Wakes the reader too, so the connection is reaped.
+      client->channel->Shutdown();
+      break;
+    }
+  }
+  client->writerFinished = true;
+}
+
+void QueryServer::Send(Client &client, std::vector<char> frame) {
+  {
+    std::lock_guard lock(client.outboxMutex);
+    if (client.closing)
+      return;
+    if (client.outboxBytes + frame.size() <= m_options.maxOutboxBytes) {
+      client.outboxBytes += frame.size();
+      client.outbox.push_back(std::move(frame));
+      client.outboxChanged.notify_one();
+      return;
+    }
+    client.closing = true;
+    client.outbox.clear();
+    client.outboxBytes = 0;
+    client.outboxChanged.notify_one();
+  }
+  m_clientsDropped++;
+  client.channel->Shutdown();
+}
+
+void QueryServer::Close(Client &client) {
+  std::lock_guard lock(client.outboxMutex);
+  client.closing = true;
+  client.outboxChanged.notify_one();
+}
+
+void QueryServer::DispatchLoop() {
+  Utils::Trace::SetThreadName("QueryServer dispatch");
+  std::vector<std::shared_ptr<PendingQuery>> batch;
+  std::vector<std::shared_ptr<PendingQuery>> scanned;
+  std::vector<Engine::SearchRequest> requests;
+
+  while (true) {
+    batch.clear();
+    {
+      std::unique_lock lock(m_queueMutex);
+      m_queueChanged.wait(lock,
+                          [this] { return !m_queue.empty() || !m_running; });
+      if (!m_running)
+        break;
+      // No waiting for a batch to fill: whatever queued up while the last
+      // scan ran shares the next one.
+      while (!m_queue.empty() && batch.size() < m_options.maxBatch) {
+        batch.push_back(std::move(m_queue.front()));
+        m_queue.pop_front();
+      }
+    }
+
+    scanned.clear();
+    requests.clear();
+    const uint64_t generation = m_index.Generation();
+    for (auto &query : batch) {
+      if (query->cancelled) {
+        Respond(*query, QueryStatus::Cancelled, {});
+        continue;
+      }
+      if (auto cached =
+              m_cache.Find(query->query, query->maxResults, generation)) {
+        m_cacheHits++;
+        Respond(*query, QueryStatus::Ok, *cached);
+        continue;
+      }
+      requests.push_back(
+          {query->query, query->maxResults, &query->cancelled, {}});
+      scanned.push_back(query);
+    }
+    if (requests.empty())
+      continue;
+
+    auto results = m_index.SearchMany(requests);
+    m_scansRun++;
+    for (size_t i = 0; i < scanned.size(); ++i) {
+      if (scanned[i]->cancelled) {
+        Respond(*scanned[i], QueryStatus::Cancelled, {});
+        continue;
+      }
+      Respond(*scanned[i], QueryStatus::Ok, results[i]);
+      m_cache.Store(scanned[i]->query, scanned[i]->maxResults, generation,
+                    std::move(results[i]));
+    }
+  }
+}
+
+std::string QueryServer::StatsJson() const {
+  const Engine::IndexStats stats = m_index.GetStats();
+  std::string json = "{";
+  Utils::AppendJsonInteger(json, "queries_served", m_queriesServed);
+  Utils::AppendJsonInteger(json, "shared_scans", m_scansRun);
+  Utils::AppendJsonInteger(json, "cache_hits", m_cacheHits);
+  Utils::AppendJsonInteger(json, "clients_dropped", m_clientsDropped);
+  Utils::AppendJsonInteger(json, "entries", stats.liveEntries);
+  Utils::AppendJsonInteger(json, "distinct_names", stats.distinctNames);
+  Utils::AppendJsonInteger(json, "entries_scanned", stats.entriesScanned);
+  json += ",\"query_latency_ns\":{";
+  for (size_t i = 0; i < Engine::kQueryLengthClasses; ++i) {
+    Utils::AppendJson(json, Engine::QueryLengthClassName(i),
+                      stats.queryLatencyNs[i]);
+  }
+  json += '}';
+  Utils::AppendJson(json, "exclusive_wait_ns", stats.exclusiveWaitNs);
+  Utils::AppendJson(json, "shared_wait_ns", stats.sharedWaitNs);
+  json += ",\"memory_bytes\":{";
+  Utils::AppendJsonInteger(json, "entries", stats.entryBytes);
+  Utils::AppendJsonInteger(json, "names", stats.nameBytes);
+  Utils::AppendJsonInteger(json, "id_map", stats.idMapBytes);
+  Utils::AppendJsonInteger(json, "attributes", stats.attributeBytes);
+  Utils::AppendJsonInteger(json, "children", stats.childBytes);
+  Utils::AppendJsonInteger(json, "folder_totals", stats.totalsBytes);
+  json += "}}";
+  return json;
+}
+
+void QueryServer::Respond(PendingQuery &query, QueryStatus status,
+                          const std::vector<unsigned long long> &ids) {
+  QueryResponse response;
+  response.requestId = query.requestId;
+  response.status = status;
+  if (status == QueryStatus::Ok) {
+    auto resolved = m_index.Resolve(ids);
+    response.hits.reserve(ids.size());
+    for (size_t i = 0; i < ids.size(); ++i) {
+      response.hits.push_back(
+          {ids[i], resolved[i].attributes, std::move(resolved[i].path)});
+    }
+  }
+
+  std::vector<char> buffer;
+  AppendResults(buffer, response);
+
+  Client &client = *query.client;
+  {
+    std::lock_guard lock(client.pendingMutex);
+    if (auto it = client.pending.find(query.requestId);
+        it != client.pending.end() && it->second.get() == &query)
+      client.pending.erase(it);
+  }
+  Send(client, std::move(buffer));
+  m_queriesServed++;
+}
+
+} // namespace PulseFS::Ipc
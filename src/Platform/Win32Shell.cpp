@@ -0,0 +1,14 @@
+#include "PulseFS/Platform/Win32Shell.hpp"
+#include <Windows.h>
+#include <shellapi.h>
+
+namespace PulseFS::Platform {
+
+void Win32Shell::Reveal(const std::wstring &path) {
+  if (path.empty())
+    return;
+  std::wstring cmd = L"/select,\"" + path + L"\"";
+  ShellExecuteW(NULL, L"open", L"explorer.exe", cmd.c_str(), NULL, SW_SHOW);
+}
+
+} // namespace PulseFS::Platform
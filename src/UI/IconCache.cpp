@@ -1,6 +1,9 @@
 #include "PulseFS/UI/IconCache.hpp"
+#include "PulseFS/Utils/ImageScale.hpp"
 #include <algorithm>
+#include <optional>
 #include <shellapi.h>
+#include <vector>
 #include <wincodec.h>
 #include <wrl/client.h>
 
@@ -8,20 +11,71 @@
 
 namespace PulseFS::UI {
 
-IconCache::IconCache(ID3D11Device* device) : m_device(device) {
+IconCache::IconCache(ID3D11Device* device)
+    : m_device(device), m_atlas(kAtlasPageSize, kAtlasMaxPages) {
   if (m_device) {
     m_device->GetImmediateContext(&m_deviceContext);
   }
+
+  // Placeholders are resolved here, once, rather than inside a frame.
+  if (HICON hIcon = GetShellIcon(L"C:\\", true)) {
+    m_folderIcon = RenderIconPixels(hIcon);
+    DestroyIcon(hIcon);
+  }
+  if (HICON hIcon = GetShellIcon(L"C:\\file.txt", false)) {
+    m_defaultFileIcon = RenderIconPixels(hIcon);
+    DestroyIcon(hIcon);
+  }
+
+  Utils::AsyncLruCacheOptions options;
+  options.budgetBytes = kIconBudgetBytes;
+  options.workerInit = [] { CoInitializeEx(nullptr, COINIT_APARTMENTTHREADED); };
+  options.workerExit = [] { CoUninitialize(); };
+  m_icons = std::make_unique<IconLru>(
+      [this](const std::wstring& iconKey, const std::atomic<bool>&) {
+        return LoadIconImage(iconKey);
+      },
+      std::move(options));
+
+  Utils::AsyncLruCacheOptions thumbnailOptions;
+  thumbnailOptions.budgetBytes = kThumbnailBudgetBytes;
+  thumbnailOptions.workers = 2;
+  thumbnailOptions.maxQueued = 8;
+  thumbnailOptions.workerInit = [] { CoInitializeEx(nullptr, COINIT_MULTITHREADED); };
+  thumbnailOptions.workerExit = [] { CoUninitialize(); };
+  m_thumbnails = std::make_unique<ThumbnailLru>(
+      [this](const std::wstring& path, const std::atomic<bool>& cancelled) {
+        return LoadThumbnail(path, cancelled);
+      },
+      std::move(thumbnailOptions));
 }
 
 IconCache::~IconCache() {
+  m_thumbnails.reset();
+  m_icons.reset();
   Clear();
 }
 
+void IconCache::BeginFrame() {
+  m_atlas.NextFrame();
+  m_icons->Pump();
+  m_thumbnails->Pump();
+
+  // The hover that asked for a thumbnail ended without it arriving.
+  if (!m_thumbnailRequested && !m_hoveredThumbnail.empty()) {
+    m_thumbnails->Cancel(m_hoveredThumbnail);
+    m_hoveredThumbnail.clear();
+  }
+  m_thumbnailRequested = false;
+}
+
 void IconCache::Clear() {
-  m_iconCache.clear();
-  m_folderIcon.Reset();
-  m_defaultFileIcon.Reset();
+  if (m_icons) {
+    m_icons->Clear();
+  }
+  if (m_thumbnails) {
+    m_thumbnails->Clear();
+  }
 }
 
 HICON IconCache::GetShellIcon(const std::wstring& path, bool isDirectory) {
@@ -37,14 +91,14 @@ HICON IconCache::GetShellIcon(const std::wstring& path, bool isDirectory) {
   return sfi.hIcon;
 }
 
-Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> IconCache::CreateIconTexture(HICON hIcon) {
-  if (!hIcon || !m_device) {
-    return nullptr;
+std::optional<IconCache::IconImage> IconCache::RenderIconPixels(HICON hIcon) {
+  if (!hIcon) {
+    return std::nullopt;
   }
 
   ICONINFO iconInfo;
   if (!GetIconInfo(hIcon, &iconInfo)) {
-    return nullptr;
+    return std::nullopt;
   }
 
   BITMAP bmp;
@@ -72,13 +126,30 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> IconCache::CreateIconTexture(HI
     ReleaseDC(NULL, hdcScreen);
     DeleteObject(iconInfo.hbmColor);
     DeleteObject(iconInfo.hbmMask);
-    return nullptr;
+    return std::nullopt;
   }
 
   HBITMAP hOldBitmap = (HBITMAP)SelectObject(hdcMem, hBitmap);
   DrawIconEx(hdcMem, 0, 0, hIcon, width, height, 0, NULL, DI_NORMAL);
   SelectObject(hdcMem, hOldBitmap);
 
+  IconImage image;
+  image.width = static_cast<UINT>(width);
+  image.height = static_cast<UINT>(height);
+  const auto* first = static_cast<const uint8_t*>(bits);
+  image.pixels.assign(first, first + static_cast<size_t>(width) * height * 4);
+
+  DeleteObject(hBitmap);
+  DeleteDC(hdcMem);
+  ReleaseDC(NULL, hdcScreen);
+  DeleteObject(iconInfo.hbmColor);
+  DeleteObject(iconInfo.hbmMask);
+
+  return image;
+}
+
+Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> IconCache::CreateBgraTexture(
+    const void* pixels, UINT width, UINT height, UINT stride) {
   D3D11_TEXTURE2D_DESC texDesc = {};
   texDesc.Width = width;
   texDesc.Height = height;
@@ -90,18 +161,11 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> IconCache::CreateIconTexture(HI
   texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
 
   D3D11_SUBRESOURCE_DATA initData = {};
-  initData.pSysMem = bits;
-  initData.SysMemPitch = width * 4;
+  initData.pSysMem = pixels;
+  initData.SysMemPitch = stride;
 
   Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
   HRESULT hr = m_device->CreateTexture2D(&texDesc, &initData, &texture);
-
-  DeleteObject(hBitmap);
-  DeleteDC(hdcMem);
-  ReleaseDC(NULL, hdcScreen);
-  DeleteObject(iconInfo.hbmColor);
-  DeleteObject(iconInfo.hbmMask);
-
   if (FAILED(hr)) {
     return nullptr;
   }
@@ -113,7 +177,6 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> IconCache::CreateIconTexture(HI
 
   Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
   hr = m_device->CreateShaderResourceView(texture.Get(), &srvDesc, &srv);
-
   if (FAILED(hr)) {
     return nullptr;
   }
@@ -121,111 +184,106 @@ Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> IconCache::CreateIconTexture(HI
   return srv;
 }
 
-ID3D11ShaderResourceView* IconCache::GetIcon(const std::wstring& path, bool isDirectory) {
-  if (!m_device) {
-    return nullptr;
+std::optional<IconCache::IconLru::Loaded> IconCache::LoadIconImage(const std::wstring& iconKey) {
+  HICON hIcon = nullptr;
+  if (!iconKey.empty() && iconKey.front() == L'.') {
+    // An extension: ask for the icon registered for it without touching disk.
+    SHFILEINFOW sfi = {0};
+    SHGetFileInfoW(iconKey.c_str(), FILE_ATTRIBUTE_NORMAL, &sfi, sizeof(sfi),
+                   SHGFI_ICON | SHGFI_SMALLICON | SHGFI_USEFILEATTRIBUTES);
+    hIcon = sfi.hIcon;
+  } else {
+    hIcon = GetShellIcon(iconKey, false);
   }
-
-  if (isDirectory) {
-    auto it = m_iconCache.find(path);
-    if (it != m_iconCache.end()) {
-      return it->second.Get();
-    }
-    
-    HICON hIcon = GetShellIcon(path, true);
-    if (!hIcon) {
-      if (!m_folderIcon) {
-        hIcon = GetShellIcon(L"C:\\", true);
-        m_folderIcon = CreateIconTexture(hIcon);
-        if (hIcon) DestroyIcon(hIcon);
-      }
-      return m_folderIcon.Get();
-    }
-    
-    auto texture = CreateIconTexture(hIcon);
-    DestroyIcon(hIcon);
-    if (texture) {
-      m_iconCache[path] = texture;
-      return texture.Get();
-    }
-    return m_folderIcon.Get();
+  if (!hIcon) {
+    return std::nullopt;
   }
 
-  size_t dotPos = path.find_last_of(L'.');
-  std::wstring ext;
-  
-  if (dotPos != std::wstring::npos && dotPos < path.length() - 1) {
-    ext = path.substr(dotPos);
-    std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
-  } else {
-    ext = L".unknown";
+  auto image = RenderIconPixels(hIcon);
+  DestroyIcon(hIcon);
+  if (!image) {
+    return std::nullopt;
   }
 
-  bool hasCustomIcon = (ext == L".exe" || ext == L".lnk" || ext == L".ico" || 
-                        ext == L".dll" || ext == L".scr" || ext == L".cpl");
-
-  if (hasCustomIcon) {
-    auto it = m_iconCache.find(path);
-    if (it != m_iconCache.end()) {
-      return it->second.Get();
-    }
-    
-    HICON hIcon = GetShellIcon(path, false);
-    if (hIcon) {
-      auto texture = CreateIconTexture(hIcon);
-      DestroyIcon(hIcon);
-      if (texture) {
-        m_iconCache[path] = texture;
-        return texture.Get();
-      }
-    }
-    if (!m_defaultFileIcon) {
-      hIcon = GetShellIcon(L"C:\\file.txt", false);
-      m_defaultFileIcon = CreateIconTexture(hIcon);
-      if (hIcon) DestroyIcon(hIcon);
-    }
-    return m_defaultFileIcon.Get();
-  }
+  const size_t bytes = image->pixels.size() + sizeof(IconImage);
+  return IconLru::Loaded{std::move(*image), bytes};
+}
 
-  auto it = m_iconCache.find(ext);
-  if (it != m_iconCache.end()) {
-    return it->second.Get();
+IconView IconCache::GetIcon(const std::wstring& iconKey, bool isDirectory) {
+  if (!m_device) {
+    return {};
   }
 
-  HICON hIcon = GetShellIcon(path, false);
-  
-  if (!hIcon) {
-    if (!m_defaultFileIcon) {
-      hIcon = GetShellIcon(L"C:\\file.txt", false);
-      m_defaultFileIcon = CreateIconTexture(hIcon);
-      if (hIcon) DestroyIcon(hIcon);
+  if (const IconImage* image = m_icons->Get(iconKey)) {
+    if (IconView view = PlaceInAtlas(*image, false); view.texture) {
+      return view;
     }
-    return m_defaultFileIcon.Get();
   }
+  // Still loading, or the atlas has no cell free this frame.
+  const auto& placeholder = isDirectory ? m_folderIcon : m_defaultFileIcon;
+  return placeholder ? PlaceInAtlas(*placeholder, true) : IconView{};
+}
 
-  auto texture = CreateIconTexture(hIcon);
-  DestroyIcon(hIcon);
-
-  if (texture) {
-    m_iconCache[ext] = texture;
-    return texture.Get();
+IconView IconCache::PlaceInAtlas(const IconImage& image, bool pinned) {
+  if (!m_atlas.Valid(image.slot)) {
+    auto slot = m_atlas.Allocate(image.width, image.height, pinned);
+    if (!slot || !UploadToAtlas(*slot, image.pixels)) {
+      return {};
+    }
+    image.slot = *slot;
   }
-
-  return nullptr;
+  m_atlas.Touch(image.slot);
+
+  const Utils::AtlasSlot& slot = image.slot;
+  const float scale = 1.0f / static_cast<float>(m_atlas.PageSize());
+  return {(ImTextureID)m_atlasViews[slot.page].Get(),
+          static_cast<float>(slot.x) * scale,
+          static_cast<float>(slot.y) * scale,
+          static_cast<float>(slot.x + slot.width) * scale,
+          static_cast<float>(slot.y + slot.height) * scale,
+          slot.width,
+          slot.height};
 }
 
-ID3D11ShaderResourceView* IconCache::GetImageThumbnail(const std::wstring& path) {
-  if (!m_device) {
-    return nullptr;
-  }
+bool IconCache::UploadToAtlas(const Utils::AtlasSlot& slot,
+                              const std::vector<uint8_t>& pixels) {
+  while (m_atlasPages.size() <= slot.page) {
+    D3D11_TEXTURE2D_DESC texDesc = {};
+    texDesc.Width = m_atlas.PageSize();
+    texDesc.Height = m_atlas.PageSize();
+    texDesc.MipLevels = 1;
+    texDesc.ArraySize = 1;
+    texDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
+    texDesc.SampleDesc.Count = 1;
+    texDesc.Usage = D3D11_USAGE_DEFAULT;
+    texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
+
+    Microsoft::WRL::ComPtr<ID3D11Texture2D> page;
+    if (FAILED(m_device->CreateTexture2D(&texDesc, nullptr, &page))) {
+      return false;
+    }
+
+    D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
+    srvDesc.Format = texDesc.Format;
+    srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
+    srvDesc.Texture2D.MipLevels = 1;
 
-  auto it = m_thumbnailCache.find(path);
-  if (it != m_thumbnailCache.end()) {
-    return it->second.Get();
+    Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> view;
+    if (FAILED(m_device->CreateShaderResourceView(page.Get(), &srvDesc, &view))) {
+      return false;
+    }
+    m_atlasPages.push_back(std::move(page));
+    m_atlasViews.push_back(std::move(view));
   }
 
-  CoInitialize(nullptr);
+  D3D11_BOX box = {slot.x, slot.y, 0, slot.x + slot.width, slot.y + slot.height, 1};
+  m_deviceContext->UpdateSubresource(m_atlasPages[slot.page].Get(), 0, &box,
+                                     pixels.data(), slot.width * 4, 0);
+  return true;
+}
 
+std::optional<IconCache::ThumbnailLru::Loaded> IconCache::LoadThumbnail(
+    const std::wstring& path, const std::atomic<bool>& cancelled) {
   Microsoft::WRL::ComPtr<IWICImagingFactory> wicFactory;
   HRESULT hr = CoCreateInstance(
     CLSID_WICImagingFactory,
@@ -233,9 +291,8 @@ ID3D11ShaderResourceView* IconCache::GetImageThumbnail(const std::wstring& path)
     CLSCTX_INPROC_SERVER,
     IID_PPV_ARGS(&wicFactory)
   );
-
   if (FAILED(hr)) {
-    return nullptr;
+    return std::nullopt;
   }
 
   Microsoft::WRL::ComPtr<IWICBitmapDecoder> decoder;
@@ -246,107 +303,98 @@ ID3D11ShaderResourceView* IconCache::GetImageThumbnail(const std::wstring& path)
     WICDecodeMetadataCacheOnDemand,
     &decoder
   );
-
   if (FAILED(hr)) {
-    return nullptr;
+    return std::nullopt;
   }
 
   Microsoft::WRL::ComPtr<IWICBitmapFrameDecode> frame;
   hr = decoder->GetFrame(0, &frame);
   if (FAILED(hr)) {
-    return nullptr;
+    return std::nullopt;
   }
 
   UINT width = 0, height = 0;
   frame->GetSize(&width, &height);
-
-  const UINT maxSize = 256;
-  UINT thumbWidth = width;
-  UINT thumbHeight = height;
-  
-  if (width > maxSize || height > maxSize) {
-    float aspect = static_cast<float>(width) / static_cast<float>(height);
-    if (width > height) {
-      thumbWidth = maxSize;
-      thumbHeight = static_cast<UINT>(maxSize / aspect);
-    } else {
-      thumbHeight = maxSize;
-      thumbWidth = static_cast<UINT>(maxSize * aspect);
-    }
-  }
-
-  Microsoft::WRL::ComPtr<IWICBitmapScaler> scaler;
-  hr = wicFactory->CreateBitmapScaler(&scaler);
-  if (FAILED(hr)) {
-    return nullptr;
-  }
-
-  hr = scaler->Initialize(frame.Get(), thumbWidth, thumbHeight, WICBitmapInterpolationModeFant);
-  if (FAILED(hr)) {
-    return nullptr;
+  if (width == 0 || height == 0) {
+    return std::nullopt;
   }
 
   Microsoft::WRL::ComPtr<IWICFormatConverter> converter;
   hr = wicFactory->CreateFormatConverter(&converter);
   if (FAILED(hr)) {
-    return nullptr;
+    return std::nullopt;
   }
 
   hr = converter->Initialize(
-    scaler.Get(),
+    frame.Get(),
     GUID_WICPixelFormat32bppBGRA,
     WICBitmapDitherTypeNone,
     nullptr,
     0.0f,
     WICBitmapPaletteTypeCustom
   );
-
   if (FAILED(hr)) {
-    return nullptr;
+    return std::nullopt;
   }
 
-  UINT stride = thumbWidth * 4;
-  UINT bufferSize = stride * thumbHeight;
-  std::vector<BYTE> buffer(bufferSize);
-
-  hr = converter->CopyPixels(nullptr, stride, bufferSize, buffer.data());
-  if (FAILED(hr)) {
-    return nullptr;
+  // Decode a band of rows at a time and stream it through the scaler, so a
+  // 40 MP photo never needs a full-size buffer and cancellation is noticed
+  // between bands.
+  const auto [thumbWidth, thumbHeight] =
+      Utils::FitWithin(width, height, kThumbnailSize);
+  Utils::BgraDownscaler scaler(width, height, thumbWidth, thumbHeight);
+  const UINT stride = width * 4;
+  const UINT bandRows = (std::max<UINT>)(1, kThumbnailBandBytes / stride);
+  std::vector<BYTE> band(static_cast<size_t>(stride) * bandRows);
+
+  for (UINT y = 0; y < height; y += bandRows) {
+    if (cancelled) {
+      return std::nullopt;
+    }
+    const UINT rows = (std::min)(bandRows, height - y);
+    WICRect rect = {0, static_cast<INT>(y), static_cast<INT>(width),
+                    static_cast<INT>(rows)};
+    hr = converter->CopyPixels(&rect, stride, stride * rows, band.data());
+    if (FAILED(hr)) {
+      return std::nullopt;
+    }
+    for (UINT row = 0; row < rows; ++row) {
+      scaler.PushRow(band.data() + static_cast<size_t>(row) * stride);
+    }
   }
 
-  D3D11_TEXTURE2D_DESC texDesc = {};
-  texDesc.Width = thumbWidth;
-  texDesc.Height = thumbHeight;
-  texDesc.MipLevels = 1;
-  texDesc.ArraySize = 1;
-  texDesc.Format = DXGI_FORMAT_B8G8R8A8_UNORM;
-  texDesc.SampleDesc.Count = 1;
-  texDesc.Usage = D3D11_USAGE_DEFAULT;
-  texDesc.BindFlags = D3D11_BIND_SHADER_RESOURCE;
-
-  D3D11_SUBRESOURCE_DATA initData = {};
-  initData.pSysMem = buffer.data();
-  initData.SysMemPitch = stride;
-
-  Microsoft::WRL::ComPtr<ID3D11Texture2D> texture;
-  hr = m_device->CreateTexture2D(&texDesc, &initData, &texture);
-  if (FAILED(hr)) {
-    return nullptr;
+  auto srv = CreateBgraTexture(scaler.Pixels().data(), scaler.Width(),
+                               scaler.Height(), scaler.Width() * 4);
+  if (!srv) {
+    return std::nullopt;
   }
+  const size_t bytes = scaler.Pixels().size() + 256;
+  return ThumbnailLru::Loaded{{std::move(srv), scaler.Width(), scaler.Height()},
+                              bytes};
+}
 
-  D3D11_SHADER_RESOURCE_VIEW_DESC srvDesc = {};
-  srvDesc.Format = texDesc.Format;
-  srvDesc.ViewDimension = D3D11_SRV_DIMENSION_TEXTURE2D;
-  srvDesc.Texture2D.MipLevels = 1;
+IconView IconCache::GetThumbnail(const std::wstring& path) {
+  if (!m_device) {
+    return {};
+  }
 
-  Microsoft::WRL::ComPtr<ID3D11ShaderResourceView> srv;
-  hr = m_device->CreateShaderResourceView(texture.Get(), &srvDesc, &srv);
-  if (FAILED(hr)) {
-    return nullptr;
+  if (path != m_hoveredThumbnail) {
+    if (!m_hoveredThumbnail.empty()) {
+      m_thumbnails->Cancel(m_hoveredThumbnail);
+    }
+    m_hoveredThumbnail = path;
   }
+  m_thumbnailRequested = true;
 
-  m_thumbnailCache[path] = srv;
-  return srv.Get();
+  const Thumbnail* thumbnail = m_thumbnails->Get(path);
+  if (!thumbnail) {
+    return {};
+  }
+  IconView view;
+  view.texture = (ImTextureID)thumbnail->texture.Get();
+  view.width = thumbnail->width;
+  view.height = thumbnail->height;
+  return view;
 }
 
 } // namespace PulseFS::UI
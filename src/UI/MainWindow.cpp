@@ -3,34 +3,53 @@
 #include "PulseFS/Core/UsnMonitor.hpp"
 #include "PulseFS/Engine/SearchIndex.hpp"
 #include "PulseFS/ImGui/ImGuiManager.hpp"
+#include "PulseFS/Platform/Win32Shell.hpp"
 #include "PulseFS/Platform/Win32Window.hpp"
 #include "PulseFS/Renderer/D3D11Renderer.hpp"
 #include "PulseFS/UI/IconCache.hpp"
 #include "PulseFS/UI/SearchPanel.hpp"
+#include "PulseFS/Utils/Trace.hpp"
 
 #include "imgui.h"
 #include "imgui_impl_dx11.h"
 
 #include <atomic>
+#include <cstdlib>
+#include <memory>
 #include <thread>
 
 namespace PulseFS::UI {
 
 namespace {
 Engine::SearchIndex g_searchIndex;
+Core::UsnMonitor g_monitor(g_searchIndex);
+Core::ScanProgress g_scanProgress;
 std::atomic<bool> g_isScanning = true;
 } // namespace
 
 static void MftWorker(SearchPanel &panel) {
+  Utils::Trace::SetThreadName("MFT scan");
   const std::wstring volume = L"\\\\.\\C:";
-  long long nextUsn = Core::MftScanner::Enumerate(g_searchIndex, volume);
+  long long nextUsn =
+      Core::MftScanner::Enumerate(g_searchIndex, volume, &g_scanProgress);
 
   panel.SetIndexedCount(g_searchIndex.Count());
   panel.SetScanning(false);
   g_isScanning = false;
 
-  static Core::UsnMonitor monitor(g_searchIndex);
-  monitor.Start(volume, nextUsn);
+  // Sizes and times fill in while the names are already searchable; the
+  // journal picks up from nextUsn, so writes made meanwhile are replayed.
+  Core::MftScanner::CollectMetadata(g_searchIndex, volume);
+
+  std::unique_ptr<Core::JournalSource> source =
+      std::make_unique<Core::VolumeJournalSource>(volume, nextUsn);
+  if (const char *recordPath = std::getenv("PULSEFS_RECORD_JOURNAL")) {
+    source = std::make_unique<Core::JournalRecorder>(std::move(source),
+                                                     recordPath);
+  }
+
+  g_monitor.Start(std::move(source));
+  panel.SetJournalMonitor(&g_monitor);
 }
 
 void MainWindow::Run() {
@@ -47,12 +66,21 @@ void MainWindow::Run() {
 
   window.Show();
 
+  // PULSEFS_TRACE=<file> records trace spans from startup; F9 writes them
+  // out, and they are written again on exit.
+  const char *tracePath = std::getenv("PULSEFS_TRACE");
+  Utils::Trace::Enable(tracePath != nullptr);
+  Utils::Trace::SetThreadName("UI");
+
   ImGuiLayer::ImGuiManager::Initialize(window.GetHandle(), renderer.GetDevice(),
                                        renderer.GetDeviceContext());
 
   IconCache iconCache(renderer.GetDevice());
+  Platform::Win32Shell shell;
+  g_searchIndex.SetLockTracking(true);
   SearchPanel searchPanel;
-  searchPanel.Initialize(g_searchIndex, &renderer, &iconCache);
+  searchPanel.Initialize(g_searchIndex, &iconCache, &shell);
+  searchPanel.SetScanProgress(&g_scanProgress);
 
   std::thread mftThread(MftWorker, std::ref(searchPanel));
   mftThread.detach();
@@ -67,6 +95,9 @@ void MainWindow::Run() {
     }
 
     ImGuiLayer::ImGuiManager::BeginFrame();
+    iconCache.BeginFrame();
+    if (tracePath && ImGui::IsKeyPressed(ImGuiKey_F9, false))
+      Utils::Trace::WriteChromeJson(tracePath);
     searchPanel.Render();
     ImGuiLayer::ImGuiManager::EndFrame();
 
@@ -76,6 +107,8 @@ void MainWindow::Run() {
   }
 
   ImGuiLayer::ImGuiManager::Shutdown();
+  if (tracePath)
+    Utils::Trace::WriteChromeJson(tracePath);
 }
 
 } // namespace PulseFS::UI
@@ -1,67 +1,212 @@
 #include "PulseFS/UI/SearchPanel.hpp"
-#include "PulseFS/UI/IconCache.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
 #include "imgui.h"
-#include <Windows.h>
 #include <algorithm>
 #include <chrono>
-#include <shellapi.h>
-#include <thread>
-
+#include <ctime>
+#include <memory>
 
 namespace PulseFS::UI {
 
-void SearchPanel::Initialize(Engine::SearchIndex &index, Renderer::D3D11Renderer* renderer, IconCache* iconCache) {
+void SearchPanel::Initialize(Engine::SearchIndex &index, IconSource* icons, FileActions* files) {
   m_SearchIndex = &index;
-  m_Renderer = renderer;
-  m_IconCache = iconCache;
-
-  std::thread([this]() {
-    std::wstring lastQuery;
-    auto lastRefreshTime = std::chrono::steady_clock::now();
-    const auto refreshInterval = std::chrono::milliseconds(500);
-
-    while (true) {
-      std::wstring query;
-      {
-        std::lock_guard<std::mutex> lock(m_ResultsMutex);
-        query = m_CurrentQuery;
-      }
+  m_Icons = icons;
+  m_Files = files;
 
-      auto now = std::chrono::steady_clock::now();
-      bool shouldRefresh = (now - lastRefreshTime) >= refreshInterval;
-
-      if (m_SearchPending || (shouldRefresh && !query.empty())) {
-        if (!query.empty()) {
-          auto start = std::chrono::high_resolution_clock::now();
-          auto results = m_SearchIndex->Search(query, 100);
-          auto end = std::chrono::high_resolution_clock::now();
-
-          {
-            std::lock_guard<std::mutex> lock(m_ResultsMutex);
-            m_SearchResults = std::move(results);
-            m_SearchTimeMs =
-                std::chrono::duration_cast<std::chrono::milliseconds>(end -
-                                                                      start)
-                    .count();
-          }
-          lastQuery = query;
-          lastRefreshTime = now;
-        } else {
-          std::lock_guard<std::mutex> lock(m_ResultsMutex);
-          m_SearchResults.clear();
-          lastQuery.clear();
-        }
-        m_SearchPending = false;
+  m_Service = std::make_unique<Engine::SearchService>(index);
+}
+
+void SearchPanel::SetQuery(std::string_view utf8) {
+  const size_t length = std::min(utf8.size(), sizeof(m_SearchQueryBuf) - 1);
+  utf8.copy(m_SearchQueryBuf, length);
+  m_SearchQueryBuf[length] = '\0';
+  OnQueryEdited();
+}
+
+void SearchPanel::OnQueryEdited() {
+  std::wstring query = Utils::WideFromUtf8(m_SearchQueryBuf);
+  {
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    m_CurrentQuery = query;
+  }
+  if (query.empty()) {
+    SubmitBrowse(Engine::SearchPriority::Interactive);
+    return;
+  }
+  SubmitSearch(std::move(query), Engine::SearchPriority::Interactive);
+}
+
+void SearchPanel::Browse(unsigned long long folderId) {
+  {
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    m_BrowsePath.push_back(folderId);
+  }
+  SubmitBrowse(Engine::SearchPriority::Interactive);
+}
+
+size_t SearchPanel::ResultCount() {
+  std::lock_guard<std::mutex> lock(m_ResultsMutex);
+  return m_Model ? m_Model->Size() : 0;
+}
+
+void SearchPanel::SubmitSearch(std::wstring query,
+                               Engine::SearchPriority priority) {
+  uint64_t ticket;
+  {
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    ticket = ++m_SearchTicket;
+    // Until the new results land, deltas for the old query are meaningless.
+    m_SearchIndex->Unsubscribe(m_Standing);
+    m_Standing.reset();
+  }
+
+  Engine::SearchJob job;
+  job.query = std::move(query);
+  job.maxResults = m_MaxResults;
+  job.priority = priority;
+  job.subscribe = true;
+  job.supersede = priority == Engine::SearchPriority::Interactive;
+  m_Service->Submit(std::move(job), [this,
+                                     ticket](Engine::SearchOutcome outcome) {
+    if (outcome.cancelled)
+      return;
+    // Resolve the rows here, on the search thread, so the UI only reads them.
+    auto model = std::make_shared<Engine::DisplayModel>(&FormatFileTime);
+    model->Rebuild(*m_SearchIndex, outcome.ids);
+
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    // A newer search was submitted while this one ran.
+    if (ticket != m_SearchTicket) {
+      m_SearchIndex->Unsubscribe(outcome.standing);
+      return;
+    }
+    m_Standing = std::move(outcome.standing);
+    m_Model = std::move(model);
+    m_SearchTimeUs = static_cast<uint64_t>(outcome.elapsed.count());
+  });
+}
+
+void SearchPanel::SubmitBrowse(Engine::SearchPriority priority) {
+  uint64_t ticket;
+  unsigned long long folder;
+  {
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    ticket = ++m_SearchTicket;
+    m_SearchIndex->Unsubscribe(m_Standing);
+    m_Standing.reset();
+    m_BrowseGeneration = m_SearchIndex->Generation();
+    if (m_BrowsePath.empty()) {
+      // Nothing to browse until the scan has inserted the root.
+      const auto roots = m_SearchIndex->GetRootIds();
+      if (roots.empty()) {
+        m_Model.reset();
+        return;
       }
-      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      m_BrowsePath.push_back(roots.front());
     }
-  }).detach();
+    folder = m_BrowsePath.back();
+  }
+
+  Engine::SearchJob job;
+  job.browseParent = folder;
+  job.priority = priority;
+  job.supersede = priority == Engine::SearchPriority::Interactive;
+  m_Service->Submit(std::move(job), [this,
+                                     ticket](Engine::SearchOutcome outcome) {
+    if (outcome.cancelled)
+      return;
+    auto model = std::make_shared<Engine::DisplayModel>(&FormatFileTime);
+    model->Rebuild(*m_SearchIndex, outcome.ids);
+    model->SortByName();
+
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    if (ticket != m_SearchTicket)
+      return;
+    m_Model = std::move(model);
+    m_SearchTimeUs = static_cast<uint64_t>(outcome.elapsed.count());
+  });
+}
+
+void SearchPanel::ApplyResultDelta() {
+  std::unique_lock<std::mutex> lock(m_ResultsMutex);
+  if (m_CurrentQuery.empty()) {
+    // Listings have no standing query; relist a few times a second at most
+    // while the index changes.
+    const auto now = std::chrono::steady_clock::now();
+    if (m_BrowseGeneration != m_SearchIndex->Generation() &&
+        now - m_LastMetadataRefresh >= std::chrono::milliseconds(250)) {
+      m_LastMetadataRefresh = now;
+      lock.unlock();
+      SubmitBrowse(Engine::SearchPriority::Refresh);
+    }
+    return;
+  }
+  if (!m_Standing || !m_Model || m_ModelUpdatePending)
+    return;
+  Engine::ResultDelta delta = m_Standing->TakeDelta();
+  if (delta.Empty()) {
+    // Sizes and times change without changing membership; pick them up a
+    // few times a second at most.
+    const auto now = std::chrono::steady_clock::now();
+    if (m_Model->MetadataGeneration() != m_SearchIndex->Generation() &&
+        now - m_LastMetadataRefresh >= std::chrono::milliseconds(250)) {
+      m_LastMetadataRefresh = now;
+      lock.unlock();
+      SubmitModelUpdate(std::move(delta));
+    }
+    return;
+  }
+
+  if (delta.resync) {
+    std::wstring query = m_CurrentQuery;
+    lock.unlock();
+    SubmitSearch(std::move(query), Engine::SearchPriority::Refresh);
+    return;
+  }
+
+  lock.unlock();
+  SubmitModelUpdate(std::move(delta));
+}
+
+// Folds `delta` into a copy of the model on the search thread, or re-reads
+// its metadata if the delta is empty, and publishes the copy unless a new
+// search has replaced the model meanwhile.
+void SearchPanel::SubmitModelUpdate(Engine::ResultDelta delta) {
+  std::shared_ptr<const Engine::DisplayModel> base;
+  uint64_t ticket;
+  size_t maxRows;
+  {
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    base = m_Model;
+    ticket = m_SearchTicket;
+    maxRows = m_MaxResults;
+    m_ModelUpdatePending = true;
+  }
+
+  Engine::SearchJob job;
+  job.priority = Engine::SearchPriority::Refresh;
+  job.task = [this, base, ticket, maxRows, delta = std::move(delta)] {
+    auto model = std::make_shared<Engine::DisplayModel>(*base);
+    if (delta.Empty())
+      model->RefreshMetadata(*m_SearchIndex);
+    else
+      model->Apply(*m_SearchIndex, delta, maxRows);
+
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    if (ticket == m_SearchTicket)
+      m_Model = std::move(model);
+  };
+  m_Service->Submit(std::move(job), [this](Engine::SearchOutcome) {
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    m_ModelUpdatePending = false;
+  });
 }
 
 void SearchPanel::Render() {
   if (!m_IsScanning) {
     m_IndexedCount = m_SearchIndex->Count();
   }
+  ApplyResultDelta();
 
   ImGuiViewport *viewport = ImGui::GetMainViewport();
   ImGui::SetNextWindowPos(viewport->WorkPos);
@@ -88,6 +233,8 @@ void SearchPanel::Render() {
                         ImGuiWindowFlags_None)) {
     RenderSearchBar();
     RenderStatusBar();
+    if (m_CurrentQuery.empty())
+      RenderBrowseBar();
     ImGui::Separator();
     RenderResultsTable();
   }
@@ -99,9 +246,7 @@ void SearchPanel::RenderSearchBar() {
   ImGui::SetNextItemWidth(-1.0f);
   if (ImGui::InputText("##Search", m_SearchQueryBuf,
                        IM_ARRAYSIZE(m_SearchQueryBuf))) {
-    std::lock_guard<std::mutex> lock(m_ResultsMutex);
-    m_CurrentQuery = Utf8ToWide(m_SearchQueryBuf);
-    m_SearchPending = true;
+    OnQueryEdited();
   }
 
   if (!ImGui::IsItemFocused() && ImGui::IsWindowFocused()) {
@@ -109,27 +254,106 @@ void SearchPanel::RenderSearchBar() {
   }
 }
 
+void SearchPanel::RenderBrowseBar() {
+  unsigned long long folder = 0;
+  bool atRoot = true;
+  {
+    std::lock_guard<std::mutex> lock(m_ResultsMutex);
+    if (m_BrowsePath.empty())
+      return;
+    folder = m_BrowsePath.back();
+    atRoot = m_BrowsePath.size() == 1;
+  }
+
+  ImGui::BeginDisabled(atRoot);
+  if (ImGui::Button("Up")) {
+    {
+      std::lock_guard<std::mutex> lock(m_ResultsMutex);
+      m_BrowsePath.pop_back();
+    }
+    SubmitBrowse(Engine::SearchPriority::Interactive);
+  }
+  ImGui::EndDisabled();
+  ImGui::SameLine();
+  ImGui::TextUnformatted(
+      Utils::Utf8FromWide(m_SearchIndex->GetFullPath(folder)).c_str());
+}
+
 void SearchPanel::RenderStatusBar() {
-  if (m_IsScanning) {
+  const Core::ScanProgress *progress = m_ScanProgress.load();
+  if (m_IsScanning && !progress) {
     ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f),
                        "Scanning MFT... Please wait.");
+    return;
+  }
+
+  if (m_IsScanning) {
+    // Published entries are already searchable; the rest are on their way.
+    const Core::ScanStats scan = progress->GetStats();
+    ImGui::TextColored(ImVec4(1.0f, 1.0f, 0.0f, 1.0f),
+                       "Scanning... %zu found, %zu searchable (%.0fk/s).",
+                       scan.entriesFound, scan.entriesPublished,
+                       scan.entriesPerSecond / 1000.0);
   } else {
     ImGui::TextColored(ImVec4(0.0f, 1.0f, 0.0f, 1.0f),
                        "Index Ready. %zu files.", m_IndexedCount.load());
-    ImGui::SameLine();
+  }
+  ImGui::SameLine();
 
-    size_t resultCount = 0;
-    {
-      std::lock_guard<std::mutex> lock(m_ResultsMutex);
-      resultCount = m_SearchResults.size();
+  const size_t resultCount = ResultCount();
+  ImGui::TextDisabled("| Found %zu results | Search Time: %.2f ms",
+                      resultCount, m_SearchTimeUs.load() / 1000.0);
+  if (ImGui::IsItemHovered())
+    RenderMetricsTooltip();
+}
+
+void SearchPanel::RenderMetricsTooltip() {
+  const Engine::IndexStats stats = m_SearchIndex->GetStats();
+  ImGui::BeginTooltip();
+  ImGui::TextUnformatted("Query latency by length (p50 / p99)");
+  for (size_t i = 0; i < Engine::kQueryLengthClasses; ++i) {
+    const auto &latency = stats.queryLatencyNs[i];
+    if (latency.count == 0)
+      continue;
+    ImGui::Text("  %-4s %8.2f / %8.2f ms  (%llu)",
+                Engine::QueryLengthClassName(i),
+                latency.Percentile(0.5) / 1e6, latency.Percentile(0.99) / 1e6,
+                static_cast<unsigned long long>(latency.count));
+  }
+  ImGui::Text("Entries scanned: %llu", stats.entriesScanned);
+  ImGui::Text("Distinct names: %zu of %zu entries", stats.distinctNames,
+              stats.liveEntries);
+  ImGui::Text("Lock wait p99: read %.1f us, write %.1f us",
+              stats.sharedWaitNs.Percentile(0.99) / 1e3,
+              stats.exclusiveWaitNs.Percentile(0.99) / 1e3);
+  ImGui::Text("Memory: entries %.1f MB, names %.1f MB, ids %.1f MB, "
+              "attributes %.1f MB, children %.1f MB, totals %.1f MB",
+              stats.entryBytes / 1048576.0, stats.nameBytes / 1048576.0,
+              stats.idMapBytes / 1048576.0, stats.attributeBytes / 1048576.0,
+              stats.childBytes / 1048576.0, stats.totalsBytes / 1048576.0);
+  if (const Core::ScanProgress *progress = m_ScanProgress.load()) {
+    const Core::ScanStats scan = progress->GetStats();
+    ImGui::Text("Scan: %zu entries in %.1f s, published in %zu steps",
+                scan.entriesFound, scan.seconds, scan.publications);
+  }
+
+  if (const Core::UsnMonitor *monitor = m_Monitor.load()) {
+    const Core::JournalStats journal = monitor->GetStats();
+    ImGui::Separator();
+    ImGui::Text("Journal: %.0f events/s, %llu applied", journal.eventsPerSecond,
+                journal.changesApplied);
+    if (journal.lagBytes >= 0) {
+      ImGui::Text("Journal lag: %lld bytes, %.2f s", journal.lagBytes,
+                  journal.lagSeconds);
     }
-    ImGui::TextDisabled("| Found %zu results | Search Time: %llu ms",
-                        resultCount, m_SearchTimeMs.load());
+    ImGui::Text("Batch apply p99: %.2f ms",
+                journal.applyLatencyNs.Percentile(0.99) / 1e6);
   }
+  ImGui::EndTooltip();
 }
 
 void SearchPanel::RenderResultsTable() {
-  if (ImGui::BeginTable("Results", 2,
+  if (ImGui::BeginTable("Results", 4,
                         ImGuiTableFlags_RowBg | ImGuiTableFlags_ScrollY |
                             ImGuiTableFlags_BordersOuter |
                             ImGuiTableFlags_SizingStretchProp)) {
@@ -137,167 +361,102 @@ void SearchPanel::RenderResultsTable() {
     ImGui::TableSetupColumn("File Name", ImGuiTableColumnFlags_WidthStretch,
                             0.3f);
     ImGui::TableSetupColumn("Full Path", ImGuiTableColumnFlags_WidthStretch,
-                            0.7f);
+                            0.5f);
+    ImGui::TableSetupColumn("Size", ImGuiTableColumnFlags_WidthStretch, 0.08f);
+    ImGui::TableSetupColumn("Date Modified",
+                            ImGuiTableColumnFlags_WidthStretch, 0.12f);
     ImGui::TableHeadersRow();
 
-    std::vector<unsigned long long> currentResultsCopy;
+    std::shared_ptr<const Engine::DisplayModel> model;
     {
       std::lock_guard<std::mutex> lock(m_ResultsMutex);
-      currentResultsCopy = m_SearchResults;
+      model = m_Model;
+    }
+    if (!model) {
+      ImGui::EndTable();
+      return;
     }
 
-    std::sort(currentResultsCopy.begin(), currentResultsCopy.end(),
-              [this](unsigned long long idA, unsigned long long idB) {
-                unsigned long attrsA = m_SearchIndex->GetAttributes(idA);
-                unsigned long attrsB = m_SearchIndex->GetAttributes(idB);
-                bool isDirA = (attrsA & FILE_ATTRIBUTE_DIRECTORY) != 0;
-                bool isDirB = (attrsB & FILE_ATTRIBUTE_DIRECTORY) != 0;
-                
-                if (isDirA != isDirB) {
-                  return isDirA;
-                }
-                return false;
-              });
-
-    for (auto id : currentResultsCopy) {
-      std::wstring fullPath = m_SearchIndex->GetFullPath(id);
-      if (fullPath.empty())
-        continue;
-
-      ImGui::TableNextRow();
-      ImGui::TableSetColumnIndex(0);
-
-      std::string fullPathUtf8 = WideToUtf8(fullPath);
-      size_t lastSlash = fullPathUtf8.find_last_of('\\');
-      std::string fileName = (lastSlash != std::string::npos)
-                                 ? fullPathUtf8.substr(lastSlash + 1)
-                                 : fullPathUtf8;
-
-      unsigned long fileAttrs = m_SearchIndex->GetAttributes(id);
-      bool isDir = (fileAttrs & FILE_ATTRIBUTE_DIRECTORY) != 0;
-      
-      if (m_IconCache) {
-        ID3D11ShaderResourceView* iconTexture = m_IconCache->GetIcon(fullPath, isDir);
-        if (iconTexture) {
-          ImGui::Image((void*)iconTexture, ImVec2(16, 16));
-          ImGui::SameLine();
+    const auto &rows = model->Rows();
+    ImGuiListClipper clipper;
+    clipper.Begin(static_cast<int>(rows.size()));
+    while (clipper.Step()) {
+      for (int i = clipper.DisplayStart; i < clipper.DisplayEnd; ++i) {
+        const Engine::DisplayRow &row = rows[i];
+        const bool isDir = row.kind == Engine::RowKind::Directory;
+
+        ImGui::TableNextRow();
+        ImGui::TableSetColumnIndex(0);
+
+        if (m_Icons) {
+          IconView icon = m_Icons->GetIcon(row.iconKey, isDir);
+          if (icon.texture) {
+            ImGui::Image(icon.texture, ImVec2(16, 16),
+                         ImVec2(icon.u0, icon.v0), ImVec2(icon.u1, icon.v1));
+            ImGui::SameLine();
+          }
         }
-      }
-      
-      ImGui::Text("%s", fileName.c_str());
-
-      if (IsImageFile(fullPath) && ImGui::IsItemHovered() && m_IconCache) {
-        auto* thumbnail = m_IconCache->GetImageThumbnail(fullPath);
-        if (thumbnail) {
-          ImGui::BeginTooltip();
-          ImGui::Image((void*)thumbnail, ImVec2(256, 256));
-          ImGui::EndTooltip();
+
+        ImGui::TextUnformatted(row.Name());
+
+        if (row.kind == Engine::RowKind::Image && ImGui::IsItemHovered() &&
+            m_Icons) {
+          IconView thumbnail = m_Icons->GetThumbnail(row.path);
+          if (thumbnail.texture) {
+            ImGui::BeginTooltip();
+            ImGui::Image(thumbnail.texture,
+                         ImVec2(static_cast<float>(thumbnail.width),
+                                static_cast<float>(thumbnail.height)));
+            ImGui::EndTooltip();
+          }
         }
-      }
-      
-      if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0)) {
-        OpenFile(fullPath);
-      }
 
-      ImGui::TableSetColumnIndex(1);
-      ImGui::TextDisabled("%s", fullPathUtf8.c_str());
+        if (ImGui::IsItemHovered() && ImGui::IsMouseDoubleClicked(0)) {
+          // In browse mode a folder opens in place.
+          if (isDir && m_CurrentQuery.empty())
+            Browse(row.id);
+          else if (m_Files)
+            m_Files->Reveal(row.path);
+        }
+
+        ImGui::TableSetColumnIndex(1);
+        ImGui::TextDisabled("%s", row.pathUtf8.c_str());
+
+        if (!row.sizeText.empty()) {
+          ImGui::TableSetColumnIndex(2);
+          ImGui::TextDisabled("%s", row.sizeText.c_str());
+        }
+        if (!row.timeText.empty()) {
+          ImGui::TableSetColumnIndex(3);
+          ImGui::TextDisabled("%s", row.timeText.c_str());
+        }
+      }
     }
     ImGui::EndTable();
   }
 }
 
-void SearchPanel::OpenFile(const std::wstring &path) {
-  if (path.empty())
-    return;
-  std::wstring cmd = L"/select,\"" + path + L"\"";
-  ShellExecuteW(NULL, L"open", L"explorer.exe", cmd.c_str(), NULL, SW_SHOW);
-}
+std::string SearchPanel::FormatFileTime(long long fileTime) {
+  // FILETIME counts 100 ns ticks from 1601, time_t seconds from 1970.
+  constexpr long long kUnixEpochTicks = 116444736000000000LL;
+  constexpr long long kTicksPerSecond = 10000000LL;
+  const std::time_t seconds =
+      static_cast<std::time_t>((fileTime - kUnixEpochTicks) / kTicksPerSecond);
 
-std::string SearchPanel::WideToUtf8(const std::wstring &wstr) {
-  if (wstr.empty())
+  std::tm localTime{};
+#ifdef _WIN32
+  if (localtime_s(&localTime, &seconds) != 0) {
     return std::string();
-  int size_needed = WideCharToMultiByte(
-      CP_UTF8, 0, &wstr[0], static_cast<int>(wstr.size()), NULL, 0, NULL, NULL);
-  std::string strTo(size_needed, 0);
-  WideCharToMultiByte(CP_UTF8, 0, &wstr[0], static_cast<int>(wstr.size()),
-                      &strTo[0], size_needed, NULL, NULL);
-  return strTo;
-}
-
-std::wstring SearchPanel::Utf8ToWide(const std::string &str) {
-  if (str.empty())
-    return std::wstring();
-  int size_needed = MultiByteToWideChar(CP_UTF8, 0, &str[0],
-                                        static_cast<int>(str.size()), NULL, 0);
-  std::wstring wstrTo(size_needed, 0);
-  MultiByteToWideChar(CP_UTF8, 0, &str[0], static_cast<int>(str.size()),
-                      &wstrTo[0], size_needed);
-  return wstrTo;
-}
-
-const char* SearchPanel::GetFileIcon(const std::wstring &fileName, unsigned long fileAttributes) {
-  if (fileAttributes & FILE_ATTRIBUTE_DIRECTORY) {
-    return "[DIR]";
-  }
-  
-  size_t lastDot = fileName.find_last_of(L'.');
-  if (lastDot == std::wstring::npos) {
-    return "[FILE]";
-  }
-  
-  std::wstring ext = fileName.substr(lastDot + 1);
-  std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
-  
-  if (ext == L"jpg" || ext == L"jpeg" || ext == L"png" || 
-      ext == L"bmp" || ext == L"gif" || ext == L"ico" || 
-      ext == L"tiff" || ext == L"webp") {
-    return "[IMG]";
-  }
-  else if (ext == L"mp4" || ext == L"avi" || ext == L"mkv" || 
-           ext == L"mov" || ext == L"wmv" || ext == L"flv") {
-    return "[VID]";
-  }
-  else if (ext == L"mp3" || ext == L"wav" || ext == L"flac" || 
-           ext == L"m4a" || ext == L"wma" || ext == L"ogg") {
-    return "[AUD]";
-  }
-  else if (ext == L"zip" || ext == L"rar" || ext == L"7z" || 
-           ext == L"tar" || ext == L"gz") {
-    return "[ZIP]";
   }
-  else if (ext == L"exe" || ext == L"msi" || ext == L"bat") {
-    return "[EXE]";
-  }
-  else if (ext == L"txt" || ext == L"log") {
-    return "[TXT]";
-  }
-  else if (ext == L"pdf") {
-    return "[PDF]";
-  }
-  else if (ext == L"doc" || ext == L"docx") {
-    return "[DOC]";
-  }
-  else if (ext == L"cpp" || ext == L"h" || ext == L"hpp" || 
-           ext == L"c" || ext == L"cs" || ext == L"java" || 
-           ext == L"py" || ext == L"js" || ext == L"html" || 
-           ext == L"css" || ext == L"json") {
-    return "[CODE]";
+#else
+  if (!localtime_r(&seconds, &localTime)) {
+    return std::string();
   }
-  
-  return "[FILE]";
-}
+#endif
 
-bool SearchPanel::IsImageFile(const std::wstring &fileName) {
-  size_t lastDot = fileName.find_last_of(L'.');
-  if (lastDot == std::wstring::npos)
-    return false;
-  
-  std::wstring ext = fileName.substr(lastDot + 1);
-  std::transform(ext.begin(), ext.end(), ext.begin(), ::towlower);
-  
-  return ext == L"jpg" || ext == L"jpeg" || ext == L"png" || 
-         ext == L"bmp" || ext == L"gif" || ext == L"ico" || 
-         ext == L"tiff" || ext == L"tif" || ext == L"webp";
+  char buffer[32];
+  std::strftime(buffer, sizeof(buffer), "%Y-%m-%d %H:%M", &localTime);
+  return buffer;
 }
 
 } // namespace PulseFS::UI
@@ -0,0 +1,199 @@
+#include "PulseFS/Utils/AtlasPacker.hpp"
+#include <algorithm>
+#include <bit>
+
+namespace PulseFS::Utils {
+
+AtlasPacker::AtlasPacker(uint32_t pageSize, uint32_t maxPages)
+    : m_pageSize(std::bit_floor(std::max(pageSize, kMinClass))),
+      m_maxPages(std::max<uint32_t>(maxPages, 1)),
+      m_free(std::countr_zero(m_pageSize) + 1) {}
+
+std::optional<AtlasSlot> AtlasPacker::Allocate(uint32_t width, uint32_t height,
+                                               bool pinned) {
+  const uint32_t size =
+      std::bit_ceil(std::max({width, height, kMinClass}));
+  if (width == 0 || height == 0 || size > m_pageSize)
+    return std::nullopt;
+
+  std::optional<uint32_t> index = TakeCell(size);
+  if (!index)
+    index = EvictCell(size);
+  if (!index)
+    index = ReclaimShelves(size);
+  if (!index)
+    return std::nullopt;
+
+  Cell &cell = m_cells[*index];
+  cell.tag = m_nextTag++;
+  cell.lastUse = m_frame;
+  cell.pinned = pinned;
+  return AtlasSlot{*index, cell.tag, cell.page, cell.x,
+                   cell.y, width,    height};
+}
+
+std::optional<uint32_t> AtlasPacker::TakeCell(uint32_t size) {
+  auto &freeCells = m_free[std::countr_zero(size)];
+  if (!freeCells.empty()) {
+    const uint32_t index = freeCells.back();
+    freeCells.pop_back();
+    return index;
+  }
+
+  auto shelf = std::find_if(m_shelves.begin(), m_shelves.end(),
+                            [&](const Shelf &candidate) {
+                              return candidate.size == size &&
+                                     candidate.nextX + size <= m_pageSize;
+                            });
+  if (shelf == m_shelves.end()) {
+    uint32_t page = 0;
+    while (page < m_pageShelfEnd.size() &&
+           m_pageShelfEnd[page] + size > m_pageSize)
+      ++page;
+    if (page == m_pageShelfEnd.size()) {
+      if (page == m_maxPages)
+        return std::nullopt;
+      m_pageShelfEnd.push_back(0);
+    }
+    m_shelves.push_back({page, m_pageShelfEnd[page], size, size});
+    m_pageShelfEnd[page] += size;
+    shelf = m_shelves.end() - 1;
+  }
+
+  const Cell cell{shelf->page, shelf->nextX, shelf->y, size};
+  shelf->nextX += size;
+  if (!m_spareCells.empty()) {
+    const uint32_t index = m_spareCells.back();
+    m_spareCells.pop_back();
+    m_cells[index] = cell;
+    return index;
+  }
+  m_cells.push_back(cell);
+  return static_cast<uint32_t>(m_cells.size() - 1);
+}
+
+std::optional<uint32_t> AtlasPacker::EvictCell(uint32_t size) {
+  std::optional<uint32_t> oldest;
+  for (uint32_t i = 0; i < m_cells.size(); ++i) {
+    const Cell &cell = m_cells[i];
+    if (cell.size != size || cell.pinned || cell.lastUse >= m_frame)
+      continue;
+    if (!oldest || cell.lastUse < m_cells[*oldest].lastUse)
+      oldest = i;
+  }
+  if (oldest)
+    m_evictions++;
+  return oldest;
+}
+
+std::optional<uint32_t> AtlasPacker::ReclaimShelves(uint32_t size) {
+  // A band is a shelf, or the unshelved space at the bottom of a page.
+  struct Band {
+    uint32_t y;
+    uint32_t height;
+    uint64_t lastUse = 0;
+    bool busy = false;
+  };
+  struct Run {
+    uint32_t page;
+    uint32_t y;
+    uint32_t height;
+    uint64_t lastUse;
+  };
+
+  // Shelves are stacked from the top of each page with no gaps, so any run
+  // of adjacent bands at least `size` tall can hold one shelf of that class.
+  std::optional<Run> best;
+  std::vector<Band> bands;
+  for (uint32_t page = 0; page < m_pageShelfEnd.size(); ++page) {
+    bands.clear();
+    for (const Shelf &shelf : m_shelves) {
+      if (shelf.page == page)
+        bands.push_back({shelf.y, shelf.height});
+    }
+    std::sort(bands.begin(), bands.end(),
+              [](const Band &a, const Band &b) { return a.y < b.y; });
+    if (m_pageShelfEnd[page] < m_pageSize)
+      bands.push_back({m_pageShelfEnd[page], m_pageSize - m_pageShelfEnd[page]});
+
+    for (const Cell &cell : m_cells) {
+      if (cell.page != page || cell.size == 0 || cell.tag == 0)
+        continue;
+      auto band = std::lower_bound(
+          bands.begin(), bands.end(), cell.y,
+          [](const Band &candidate, uint32_t y) { return candidate.y < y; });
+      band->lastUse = std::max(band->lastUse, cell.lastUse);
+      band->busy |= cell.pinned || cell.lastUse >= m_frame;
+    }
+
+    for (size_t first = 0; first < bands.size(); ++first) {
+      uint32_t height = 0;
+      uint64_t lastUse = 0;
+      for (size_t last = first; last < bands.size() && !bands[last].busy;
+           ++last) {
+        height += bands[last].height;
+        lastUse = std::max(lastUse, bands[last].lastUse);
+        if (height < size)
+          continue;
+        if (!best || lastUse < best->lastUse ||
+            (lastUse == best->lastUse && height < best->height))
+          best = Run{page, bands[first].y, height, lastUse};
+        break;
+      }
+    }
+  }
+  if (!best)
+    return std::nullopt;
+
+  for (uint32_t i = 0; i < m_cells.size(); ++i) {
+    Cell &cell = m_cells[i];
+    if (cell.page != best->page || cell.size == 0 || cell.y < best->y ||
+        cell.y >= best->y + best->height)
+      continue;
+    if (cell.tag != 0)
+      m_evictions++;
+    else
+      std::erase(m_free[std::countr_zero(cell.size)], i);
+    cell = Cell{best->page, 0, 0, 0};
+    m_spareCells.push_back(i);
+  }
+  std::erase_if(m_shelves, [&](const Shelf &shelf) {
+    return shelf.page == best->page && shelf.y >= best->y &&
+           shelf.y < best->y + best->height;
+  });
+  if (best->y + best->height == m_pageSize) {
+    // Nothing below the run: hand it back as unshelved space.
+    m_pageShelfEnd[best->page] = best->y;
+  } else {
+    // Cut the run into shelves of the new class; the last one keeps any
+    // remainder, which is less than a class tall.
+    const uint32_t count = best->height / size;
+    for (uint32_t i = 0; i < count; ++i) {
+      const uint32_t height =
+          i + 1 == count ? best->height - i * size : size;
+      m_shelves.push_back({best->page, best->y + i * size, height, size});
+    }
+  }
+  return TakeCell(size);
+}
+
+bool AtlasPacker::Valid(const AtlasSlot &slot) const {
+  return slot.tag != 0 && slot.cell < m_cells.size() &&
+         m_cells[slot.cell].tag == slot.tag;
+}
+
+void AtlasPacker::Touch(const AtlasSlot &slot) {
+  if (Valid(slot))
+    m_cells[slot.cell].lastUse = m_frame;
+}
+
+void AtlasPacker::Release(const AtlasSlot &slot) {
+  if (!Valid(slot))
+    return;
+  Cell &cell = m_cells[slot.cell];
+  cell.tag = 0;
+  cell.pinned = false;
+  m_free[std::countr_zero(cell.size)].push_back(slot.cell);
+}
+
+} // namespace PulseFS::Utils
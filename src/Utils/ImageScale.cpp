@@ -0,0 +1,175 @@
+#include "PulseFS/Utils/ImageScale.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+// PULSEFS_IMAGE_SCALAR forces the plain loops, so the tests can hold them to
+// the same results on targets that have SSE2.
+#if !defined(PULSEFS_IMAGE_SCALAR) &&                                          \
+    (defined(__SSE2__) || defined(_M_X64) ||                                   \
+     (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+#define PULSEFS_IMAGE_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace PulseFS::Utils {
+
+std::pair<uint32_t, uint32_t> FitWithin(uint32_t width, uint32_t height,
+                                        uint32_t maxSide) {
+  width = std::max<uint32_t>(width, 1);
+  height = std::max<uint32_t>(height, 1);
+  maxSide = std::max<uint32_t>(maxSide, 1);
+  if (width <= maxSide && height <= maxSide)
+    return {width, height};
+  auto scaled = [maxSide](uint32_t side, uint32_t longest) {
+    const double value = static_cast<double>(side) * maxSide / longest;
+    return std::max<uint32_t>(static_cast<uint32_t>(std::lround(value)), 1);
+  };
+  if (width >= height)
+    return {maxSide, scaled(height, width)};
+  return {scaled(width, height), maxSide};
+}
+
+BgraDownscaler::BgraDownscaler(uint32_t srcWidth, uint32_t srcHeight,
+                               uint32_t dstWidth, uint32_t dstHeight)
+    : m_srcWidth(std::max<uint32_t>(srcWidth, 1)),
+      m_srcHeight(std::max<uint32_t>(srcHeight, 1)),
+      m_dstWidth(std::clamp<uint32_t>(dstWidth, 1, m_srcWidth)),
+      m_dstHeight(std::clamp<uint32_t>(dstHeight, 1, m_srcHeight)),
+      m_scaleY(static_cast<double>(m_srcHeight) / m_dstHeight) {
+  // Each destination column covers [x * scale, (x + 1) * scale) of the
+  // source; weight every source pixel by how much of it falls inside.
+  const double scaleX = static_cast<double>(m_srcWidth) / m_dstWidth;
+  m_spans.reserve(m_dstWidth);
+  for (uint32_t x = 0; x < m_dstWidth; ++x) {
+    const double lo = x * scaleX;
+    const double hi = x + 1 == m_dstWidth ? m_srcWidth : (x + 1) * scaleX;
+    const auto first = static_cast<uint32_t>(lo);
+    const auto end = std::min<uint32_t>(
+        static_cast<uint32_t>(std::ceil(hi)), m_srcWidth);
+    Span span{first, 0, static_cast<uint32_t>(m_weights.size())};
+    for (uint32_t i = first; i < end; ++i) {
+      const double coverage = std::min<double>(i + 1, hi) - std::max<double>(i, lo);
+      if (coverage <= 0)
+        continue;
+      if (span.count == 0)
+        span.first = i;
+      m_weights.push_back(static_cast<float>(coverage / scaleX));
+      span.count++;
+    }
+    m_spans.push_back(span);
+  }
+
+  const size_t rowFloats = static_cast<size_t>(m_dstWidth) * 4;
+  m_filtered.assign(rowFloats, 0.0f);
+  m_current.assign(rowFloats, 0.0f);
+  m_next.assign(rowFloats, 0.0f);
+  m_pixels.assign(rowFloats * m_dstHeight, 0);
+}
+
+void BgraDownscaler::PushRow(const uint8_t *row) {
+  if (Finished())
+    return;
+
+  FilterRow(row);
+
+  auto boundary = [this](uint32_t y) {
+    return y + 1 == m_dstHeight ? static_cast<double>(m_srcHeight)
+                                : (y + 1) * m_scaleY;
+  };
+  constexpr double kEpsilon = 1e-9;
+  const double rowWeight = 1.0 / m_scaleY;
+  const double split = boundary(m_dstRow) - m_srcRow;
+  if (split >= 1.0 - kEpsilon) {
+    Accumulate(m_current, static_cast<float>(rowWeight));
+  } else {
+    // The destination never outgrows the source, so the rest of this row
+    // belongs entirely to the next destination row.
+    Accumulate(m_current, static_cast<float>(split * rowWeight));
+    Accumulate(m_next, static_cast<float>((1.0 - split) * rowWeight));
+  }
+  m_srcRow++;
+
+  while (m_dstRow < m_dstHeight && m_srcRow + kEpsilon >= boundary(m_dstRow)) {
+    EmitRow(m_dstRow++);
+    std::swap(m_current, m_next);
+    std::fill(m_next.begin(), m_next.end(), 0.0f);
+  }
+}
+
+void BgraDownscaler::FilterRow(const uint8_t *row) {
+  float *out = m_filtered.data();
+  for (uint32_t x = 0; x < m_dstWidth; ++x) {
+    const Span &span = m_spans[x];
+    const float *weights = m_weights.data() + span.weightOffset;
+    const uint8_t *pixels = row + static_cast<size_t>(span.first) * 4;
+#ifdef PULSEFS_IMAGE_SSE2
+    const __m128i zero = _mm_setzero_si128();
+    __m128 sum = _mm_setzero_ps();
+    for (uint32_t i = 0; i < span.count; ++i) {
+      int32_t packed;
+      std::memcpy(&packed, pixels + i * 4, sizeof(packed));
+      __m128i wide = _mm_unpacklo_epi8(_mm_cvtsi32_si128(packed), zero);
+      wide = _mm_unpacklo_epi16(wide, zero);
+      sum = _mm_add_ps(sum, _mm_mul_ps(_mm_cvtepi32_ps(wide),
+                                       _mm_set1_ps(weights[i])));
+    }
+    _mm_storeu_ps(out + x * 4, sum);
+#else
+    float sum[4] = {};
+    for (uint32_t i = 0; i < span.count; ++i) {
+      for (int c = 0; c < 4; ++c)
+        sum[c] += static_cast<float>(pixels[i * 4 + c]) * weights[i];
+    }
+    std::memcpy(out + x * 4, sum, sizeof(sum));
+#endif
+  }
+}
+
+void BgraDownscaler::Accumulate(std::vector<float> &into, float weight) {
+  const float *in = m_filtered.data();
+  float *acc = into.data();
+  const size_t count = into.size();
+#ifdef PULSEFS_IMAGE_SSE2
+  const __m128 scale = _mm_set1_ps(weight);
+  for (size_t i = 0; i < count; i += 4) {
+    const __m128 value = _mm_mul_ps(_mm_loadu_ps(in + i), scale);
+    _mm_storeu_ps(acc + i, _mm_add_ps(_mm_loadu_ps(acc + i), value));
+  }
+#else
+  for (size_t i = 0; i < count; ++i)
+    acc[i] += in[i] * weight;
+#endif
+}
+
+void BgraDownscaler::EmitRow(uint32_t y) {
+  const float *in = m_current.data();
+  uint8_t *out = m_pixels.data() + static_cast<size_t>(y) * m_dstWidth * 4;
+#ifdef PULSEFS_IMAGE_SSE2
+  const __m128 half = _mm_set1_ps(0.5f);
+  for (uint32_t x = 0; x < m_dstWidth; ++x) {
+    __m128i value =
+        _mm_cvttps_epi32(_mm_add_ps(_mm_loadu_ps(in + x * 4), half));
+    value = _mm_packs_epi32(value, value);
+    value = _mm_packus_epi16(value, value);
+    const int32_t packed = _mm_cvtsi128_si32(value);
+    std::memcpy(out + x * 4, &packed, sizeof(packed));
+  }
+#else
+  for (size_t i = 0; i < static_cast<size_t>(m_dstWidth) * 4; ++i) {
+    const auto value = static_cast<int>(in[i] + 0.5f);
+    out[i] = static_cast<uint8_t>(std::clamp(value, 0, 255));
+  }
+#endif
+}
+
+std::vector<uint8_t> DownscaleBgra(const uint8_t *src, uint32_t srcWidth,
+                                   uint32_t srcHeight, size_t srcStride,
+                                   uint32_t dstWidth, uint32_t dstHeight) {
+  BgraDownscaler scaler(srcWidth, srcHeight, dstWidth, dstHeight);
+  for (uint32_t y = 0; y < srcHeight; ++y)
+    scaler.PushRow(src + y * srcStride);
+  return std::move(scaler.Pixels());
+}
+
+} // namespace PulseFS::Utils
@@ -0,0 +1,105 @@
+#include "PulseFS/Utils/Metrics.hpp"
+#include <algorithm>
+#include <bit>
+#include <cstdio>
+
+namespace PulseFS::Utils {
+
+size_t Histogram::BucketOf(uint64_t value) {
+  if (value < kSubBuckets)
+    return static_cast<size_t>(value);
+  const unsigned shift = static_cast<unsigned>(std::bit_width(value)) - 1 -
+                         kSubBucketBits;
+  return (shift + 1) * kSubBuckets +
+         static_cast<size_t>((value >> shift) - kSubBuckets);
+}
+
+uint64_t Histogram::BucketUpperBound(size_t bucket) {
+  if (bucket < kSubBuckets)
+    return bucket;
+  const unsigned shift = static_cast<unsigned>(bucket / kSubBuckets) - 1;
+  const uint64_t sub = kSubBuckets + bucket % kSubBuckets;
+  return ((sub + 1) << shift) - 1;
+}
+
+void Histogram::Record(uint64_t value) {
+  m_buckets[BucketOf(value)].fetch_add(1, std::memory_order_relaxed);
+  m_sum.fetch_add(value, std::memory_order_relaxed);
+  uint64_t previous = m_max.load(std::memory_order_relaxed);
+  while (value > previous &&
+         !m_max.compare_exchange_weak(previous, value,
+                                      std::memory_order_relaxed)) {
+  }
+}
+
+HistogramSnapshot Histogram::Snapshot() const {
+  HistogramSnapshot snapshot;
+  snapshot.buckets.resize(kBucketCount);
+  // The count comes from the buckets so percentiles stay consistent with it
+  // while other threads keep recording.
+  for (size_t i = 0; i < kBucketCount; ++i) {
+    snapshot.buckets[i] = m_buckets[i].load(std::memory_order_relaxed);
+    snapshot.count += snapshot.buckets[i];
+  }
+  snapshot.sum = m_sum.load(std::memory_order_relaxed);
+  snapshot.max = m_max.load(std::memory_order_relaxed);
+  return snapshot;
+}
+
+uint64_t HistogramSnapshot::Percentile(double fraction) const {
+  if (count == 0)
+    return 0;
+  const uint64_t rank = std::max<uint64_t>(
+      1, static_cast<uint64_t>(fraction * static_cast<double>(count) + 0.5));
+  uint64_t seen = 0;
+  for (size_t i = 0; i < buckets.size(); ++i) {
+    seen += buckets[i];
+    if (seen >= rank)
+      return std::min(Histogram::BucketUpperBound(i), max);
+  }
+  return max;
+}
+
+double HistogramSnapshot::Mean() const {
+  return count ? static_cast<double>(sum) / static_cast<double>(count) : 0.0;
+}
+
+void AppendJson(std::string &out, const char *key,
+                const HistogramSnapshot &histogram) {
+  char text[256];
+  std::snprintf(text, sizeof(text),
+                "\"%s\":{\"count\":%llu,\"mean\":%.1f,\"p50\":%llu,"
+                "\"p99\":%llu,\"p999\":%llu,\"max\":%llu}",
+                key, static_cast<unsigned long long>(histogram.count),
+                histogram.Mean(),
+                static_cast<unsigned long long>(histogram.Percentile(0.5)),
+                static_cast<unsigned long long>(histogram.Percentile(0.99)),
+                static_cast<unsigned long long>(histogram.Percentile(0.999)),
+                static_cast<unsigned long long>(histogram.max));
+  if (!out.empty() && out.back() != '{')
+    out += ',';
+  out += text;
+}
+
+void AppendJsonInteger(std::string &out, const char *key,
+                       unsigned long long value) {
+  if (!out.empty() && out.back() != '{')
+    out += ',';
+  out += '"';
+  out += key;
+  out += "\":";
+  out += std::to_string(value);
+}
+
+void AppendJsonNumber(std::string &out, const char *key, double value) {
+  char text[64];
+  std::snprintf(text, sizeof(text), "%.3f", value);
+  if (!out.empty() && out.back() != '{')
+    out += ',';
+  out += '"';
+  out += key;
+  out += "\":";
+  out += text;
+}
+
+} // namespace PulseFS::Utils
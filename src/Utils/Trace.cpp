@@ -0,0 +1,204 @@
+#include "PulseFS/Utils/Trace.hpp"
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+namespace PulseFS::Utils::Trace {
+
+namespace {
+
+struct Event {
+  const char *name;
+  const char *argName;
+  uint64_t arg;
+  uint64_t start;
+  uint64_t end;
+};
+
+// One ring slot, guarded as a seqlock: `stamp` is 0 while the owner writes
+// it and then the event's position in the ring plus one. A reader keeps what
+// it copied only if the stamp was the one it wanted before and after.
+struct Slot {
+  std::atomic<uint64_t> stamp = 0;
+  std::atomic<const char *> name = nullptr;
+  std::atomic<const char *> argName = nullptr;
+  std::atomic<uint64_t> arg = 0;
+  std::atomic<uint64_t> start = 0;
+  std::atomic<uint64_t> end = 0;
+};
+
+// Written only by its owning thread; the writer publishes each event by
+// bumping head with release order.
+struct ThreadBuffer {
+  uint32_t tid = 0;
+  std::atomic<const char *> name = nullptr;
+  std::atomic<uint64_t> head = 0;
+  std::unique_ptr<Slot[]> slots = std::make_unique<Slot[]>(kEventsPerThread);
+};
+
+bool ReadSlot(const Slot &slot, uint64_t position, Event &event) {
+  if (slot.stamp.load(std::memory_order_acquire) != position + 1)
+    return false;
+  // Acquire loads pair with the writer's release stores: a value from a
+  // newer write makes its zeroed stamp visible to the check below.
+  event.name = slot.name.load(std::memory_order_acquire);
+  event.argName = slot.argName.load(std::memory_order_acquire);
+  event.arg = slot.arg.load(std::memory_order_acquire);
+  event.start = slot.start.load(std::memory_order_acquire);
+  event.end = slot.end.load(std::memory_order_acquire);
+  return slot.stamp.load(std::memory_order_relaxed) == position + 1;
+}
+
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+};
+
+Registry &GetRegistry() {
+  static Registry registry;
+  return registry;
+}
+
+const std::chrono::steady_clock::time_point g_epoch =
+    std::chrono::steady_clock::now();
+
+// Kept alive by the registry after the thread exits so its spans still flush.
+thread_local std::shared_ptr<ThreadBuffer> t_buffer;
+thread_local const char *t_pendingName = nullptr;
+
+ThreadBuffer &CurrentBuffer() {
+  if (!t_buffer) {
+    auto buffer = std::make_shared<ThreadBuffer>();
+    buffer->name = t_pendingName;
+    Registry &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    buffer->tid = static_cast<uint32_t>(registry.buffers.size() + 1);
+    registry.buffers.push_back(buffer);
+    t_buffer = std::move(buffer);
+  }
+  return *t_buffer;
+}
+
+void AppendEscaped(std::string &out, const char *text) {
+  for (; *text; ++text) {
+    if (*text == '"' || *text == '\\')
+      out += '\\';
+    out += *text;
+  }
+}
+
+} // namespace
+
+namespace Detail {
+
+std::atomic<bool> g_enabled = false;
+
+uint64_t Now() {
+  // Offset by one so that zero can mean "not started".
+  return static_cast<uint64_t>(
+             std::chrono::duration_cast<std::chrono::nanoseconds>(
+                 std::chrono::steady_clock::now() - g_epoch)
+                 .count()) +
+         1;
+}
+
+void Record(const char *name, const char *argName, uint64_t arg,
+            uint64_t start, uint64_t end) {
+  ThreadBuffer &buffer = CurrentBuffer();
+  const uint64_t head = buffer.head.load(std::memory_order_relaxed);
+  Slot &slot = buffer.slots[head % kEventsPerThread];
+  slot.stamp.store(0, std::memory_order_relaxed);
+  slot.name.store(name, std::memory_order_release);
+  slot.argName.store(argName, std::memory_order_release);
+  slot.arg.store(arg, std::memory_order_release);
+  slot.start.store(start, std::memory_order_release);
+  slot.end.store(end, std::memory_order_release);
+  slot.stamp.store(head + 1, std::memory_order_release);
+  buffer.head.store(head + 1, std::memory_order_release);
+}
+
+} // namespace Detail
+
+void Enable(bool enabled) { Detail::g_enabled = enabled; }
+
+void SetThreadName(const char *name) {
+  t_pendingName = name;
+  if (t_buffer)
+    t_buffer->name = name;
+}
+
+bool WriteChromeJson(const std::string &path) {
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    Registry &registry = GetRegistry();
+    std::lock_guard lock(registry.mutex);
+    buffers = registry.buffers;
+  }
+
+  std::FILE *file = std::fopen(path.c_str(), "wb");
+  if (!file)
+    return false;
+
+  std::string out = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+  bool first = true;
+  auto beginEvent = [&] {
+    if (!first)
+      out += ",\n";
+    first = false;
+  };
+
+  char number[96];
+  for (const auto &buffer : buffers) {
+    if (const char *name = buffer->name.load()) {
+      beginEvent();
+      std::snprintf(number, sizeof(number),
+                    "{\"ph\":\"M\",\"pid\":1,\"tid\":%u,", buffer->tid);
+      out += number;
+      out += "\"name\":\"thread_name\",\"args\":{\"name\":\"";
+      AppendEscaped(out, name);
+      out += "\"}}";
+    }
+
+    const uint64_t head = buffer->head.load(std::memory_order_acquire);
+    const uint64_t begin =
+        head > kEventsPerThread ? head - kEventsPerThread : 0;
+
+    Event event;
+    for (uint64_t i = begin; i < head; ++i) {
+      // The owner may be overwriting the oldest slots as we go; those
+      // events are dropped rather than torn.
+      if (!ReadSlot(buffer->slots[i % kEventsPerThread], i, event))
+        continue;
+      beginEvent();
+      std::snprintf(number, sizeof(number),
+                    "{\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,"
+                    "\"dur\":%.3f,",
+                    buffer->tid, static_cast<double>(event.start) / 1e3,
+                    static_cast<double>(event.end - event.start) / 1e3);
+      out += number;
+      out += "\"name\":\"";
+      AppendEscaped(out, event.name);
+      out += '"';
+      if (event.argName) {
+        out += ",\"args\":{\"";
+        AppendEscaped(out, event.argName);
+        out += "\":";
+        out += std::to_string(event.arg);
+        out += '}';
+      }
+      out += '}';
+    }
+
+    if (out.size() > (1u << 20)) {
+      std::fwrite(out.data(), 1, out.size(), file);
+      out.clear();
+    }
+  }
+  out += "]}\n";
+  std::fwrite(out.data(), 1, out.size(), file);
+  return std::fclose(file) == 0;
+}
+
+} // namespace PulseFS::Utils::Trace
@@ -0,0 +1,133 @@
+#include "PulseFS/Utils/WorkStealingPool.hpp"
+#include <utility>
+
+namespace PulseFS::Utils {
+
+namespace {
+
+thread_local const WorkStealingPool *t_pool = nullptr;
+thread_local size_t t_workerIndex = WorkStealingPool::npos;
+
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t threadCount) {
+  if (threadCount == 0) {
+    threadCount = std::max(1u, std::thread::hardware_concurrency());
+  }
+
+  m_queues.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_queues.push_back(std::make_unique<Queue>());
+  }
+  m_threads.reserve(threadCount);
+  for (size_t i = 0; i < threadCount; ++i) {
+    m_threads.emplace_back(&WorkStealingPool::WorkerLoop, this, i);
+  }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  WaitIdle();
+  {
+    std::lock_guard lock(m_stateMutex);
+    m_stopping = true;
+  }
+  m_workAvailable.notify_all();
+  for (auto &thread : m_threads) {
+    thread.join();
+  }
+}
+
+size_t WorkStealingPool::CurrentWorker() const {
+  return t_pool == this ? t_workerIndex : npos;
+}
+
+void WorkStealingPool::Submit(Task task) {
+  size_t target = CurrentWorker();
+  if (target == npos) {
+    target = m_nextQueue.fetch_add(1, std::memory_order_relaxed) %
+             m_queues.size();
+  }
+
+  m_pending.fetch_add(1, std::memory_order_relaxed);
+  {
+    std::lock_guard lock(m_queues[target]->mutex);
+    m_queues[target]->tasks.push_back(std::move(task));
+  }
+  {
+    std::lock_guard lock(m_stateMutex);
+    m_queued.fetch_add(1, std::memory_order_relaxed);
+  }
+  m_workAvailable.notify_one();
+}
+
+void WorkStealingPool::Wait() {
+  WaitIdle();
+  std::exception_ptr error;
+  {
+    std::lock_guard lock(m_stateMutex);
+    error = std::exchange(m_error, nullptr);
+  }
+  if (error)
+    std::rethrow_exception(error);
+}
+
+void WorkStealingPool::WaitIdle() {
+  std::unique_lock lock(m_stateMutex);
+  m_allDone.wait(lock, [this] { return m_pending.load() == 0; });
+}
+
+bool WorkStealingPool::TryTake(size_t index, Task &task) {
+  {
+    Queue &own = *m_queues[index];
+    std::lock_guard lock(own.mutex);
+    if (!own.tasks.empty()) {
+      task = std::move(own.tasks.back());
+      own.tasks.pop_back();
+      return true;
+    }
+  }
+
+  for (size_t offset = 1; offset < m_queues.size(); ++offset) {
+    Queue &victim = *m_queues[(index + offset) % m_queues.size()];
+    std::lock_guard lock(victim.mutex);
+    if (!victim.tasks.empty()) {
+      task = std::move(victim.tasks.front());
+      victim.tasks.pop_front();
+      return true;
+    }
+  }
+  return false;
+}
+
+void WorkStealingPool::WorkerLoop(size_t index) {
+  t_pool = this;
+  t_workerIndex = index;
+
+  while (true) {
+    Task task;
+    if (TryTake(index, task)) {
+      m_queued.fetch_sub(1, std::memory_order_relaxed);
+      try {
+        task();
+      } catch (...) {
+        std::lock_guard lock(m_stateMutex);
+        if (!m_error)
+          m_error = std::current_exception();
+      }
+
+      if (m_pending.fetch_sub(1) == 1) {
+        std::lock_guard lock(m_stateMutex);
+        m_allDone.notify_all();
+      }
+      continue;
+    }
+
+    std::unique_lock lock(m_stateMutex);
+    m_workAvailable.wait(lock,
+                         [this] { return m_stopping || m_queued.load() > 0; });
+    if (m_stopping)
+      return;
+  }
+}
+
+} // namespace PulseFS::Utils
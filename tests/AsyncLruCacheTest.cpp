@@ -0,0 +1,205 @@
+#include "Check.hpp"
+#include "PulseFS/Utils/AsyncLruCache.hpp"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+
+using namespace PulseFS;
+
+namespace {
+
+using Cache = Utils::AsyncLruCache<std::string, std::string>;
+
+// A loader whose calls block until Open, so a test decides when a load is
+// queued, running or done. Keys starting with "bad" fail; "slow" keys run
+// until cancelled.
+class Loader {
+public:
+  Cache::Loader Bind() {
+    return [this](const std::string &key, const std::atomic<bool> &cancelled) {
+      return Load(key, cancelled);
+    };
+  }
+
+  void Open() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_open = true;
+    }
+    m_changed.notify_all();
+  }
+
+  int Calls(const std::string &key) {
+    std::lock_guard lock(m_mutex);
+    return m_calls[key];
+  }
+
+  bool WaitForCalls(const std::string &key, int calls = 1) {
+    std::unique_lock lock(m_mutex);
+    return m_changed.wait_for(lock, std::chrono::seconds(5),
+                              [&] { return m_calls[key] >= calls; });
+  }
+
+private:
+  std::optional<Cache::Loaded> Load(const std::string &key,
+                                    const std::atomic<bool> &cancelled) {
+    std::unique_lock lock(m_mutex);
+    m_calls[key]++;
+    m_changed.notify_all();
+    if (key.starts_with("slow")) {
+      lock.unlock();
+      while (!cancelled)
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return std::nullopt;
+    }
+    m_changed.wait(lock, [&] { return m_open; });
+    if (key.starts_with("bad"))
+      return std::nullopt;
+    return Cache::Loaded{"value of " + key, 100};
+  }
+
+  std::mutex m_mutex;
+  std::condition_variable m_changed;
+  std::map<std::string, int> m_calls;
+  bool m_open = false;
+};
+
+// Pumps until `count` completions have been moved, or gives up after 5s.
+bool PumpUntil(Cache &cache, size_t count) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  size_t moved = 0;
+  while (moved < count) {
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    moved += cache.Pump();
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+  return true;
+}
+
+void FoldsRepeatRequests() {
+  Loader loader;
+  Cache cache(loader.Bind());
+  PULSEFS_CHECK(cache.Get("a") == nullptr);
+  PULSEFS_CHECK(cache.Get("a") == nullptr);
+  loader.Open();
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+  const std::string *value = cache.Get("a");
+  PULSEFS_CHECK(value && *value == "value of a");
+  PULSEFS_CHECK(loader.Calls("a") == 1);
+  PULSEFS_CHECK(cache.Stats().loads == 1);
+}
+
+void CachesFailures() {
+  Loader loader;
+  loader.Open();
+  Cache cache(loader.Bind());
+  cache.Get("bad");
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+  PULSEFS_CHECK(cache.Get("bad") == nullptr);
+  PULSEFS_CHECK(cache.Get("bad") == nullptr);
+  cache.Pump();
+  PULSEFS_CHECK(loader.Calls("bad") == 1);
+  const auto stats = cache.Stats();
+  PULSEFS_CHECK(stats.failures == 1);
+  PULSEFS_CHECK(stats.entries == 1);
+  PULSEFS_CHECK(stats.hits == 2);
+}
+
+void CancelsQueuedLoad() {
+  Loader loader;
+  Cache cache(loader.Bind());
+  cache.Get("a");
+  PULSEFS_CHECK(loader.WaitForCalls("a"));
+  // The only worker is busy with "a", so "b" waits in the queue.
+  cache.Get("b");
+  cache.Cancel("b");
+  loader.Open();
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+  PULSEFS_CHECK(loader.Calls("b") == 0);
+  PULSEFS_CHECK(cache.Stats().cancelled == 1);
+
+  // Not cached as a failure: asking again loads it.
+  PULSEFS_CHECK(cache.Get("b") == nullptr);
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+  PULSEFS_CHECK(cache.Get("b") != nullptr);
+}
+
+void CancelsRunningLoad() {
+  Loader loader;
+  Cache cache(loader.Bind());
+  cache.Get("slow");
+  PULSEFS_CHECK(loader.WaitForCalls("slow"));
+  cache.Cancel("slow");
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+  auto stats = cache.Stats();
+  PULSEFS_CHECK(stats.cancelled == 1);
+  PULSEFS_CHECK(stats.failures == 0);
+  PULSEFS_CHECK(stats.entries == 0);
+
+  // Asked for again, it is loaded again rather than remembered as failed.
+  PULSEFS_CHECK(cache.Get("slow") == nullptr);
+  PULSEFS_CHECK(loader.WaitForCalls("slow", 2));
+  cache.Cancel("slow");
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+}
+
+void DiscardsLoadsFinishingAfterClear() {
+  Loader loader;
+  Cache cache(loader.Bind());
+  cache.Get("a");
+  PULSEFS_CHECK(loader.WaitForCalls("a"));
+  cache.Clear();
+  loader.Open();
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+  PULSEFS_CHECK(cache.Stats().entries == 0);
+  PULSEFS_CHECK(cache.Stats().loads == 0);
+
+  // Clear forgot the request too, so the key can be asked for again.
+  PULSEFS_CHECK(cache.Get("a") == nullptr);
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+  PULSEFS_CHECK(cache.Get("a") != nullptr);
+  PULSEFS_CHECK(loader.Calls("a") == 2);
+}
+
+void EvictsLeastRecentlyUsed() {
+  Loader loader;
+  loader.Open();
+  Utils::AsyncLruCacheOptions options;
+  options.budgetBytes = 250;
+  Cache cache(loader.Bind(), options);
+  for (const char *key : {"a", "b"}) {
+    cache.Get(key);
+    PULSEFS_CHECK(PumpUntil(cache, 1));
+  }
+  // Touching "a" leaves "b" the oldest when "c" pushes past the budget.
+  PULSEFS_CHECK(cache.Get("a") != nullptr);
+  cache.Get("c");
+  PULSEFS_CHECK(PumpUntil(cache, 1));
+
+  const auto stats = cache.Stats();
+  PULSEFS_CHECK(stats.entries == 2);
+  PULSEFS_CHECK(stats.bytes == 200);
+  PULSEFS_CHECK(stats.evictions == 1);
+  PULSEFS_CHECK(cache.Get("a") != nullptr);
+  PULSEFS_CHECK(cache.Get("c") != nullptr);
+  PULSEFS_CHECK(cache.Get("b") == nullptr);
+}
+
+} // namespace
+
+int main() {
+  FoldsRepeatRequests();
+  CachesFailures();
+  CancelsQueuedLoad();
+  CancelsRunningLoad();
+  DiscardsLoadsFinishingAfterClear();
+  EvictsLeastRecentlyUsed();
+  return Tests::Failures() == 0 ? 0 : 1;
+}
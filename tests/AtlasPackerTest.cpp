@@ -0,0 +1,135 @@
+#include "Check.hpp"
+#include "PulseFS/Utils/AtlasPacker.hpp"
+#include <optional>
+#include <vector>
+
+using namespace PulseFS;
+
+namespace {
+
+// Fills a 32px page with `count` cells of `side`, all allocated this frame.
+std::vector<Utils::AtlasSlot> Fill(Utils::AtlasPacker &packer, uint32_t side,
+                                   int count, bool pinned = false) {
+  std::vector<Utils::AtlasSlot> slots;
+  for (int i = 0; i < count; ++i) {
+    auto slot = packer.Allocate(side, side, pinned);
+    PULSEFS_CHECK(slot.has_value());
+    if (slot)
+      slots.push_back(*slot);
+  }
+  return slots;
+}
+
+void ReusesReleasedCell() {
+  Utils::AtlasPacker packer(64, 1);
+  const auto first = packer.Allocate(16, 16);
+  PULSEFS_CHECK(first && packer.Valid(*first));
+  packer.Release(*first);
+  PULSEFS_CHECK(!packer.Valid(*first));
+
+  // Anything in the same class lands in the hole.
+  const auto second = packer.Allocate(10, 12);
+  PULSEFS_CHECK(second && packer.Valid(*second));
+  PULSEFS_CHECK(second->cell == first->cell);
+  PULSEFS_CHECK(second->x == first->x && second->y == first->y);
+  PULSEFS_CHECK(second->width == 10 && second->height == 12);
+  PULSEFS_CHECK(packer.Evictions() == 0);
+}
+
+void ProtectsCellsUsedThisFrame() {
+  Utils::AtlasPacker packer(32, 1);
+  const auto slots = Fill(packer, 16, 4);
+  PULSEFS_CHECK(!packer.Allocate(16, 16));
+
+  packer.NextFrame();
+  for (int i = 0; i < 3; ++i)
+    packer.Touch(slots[i]);
+  const auto taken = packer.Allocate(16, 16);
+  PULSEFS_CHECK(taken && taken->cell == slots[3].cell);
+  PULSEFS_CHECK(!packer.Valid(slots[3]));
+  for (int i = 0; i < 3; ++i)
+    PULSEFS_CHECK(packer.Valid(slots[i]));
+  PULSEFS_CHECK(packer.Evictions() == 1);
+  PULSEFS_CHECK(!packer.Allocate(16, 16));
+}
+
+void ProtectsPinnedCells() {
+  Utils::AtlasPacker packer(32, 1);
+  const auto slots = Fill(packer, 16, 4, true);
+  packer.NextFrame();
+  packer.NextFrame();
+  PULSEFS_CHECK(!packer.Allocate(16, 16));
+  PULSEFS_CHECK(!packer.Allocate(32, 32));
+
+  packer.Release(slots[2]);
+  const auto taken = packer.Allocate(16, 16);
+  PULSEFS_CHECK(taken && taken->cell == slots[2].cell);
+  PULSEFS_CHECK(packer.Evictions() == 0);
+}
+
+// A stale slot keeps its cell index, but its tag no longer matches, so it
+// cannot touch or free the cell's new owner.
+void InvalidatesStaleTags() {
+  Utils::AtlasPacker packer(16, 1);
+  const auto old = packer.Allocate(16, 16);
+  packer.NextFrame();
+  const auto current = packer.Allocate(16, 16);
+  PULSEFS_CHECK(old && current && old->cell == current->cell);
+  PULSEFS_CHECK(old->tag != current->tag);
+  PULSEFS_CHECK(!packer.Valid(*old));
+
+  packer.Release(*old);
+  PULSEFS_CHECK(packer.Valid(*current));
+  PULSEFS_CHECK(!packer.Allocate(16, 16));
+
+  // A default slot was never allocated.
+  PULSEFS_CHECK(!packer.Valid(Utils::AtlasSlot{}));
+}
+
+void ReclaimsShelvesForAnotherClass() {
+  Utils::AtlasPacker packer(32, 1);
+  // Four 8px shelves of four cells fill the page.
+  const auto small = Fill(packer, 8, 16);
+  PULSEFS_CHECK(!packer.Allocate(16, 16));
+
+  packer.NextFrame();
+  packer.Touch(small[0]);
+  // The first shelf is in use this frame; the two below it are cleared.
+  const auto medium = packer.Allocate(16, 16);
+  PULSEFS_CHECK(medium && medium->y == 8);
+  PULSEFS_CHECK(packer.Valid(small[0]));
+  int valid = 0;
+  for (const auto &slot : small)
+    valid += packer.Valid(slot);
+  PULSEFS_CHECK(valid == 8);
+  PULSEFS_CHECK(packer.Evictions() == 8);
+  // The rest of the new shelf is free for the same class.
+  PULSEFS_CHECK(packer.Allocate(16, 16).has_value());
+  // Only a whole idle page fits 32px, and the first shelf is busy.
+  PULSEFS_CHECK(!packer.Allocate(32, 32));
+
+  packer.NextFrame();
+  const auto large = packer.Allocate(32, 32);
+  PULSEFS_CHECK(large && large->y == 0);
+  for (const auto &slot : small)
+    PULSEFS_CHECK(!packer.Valid(slot));
+  PULSEFS_CHECK(!packer.Valid(*medium));
+
+  // Back down again, reusing the retired cells.
+  packer.NextFrame();
+  const auto again = Fill(packer, 8, 16);
+  PULSEFS_CHECK(!packer.Valid(*large));
+  for (const auto &slot : again)
+    PULSEFS_CHECK(packer.Valid(slot));
+}
+
+} // namespace
+
+int main() {
+  ReusesReleasedCell();
+  ProtectsCellsUsedThisFrame();
+  ProtectsPinnedCells();
+  InvalidatesStaleTags();
+  ReclaimsShelvesForAnotherClass();
+  return Tests::Failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,22 @@
+#pragma once
+
+#include <cstdio>
+
+namespace PulseFS::Tests {
+
+inline int &Failures() {
+  static int failures = 0;
+  return failures;
+}
+
+} // namespace PulseFS::Tests
+
+// Records a failure and carries on, so one run reports every broken check.
+#define PULSEFS_CHECK(condition)                                               \
+  do {                                                                         \
+    if (!(condition)) {                                                        \
+      std::fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__,    \
+                   #condition);                                                \
+      ++PulseFS::Tests::Failures();                                            \
+    }                                                                          \
+  } while (0)
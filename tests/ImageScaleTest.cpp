@@ -0,0 +1,141 @@
+#include "Check.hpp"
+#include "PulseFS/Utils/ImageScale.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <utility>
+#include <vector>
+
+using namespace PulseFS;
+
+namespace {
+
+using Size = std::pair<uint32_t, uint32_t>;
+
+std::vector<uint8_t> Pattern(uint32_t width, uint32_t height) {
+  std::vector<uint8_t> pixels(static_cast<size_t>(width) * height * 4);
+  for (size_t i = 0; i < pixels.size(); ++i)
+    pixels[i] = static_cast<uint8_t>((i * 37 + i / 7 * 11) % 256);
+  return pixels;
+}
+
+std::vector<uint8_t> Scale(const std::vector<uint8_t> &src, uint32_t srcWidth,
+                           uint32_t srcHeight, uint32_t dstWidth,
+                           uint32_t dstHeight) {
+  return Utils::DownscaleBgra(src.data(), srcWidth, srcHeight,
+                              static_cast<size_t>(srcWidth) * 4, dstWidth,
+                              dstHeight);
+}
+
+// Straight area average in doubles, for the scaler to be checked against.
+std::vector<uint8_t> Reference(const std::vector<uint8_t> &src,
+                               uint32_t srcWidth, uint32_t srcHeight,
+                               uint32_t dstWidth, uint32_t dstHeight) {
+  const double scaleX = static_cast<double>(srcWidth) / dstWidth;
+  const double scaleY = static_cast<double>(srcHeight) / dstHeight;
+  auto overlap = [](double lo, double hi, uint32_t i) {
+    return std::max(0.0, std::min<double>(hi, i + 1) - std::max<double>(lo, i));
+  };
+  std::vector<uint8_t> out(static_cast<size_t>(dstWidth) * dstHeight * 4);
+  for (uint32_t y = 0; y < dstHeight; ++y) {
+    for (uint32_t x = 0; x < dstWidth; ++x) {
+      double sum[4] = {};
+      for (uint32_t sy = 0; sy < srcHeight; ++sy) {
+        const double wy = overlap(y * scaleY, (y + 1) * scaleY, sy);
+        for (uint32_t sx = 0; wy > 0 && sx < srcWidth; ++sx) {
+          const double w = wy * overlap(x * scaleX, (x + 1) * scaleX, sx);
+          for (int c = 0; c < 4; ++c)
+            sum[c] += w * src[(static_cast<size_t>(sy) * srcWidth + sx) * 4 + c];
+        }
+      }
+      for (int c = 0; c < 4; ++c)
+        out[(static_cast<size_t>(y) * dstWidth + x) * 4 + c] =
+            static_cast<uint8_t>(std::lround(sum[c] / (scaleX * scaleY)));
+    }
+  }
+  return out;
+}
+
+int MaxDifference(const std::vector<uint8_t> &a, const std::vector<uint8_t> &b) {
+  if (a.size() != b.size())
+    return 256;
+  int worst = 0;
+  for (size_t i = 0; i < a.size(); ++i)
+    worst = std::max(worst, std::abs(int(a[i]) - int(b[i])));
+  return worst;
+}
+
+void FitsWithin() {
+  PULSEFS_CHECK(Utils::FitWithin(100, 50, 256) == Size(100, 50));
+  PULSEFS_CHECK(Utils::FitWithin(256, 256, 256) == Size(256, 256));
+  PULSEFS_CHECK(Utils::FitWithin(1000, 333, 256) == Size(256, 85));
+  PULSEFS_CHECK(Utils::FitWithin(333, 1000, 256) == Size(85, 256));
+  // Thin images keep at least one pixel across.
+  PULSEFS_CHECK(Utils::FitWithin(5000, 1, 64) == Size(64, 1));
+  PULSEFS_CHECK(Utils::FitWithin(1, 5000, 64) == Size(1, 64));
+  PULSEFS_CHECK(Utils::FitWithin(0, 0, 0) == Size(1, 1));
+}
+
+void KeepsIdentitySize() {
+  const auto src = Pattern(7, 5);
+  PULSEFS_CHECK(Scale(src, 7, 5, 7, 5) == src);
+  // Never upscales.
+  Utils::BgraDownscaler scaler(7, 5, 20, 20);
+  PULSEFS_CHECK(scaler.Width() == 7 && scaler.Height() == 5);
+}
+
+void MatchesReference() {
+  // Non-integer ratios in both directions, and a wide range of them.
+  const struct {
+    uint32_t srcWidth, srcHeight, dstWidth, dstHeight;
+  } cases[] = {{13, 7, 5, 3},  {10, 10, 3, 7}, {97, 61, 40, 25},
+               {8, 8, 4, 4},   {301, 7, 16, 2}, {5, 9, 5, 4}};
+  for (const auto &c : cases) {
+    const auto src = Pattern(c.srcWidth, c.srcHeight);
+    const auto scaled = Scale(src, c.srcWidth, c.srcHeight, c.dstWidth,
+                              c.dstHeight);
+    const auto expected = Reference(src, c.srcWidth, c.srcHeight, c.dstWidth,
+                                    c.dstHeight);
+    PULSEFS_CHECK(MaxDifference(scaled, expected) <= 1);
+  }
+}
+
+void ScalesToOnePixel() {
+  const auto src = Pattern(33, 17);
+  const auto scaled = Scale(src, 33, 17, 1, 1);
+  PULSEFS_CHECK(scaled.size() == 4);
+  PULSEFS_CHECK(MaxDifference(scaled, Reference(src, 33, 17, 1, 1)) <= 1);
+}
+
+void KeepsUniformImagesUniform() {
+  const uint8_t pixel[4] = {200, 17, 255, 0};
+  std::vector<uint8_t> src;
+  for (int i = 0; i < 123 * 77; ++i)
+    src.insert(src.end(), pixel, pixel + 4);
+  for (Size dst : {Size(1, 1), Size(10, 9), Size(64, 40), Size(122, 76)}) {
+    const auto scaled = Scale(src, 123, 77, dst.first, dst.second);
+    bool uniform = !scaled.empty();
+    for (size_t i = 0; i < scaled.size(); ++i)
+      uniform &= scaled[i] == pixel[i % 4];
+    PULSEFS_CHECK(uniform);
+  }
+}
+
+void AveragesChecker() {
+  const std::vector<uint8_t> src = {0,   0,   0,   0,   255, 255, 255, 255,
+                                    255, 255, 255, 255, 0,   0,   0,   0};
+  PULSEFS_CHECK(Scale(src, 2, 2, 1, 1) == std::vector<uint8_t>(4, 128));
+}
+
+} // namespace
+
+int main() {
+  FitsWithin();
+  KeepsIdentitySize();
+  MatchesReference();
+  ScalesToOnePixel();
+  KeepsUniformImagesUniform();
+  AveragesChecker();
+  return Tests::Failures() == 0 ? 0 : 1;
+}
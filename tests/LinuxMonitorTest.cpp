@@ -0,0 +1,111 @@
+#include "Check.hpp"
+#include "PulseFS/Core/LinuxMonitor.hpp"
+#include "PulseFS/Core/LinuxScanner.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+
+using namespace PulseFS;
+
+namespace {
+
+unsigned long long Inode(const std::string &path) {
+  struct stat st;
+  return ::lstat(path.c_str(), &st) == 0 ? st.st_ino : 0;
+}
+
+void Touch(const std::string &path) {
+  int fd = ::open(path.c_str(), O_CREAT | O_WRONLY | O_CLOEXEC, 0644);
+  if (fd >= 0)
+    ::close(fd);
+}
+
+template <typename Condition> bool WaitFor(Condition condition) {
+  const auto deadline =
+      std::chrono::steady_clock::now() + std::chrono::seconds(5);
+  while (!condition()) {
+    if (std::chrono::steady_clock::now() > deadline)
+      return false;
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+  }
+  return true;
+}
+
+// `mv a/x b/x; rmdir a` lands in one batch. Removing a's subtree must not
+// take x, which the batch moved, or drop x's watch.
+void MoveOutThenRemoveParent(const std::string &root) {
+  const std::string a = root + "/a", b = root + "/b", x = a + "/x";
+  ::mkdir(a.c_str(), 0755);
+  ::mkdir(b.c_str(), 0755);
+  ::mkdir(x.c_str(), 0755);
+  Touch(x + "/kept.txt");
+  const unsigned long long xId = Inode(x), keptId = Inode(x + "/kept.txt");
+
+  Engine::SearchIndex index;
+  Core::LinuxMonitor monitor(index);
+  PULSEFS_CHECK(monitor.Open(root));
+  Core::LinuxScanOptions options;
+  options.onDirectory = monitor.DirectoryObserver();
+  Core::LinuxScanner::Enumerate(index, root, options);
+  monitor.Start();
+
+  const unsigned long long aId = Inode(a);
+  PULSEFS_CHECK(::rename(x.c_str(), (b + "/x").c_str()) == 0);
+  PULSEFS_CHECK(::rmdir(a.c_str()) == 0);
+
+  PULSEFS_CHECK(WaitFor([&] { return !index.Contains(aId); }));
+  PULSEFS_CHECK(index.Contains(xId));
+  PULSEFS_CHECK(index.Contains(keptId));
+  PULSEFS_CHECK(index.GetFullPath(keptId) ==
+                Utils::WideFromUtf8(b + "/x/kept.txt"));
+
+  // x is still watched in its new place.
+  Touch(b + "/x/new.txt");
+  const unsigned long long newId = Inode(b + "/x/new.txt");
+  PULSEFS_CHECK(WaitFor([&] { return index.Contains(newId); }));
+
+  // The root resolves to its own path, and events directly under it land.
+  PULSEFS_CHECK(index.GetFullPath(Inode(root)) == Utils::WideFromUtf8(root));
+  Touch(root + "/top.txt");
+  const unsigned long long topId = Inode(root + "/top.txt");
+  PULSEFS_CHECK(WaitFor([&] { return index.Contains(topId); }));
+  PULSEFS_CHECK(index.GetFullPath(topId) ==
+                Utils::WideFromUtf8(root + "/top.txt"));
+
+  // Directories made while monitoring are walked and watched, one after
+  // another on the monitor's scan pool.
+  for (const char *name : {"/c", "/d"}) {
+    const std::string made = root + name;
+    ::mkdir(made.c_str(), 0755);
+    ::mkdir((made + "/inner").c_str(), 0755);
+    Touch(made + "/inner/deep.txt");
+    const unsigned long long deepId = Inode(made + "/inner/deep.txt");
+    PULSEFS_CHECK(WaitFor([&] { return index.Contains(deepId); }));
+    Touch(made + "/inner/later.txt");
+    const unsigned long long laterId = Inode(made + "/inner/later.txt");
+    PULSEFS_CHECK(WaitFor([&] { return index.Contains(laterId); }));
+  }
+  monitor.Stop();
+}
+
+} // namespace
+
+int main() {
+  char pattern[] = "/tmp/pulsefs-monitor-XXXXXX";
+  const char *root = ::mkdtemp(pattern);
+  if (!root) {
+    std::perror("mkdtemp");
+    return 1;
+  }
+  MoveOutThenRemoveParent(root);
+  std::filesystem::remove_all(root);
+  return Tests::Failures() == 0 ? 0 : 1;
+}
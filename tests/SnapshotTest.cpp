@@ -0,0 +1,102 @@
+#include "Check.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include <cstdint>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+
+using namespace PulseFS;
+
+namespace {
+
+// Header: magic, version, scheme, separator, then the root prefix.
+constexpr size_t kSchemeOffset = 8;
+constexpr size_t kPrefixLengthOffset = 16;
+
+std::vector<char> ReadFile(const std::string &path) {
+  std::ifstream in(path, std::ios::binary);
+  return {std::istreambuf_iterator<char>(in), {}};
+}
+
+void WriteFile(const std::string &path, const std::vector<char> &bytes) {
+  std::ofstream out(path, std::ios::binary | std::ios::trunc);
+  out.write(bytes.data(), static_cast<std::streamsize>(bytes.size()));
+}
+
+template <typename T>
+void Patch(std::vector<char> &bytes, size_t offset, T value) {
+  std::memcpy(bytes.data() + offset, &value, sizeof(value));
+}
+
+// Loads `bytes` into an index holding one entry; a rejected snapshot must
+// leave that entry alone.
+bool Load(const std::string &path, const std::vector<char> &bytes) {
+  WriteFile(path, bytes);
+  Engine::SearchIndex index;
+  index.Insert({L"kept", 1, 1, Engine::kAttributeDirectory, true});
+  const bool loaded = index.LoadSnapshot(path);
+  if (!loaded)
+    PULSEFS_CHECK(index.Count() == 1 && index.Contains(1));
+  return loaded;
+}
+
+} // namespace
+
+int main() {
+  const std::string directory =
+      (std::filesystem::temp_directory_path() / "pulsefs-snapshot-test")
+          .string();
+  std::filesystem::create_directories(directory);
+  const std::string saved = directory + "/saved.snap";
+  const std::string damaged = directory + "/damaged.snap";
+
+  Engine::SearchIndex index;
+  index.Insert({L"root", 5, 5, Engine::kAttributeDirectory, true});
+  for (unsigned long long id = 100; id < 200; ++id)
+    index.Insert({L"file_" + std::to_wstring(id) + L".txt", id, 5,
+                  Engine::kAttributeArchive, true, id * 10, 0});
+  PULSEFS_CHECK(index.SaveSnapshot(saved));
+  const std::vector<char> bytes = ReadFile(saved);
+
+  PULSEFS_CHECK(Load(damaged, bytes));
+  PULSEFS_CHECK(!Load(damaged, {}));
+
+  // Cut anywhere, including inside the header and inside a record.
+  for (size_t length = 0; length < bytes.size(); length += 7)
+    PULSEFS_CHECK(
+        !Load(damaged, std::vector<char>(bytes.begin(), bytes.begin() + length)));
+
+  uint32_t prefixLength = 0;
+  std::memcpy(&prefixLength, bytes.data() + kPrefixLengthOffset,
+              sizeof(prefixLength));
+  const size_t countOffset =
+      kPrefixLengthOffset + sizeof(uint32_t) + prefixLength * sizeof(char16_t);
+  const size_t firstNameLengthOffset = countOffset + sizeof(uint64_t) + 36;
+
+  std::vector<char> corrupt = bytes;
+  Patch<uint32_t>(corrupt, kSchemeOffset, 7);
+  PULSEFS_CHECK(!Load(damaged, corrupt));
+
+  corrupt = bytes;
+  Patch<uint32_t>(corrupt, kPrefixLengthOffset, 0xFFFFFFFFu);
+  PULSEFS_CHECK(!Load(damaged, corrupt));
+
+  corrupt = bytes;
+  Patch<uint64_t>(corrupt, countOffset, ~uint64_t(0));
+  PULSEFS_CHECK(!Load(damaged, corrupt));
+
+  corrupt = bytes;
+  Patch<uint64_t>(corrupt, countOffset, uint64_t(1) << 40);
+  PULSEFS_CHECK(!Load(damaged, corrupt));
+
+  corrupt = bytes;
+  Patch<uint32_t>(corrupt, firstNameLengthOffset, 0x7FFFFFFFu);
+  PULSEFS_CHECK(!Load(damaged, corrupt));
+
+  std::filesystem::remove_all(directory);
+  return Tests::Failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,182 @@
+#include "Check.hpp"
+#include "PulseFS/Core/JournalSource.hpp"
+#include "PulseFS/Core/UsnBatchDecoder.hpp"
+#include "PulseFS/Core/UsnMonitor.hpp"
+#include "PulseFS/Core/UsnRecord.hpp"
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include <memory>
+#include <vector>
+
+using namespace PulseFS;
+
+namespace {
+
+constexpr unsigned long long kRoot = 5;
+constexpr unsigned long long kFile = 100;
+
+std::vector<char> Buffer(std::initializer_list<uint32_t> reasons) {
+  std::vector<char> buffer;
+  for (uint32_t reason : reasons) {
+    Core::Usn::RecordV2 record{};
+    record.FileReferenceNumber = kFile;
+    record.ParentFileReferenceNumber = kRoot;
+    record.Reason = reason;
+    record.FileAttributes = Engine::kAttributeArchive;
+    Core::Usn::AppendRecordV2(buffer, record, u"notes.txt");
+  }
+  return buffer;
+}
+
+void Apply(Engine::SearchIndex &index, Core::UsnBatchDecoder &decoder,
+           const std::vector<char> &buffer) {
+  decoder.Decode(buffer.data(), buffer.size());
+  index.ApplyBatch(decoder.TakeBatch());
+}
+
+void SeedRoot(Engine::SearchIndex &index) {
+  index.Insert({L".", kRoot, kRoot, Engine::kAttributeDirectory, true});
+}
+
+void CreateAndDeleteInOneBuffer() {
+  Engine::SearchIndex index;
+  SeedRoot(index);
+  Core::UsnBatchDecoder decoder;
+  using namespace Core::Usn;
+  Apply(index, decoder,
+        Buffer({kReasonFileCreate,
+                kReasonFileCreate | kReasonFileDelete | kReasonClose}));
+  PULSEFS_CHECK(!index.Contains(kFile));
+  PULSEFS_CHECK(index.Count() == 1);
+}
+
+// The reason flags still carry CREATE when the delete arrives, although the
+// create was applied with the previous buffer.
+void CreateThenDeleteInNextBuffer() {
+  Engine::SearchIndex index;
+  SeedRoot(index);
+  Core::UsnBatchDecoder decoder;
+  using namespace Core::Usn;
+  Apply(index, decoder,
+        Buffer({kReasonFileCreate, kReasonFileCreate | kReasonDataExtend}));
+  PULSEFS_CHECK(index.Contains(kFile));
+  Apply(index, decoder,
+        Buffer({kReasonFileCreate | kReasonDataExtend | kReasonFileDelete |
+                kReasonClose}));
+  PULSEFS_CHECK(!index.Contains(kFile));
+  PULSEFS_CHECK(index.Count() == 1);
+}
+
+std::vector<unsigned long long> Written(Core::UsnBatchDecoder &decoder,
+                                        const std::vector<char> &buffer) {
+  decoder.Decode(buffer.data(), buffer.size());
+  std::vector<unsigned long long> written;
+  decoder.TakeBatch(&written);
+  return written;
+}
+
+// The journal has no sizes or times, so every file it says was created or
+// written has to be read again.
+void ReportsWrittenFiles() {
+  Core::UsnBatchDecoder decoder;
+  using namespace Core::Usn;
+  using Ids = std::vector<unsigned long long>;
+  PULSEFS_CHECK(Written(decoder, Buffer({kReasonFileCreate})) == Ids{kFile});
+  PULSEFS_CHECK(Written(decoder, Buffer({kReasonDataOverwrite})) ==
+                Ids{kFile});
+  PULSEFS_CHECK(Written(decoder, Buffer({kReasonDataTruncation |
+                                         kReasonClose})) == Ids{kFile});
+  PULSEFS_CHECK(Written(decoder, Buffer({kReasonRenameNewName})).empty());
+  PULSEFS_CHECK(Written(decoder, Buffer({kReasonBasicInfoChange})).empty());
+  PULSEFS_CHECK(
+      Written(decoder, Buffer({kReasonDataExtend,
+                               kReasonDataExtend | kReasonFileDelete}))
+          .empty());
+}
+
+// Replays a fixed list of buffers, and answers metadata reads with a fixed
+// size, like a volume would after the write.
+class ScriptedSource : public Core::JournalSource {
+public:
+  explicit ScriptedSource(std::vector<std::vector<char>> buffers)
+      : m_buffers(std::move(buffers)) {}
+
+  Core::JournalRead Read(std::vector<char> &buffer) override {
+    if (m_next == m_buffers.size())
+      return Core::JournalRead::Finished;
+    buffer.assign(sizeof(long long), 0);
+    buffer.insert(buffer.end(), m_buffers[m_next].begin(),
+                  m_buffers[m_next].end());
+    ++m_next;
+    return Core::JournalRead::Data;
+  }
+
+  bool ReadMetadata(unsigned long long id, Engine::FileEntry &entry) override {
+    entry.size = id == kFile ? 1234 : 0;
+    entry.lastWriteTime = Engine::FileTimeFromUnix(1700000000, 0);
+    return true;
+  }
+
+private:
+  std::vector<std::vector<char>> m_buffers;
+  size_t m_next = 0;
+};
+
+void MonitorReadsMetadataOfWrittenFiles() {
+  Engine::SearchIndex index;
+  SeedRoot(index);
+  using namespace Core::Usn;
+  std::vector<std::vector<char>> buffers;
+  buffers.push_back(Buffer({kReasonFileCreate,
+                            kReasonFileCreate | kReasonDataExtend |
+                                kReasonClose}));
+
+  Core::UsnMonitor monitor(index);
+  monitor.Start(std::make_unique<ScriptedSource>(std::move(buffers)));
+  monitor.Wait();
+
+  PULSEFS_CHECK(index.Contains(kFile));
+  const auto totals = index.GetFolderTotals(kRoot);
+  PULSEFS_CHECK(totals && totals->bytes == 1234);
+  const auto children = index.GetChildren(kRoot);
+  PULSEFS_CHECK(children.size() == 1 &&
+                children[0].lastWriteTime ==
+                    Engine::FileTimeFromUnix(1700000000, 0));
+}
+
+// Replays churn whose sequences straddle buffers; the index must end up
+// holding exactly the seeded directories and the files still alive.
+void SplitChurnLeavesOnlyLiveFiles(bool split) {
+  Core::SyntheticChurnOptions options;
+  options.seed = 3;
+  options.directories = 50;
+  options.buffers = 400;
+  options.bufferSize = 4096;
+  options.splitSequences = split;
+
+  Core::SyntheticJournalSource source(options);
+  Engine::SearchIndex index;
+  const auto initial = source.InitialEntries();
+  for (const auto &entry : initial)
+    index.Insert(entry);
+
+  Core::UsnBatchDecoder decoder;
+  std::vector<char> buffer;
+  while (source.Read(buffer) == Core::JournalRead::Data)
+    Apply(index, decoder,
+          std::vector<char>(buffer.begin() + sizeof(long long), buffer.end()));
+
+  PULSEFS_CHECK(index.Count() == initial.size() + source.LiveFileCount());
+}
+
+} // namespace
+
+int main() {
+  CreateAndDeleteInOneBuffer();
+  CreateThenDeleteInNextBuffer();
+  ReportsWrittenFiles();
+  MonitorReadsMetadataOfWrittenFiles();
+  SplitChurnLeavesOnlyLiveFiles(false);
+  SplitChurnLeavesOnlyLiveFiles(true);
+  return Tests::Failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,55 @@
+#include "Check.hpp"
+#include "PulseFS/Utils/WorkStealingPool.hpp"
+#include <atomic>
+#include <stdexcept>
+#include <string>
+
+using namespace PulseFS;
+
+namespace {
+
+bool WaitThrows(Utils::WorkStealingPool &pool, std::string &message) {
+  try {
+    pool.Wait();
+  } catch (const std::runtime_error &e) {
+    message = e.what();
+    return true;
+  }
+  return false;
+}
+
+// A failing task surfaces from Wait, and the rest of the work still runs.
+void RethrowsFromWait() {
+  Utils::WorkStealingPool pool(4);
+  std::atomic<int> ran = 0;
+  for (int i = 0; i < 100; ++i) {
+    pool.Submit([&, i] {
+      if (i == 10)
+        throw std::runtime_error("task failed");
+      // Tasks that fan out keep going too.
+      pool.Submit([&] { ran++; });
+    });
+  }
+  std::string message;
+  PULSEFS_CHECK(WaitThrows(pool, message));
+  PULSEFS_CHECK(message == "task failed");
+  PULSEFS_CHECK(ran == 99);
+
+  // Reported once; the pool is usable again.
+  pool.Submit([&] { ran++; });
+  PULSEFS_CHECK(!WaitThrows(pool, message));
+  PULSEFS_CHECK(ran == 100);
+}
+
+void DestructorSwallowsUnwaitedError() {
+  Utils::WorkStealingPool pool(2);
+  pool.Submit([] { throw std::runtime_error("never waited for"); });
+}
+
+} // namespace
+
+int main() {
+  RethrowsFromWait();
+  DestructorSwallowsUnwaitedError();
+  return Tests::Failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,414 @@
+#include "PulseFS/Engine/FileAttributes.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include "PulseFS/Ipc/QueryClient.hpp"
+#include "PulseFS/Ipc/QueryServer.hpp"
+#include "PulseFS/Utils/Trace.hpp"
+#include "PulseFS/Utils/Unicode.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <exception>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef _WIN32
+#include "PulseFS/Core/MftScanner.hpp"
+#else
+#include "PulseFS/Core/LinuxMetadataCollector.hpp"
+#include "PulseFS/Core/LinuxScanner.hpp"
+#endif
+
+using namespace PulseFS;
+
+namespace {
+
+struct Options {
+  std::string scanRoot;
+  std::string loadPath;
+  std::string savePath;
+  std::string tracePath;
+  bool metadata = false;
+  bool progress = false;
+  size_t threads = 0;
+  size_t limit = 20;
+  size_t repeat = 1;
+  size_t largest = 0;
+  bool quiet = false;
+  bool serve = false;
+  bool connect = false;
+  bool stats = false;
+  Engine::AttributeFilter filter;
+  std::string endpoint = Ipc::DefaultEndpoint();
+  std::vector<std::string> queries;
+};
+
+std::atomic<bool> g_interrupted = false;
+
+void PrintUsage() {
+  std::printf(
+      "usage: pulsefs-cli (--scan <root> | --load <snapshot>) [--save <file>]\n"
+      "                   [--metadata] [--threads <n>] [--progress]\n"
+      "                   [--serve]\n"
+      "                   [--trace <file.json>]\n"
+      "                   [--limit <n>] [--repeat <n>] [--quiet]\n"
+      "                   [--folders | --files] [--no-hidden] [--no-system]\n"
+      "                   [--largest <n>] [query...]\n"
+      "       pulsefs-cli --connect [--limit <n>] [--repeat <n>] [--quiet]\n"
+      "                   [--stats] [query...]\n"
+      "\n"
+      "On Windows <root> is a volume such as \\\\.\\C: and is read via the MFT.\n"
+      "--serve keeps the index resident and answers --connect clients on\n"
+      "--endpoint <path> (default %s); --stats prints the server's metrics\n"
+      "as JSON after the queries.\n"
+      "--folders, --files, --no-hidden and --no-system filter local\n"
+      "queries by attribute.\n"
+      "--largest lists the <n> folders holding the most bytes, at any depth\n"
+      "below the root, from the index's folder totals.\n"
+      "--progress reports the scan's progress on stderr every second.\n"
+      "--trace writes Chrome trace JSON of the scan, searches and serving on\n"
+      "exit.\n"
+      "Results go to stdout; timings go to stderr as key/value lines.\n",
+      Ipc::DefaultEndpoint().c_str());
+}
+
+bool ParseArgs(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    if (arg[0] != '-' || arg[1] != '-') {
+      options.queries.emplace_back(arg);
+      continue;
+    }
+    if (std::strcmp(arg, "--metadata") == 0) {
+      options.metadata = true;
+      continue;
+    }
+    if (std::strcmp(arg, "--progress") == 0) {
+      options.progress = true;
+      continue;
+    }
+    if (std::strcmp(arg, "--quiet") == 0) {
+      options.quiet = true;
+      continue;
+    }
+    if (std::strcmp(arg, "--serve") == 0) {
+      options.serve = true;
+      continue;
+    }
+    if (std::strcmp(arg, "--connect") == 0) {
+      options.connect = true;
+      continue;
+    }
+    if (std::strcmp(arg, "--stats") == 0) {
+      options.stats = true;
+      continue;
+    }
+    if (std::strcmp(arg, "--folders") == 0) {
+      options.filter.require |= Engine::kAttributeDirectory;
+      continue;
+    }
+    if (std::strcmp(arg, "--files") == 0) {
+      options.filter.exclude |= Engine::kAttributeDirectory;
+      continue;
+    }
+    if (std::strcmp(arg, "--no-hidden") == 0) {
+      options.filter.exclude |= Engine::kAttributeHidden;
+      continue;
+    }
+    if (std::strcmp(arg, "--no-system") == 0) {
+      options.filter.exclude |= Engine::kAttributeSystem;
+      continue;
+    }
+
+    const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+    if (!value)
+      return false;
+    ++i;
+
+    if (std::strcmp(arg, "--scan") == 0) {
+      options.scanRoot = value;
+    } else if (std::strcmp(arg, "--load") == 0) {
+      options.loadPath = value;
+    } else if (std::strcmp(arg, "--save") == 0) {
+      options.savePath = value;
+    } else if (std::strcmp(arg, "--trace") == 0) {
+      options.tracePath = value;
+    } else if (std::strcmp(arg, "--endpoint") == 0) {
+      options.endpoint = value;
+    } else if (std::strcmp(arg, "--threads") == 0) {
+      options.threads = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--limit") == 0) {
+      options.limit = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--repeat") == 0) {
+      options.repeat = std::max<size_t>(1, std::strtoull(value, nullptr, 10));
+    } else if (std::strcmp(arg, "--largest") == 0) {
+      options.largest = std::strtoull(value, nullptr, 10);
+    } else {
+      return false;
+    }
+  }
+  // The query protocol carries no filter and no folder totals.
+  if (options.connect)
+    return options.scanRoot.empty() && options.loadPath.empty() &&
+           options.filter.Empty() && options.largest == 0;
+  return options.scanRoot.empty() != options.loadPath.empty();
+}
+
+double MillisecondsSince(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration<double, std::milli>(
+             std::chrono::steady_clock::now() - start)
+      .count();
+}
+
+// Prints the scan's progress once a second until destroyed.
+class ProgressReporter {
+public:
+  explicit ProgressReporter(const Core::ScanProgress &progress)
+      : m_thread([this, &progress] {
+          std::unique_lock lock(m_mutex);
+          while (!m_wake.wait_for(lock, std::chrono::seconds(1),
+                                  [this] { return m_done; })) {
+            const Core::ScanStats scan = progress.GetStats();
+            std::fprintf(stderr,
+                         "scan_progress found %zu searchable %zu "
+                         "per_s %.0f\n",
+                         scan.entriesFound, scan.entriesPublished,
+                         scan.entriesPerSecond);
+          }
+        }) {}
+
+  ~ProgressReporter() {
+    {
+      std::lock_guard lock(m_mutex);
+      m_done = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+  }
+
+private:
+  std::mutex m_mutex;
+  std::condition_variable m_wake;
+  bool m_done = false;
+  std::thread m_thread;
+};
+
+void Scan(Engine::SearchIndex &index, const Options &options) {
+  auto start = std::chrono::steady_clock::now();
+  Core::ScanProgress progress;
+  std::optional<ProgressReporter> reporter;
+  if (options.progress)
+    reporter.emplace(progress);
+#ifdef _WIN32
+  const std::wstring volume = Utils::WideFromUtf8(options.scanRoot);
+  Core::MftScanner::Enumerate(index, volume, &progress, options.threads);
+  reporter.reset();
+  std::fprintf(stderr, "scan_ms %.1f\n", MillisecondsSince(start));
+  std::fprintf(stderr, "scan_publications %zu\n",
+               progress.GetStats().publications);
+
+  if (options.metadata) {
+    start = std::chrono::steady_clock::now();
+    const size_t updated =
+        Core::MftScanner::CollectMetadata(index, volume, options.threads);
+    std::fprintf(stderr, "metadata_entries %zu\n", updated);
+    std::fprintf(stderr, "metadata_ms %.1f\n", MillisecondsSince(start));
+  }
+#else
+  Core::LinuxMetadataCollector metadata(index);
+  Core::LinuxScanOptions scanOptions;
+  scanOptions.threads = options.threads;
+  scanOptions.progress = &progress;
+  if (options.metadata)
+    scanOptions.onListed = metadata.ListingObserver();
+
+  Core::LinuxScanner::Enumerate(index, options.scanRoot, scanOptions);
+  reporter.reset();
+  std::fprintf(stderr, "scan_ms %.1f\n", MillisecondsSince(start));
+  std::fprintf(stderr, "scan_publications %zu\n",
+               progress.GetStats().publications);
+
+  if (options.metadata) {
+    start = std::chrono::steady_clock::now();
+    // Sizes land in folder totals once, at the end, not per file.
+    index.BeginBulkLoad();
+    metadata.Start();
+    metadata.Wait();
+    index.EndBulkLoad();
+    std::fprintf(stderr, "metadata_backend %s\n",
+                 metadata.ActiveBackend() ==
+                         Core::LinuxMetadataCollector::Backend::IoUring
+                     ? "io_uring"
+                     : "threads");
+    std::fprintf(stderr, "metadata_ms %.1f\n", MillisecondsSince(start));
+  }
+#endif
+}
+
+void PrintQueryTimings(const std::string &query, size_t results,
+                       std::vector<double> &samples, const char *unit) {
+  std::sort(samples.begin(), samples.end());
+  std::fprintf(stderr, "query \"%s\" results %zu min_%s %.3f median_%s %.3f\n",
+               query.c_str(), results, unit, samples.front(), unit,
+               samples[samples.size() / 2]);
+}
+
+int RunClient(const Options &options) {
+  Ipc::QueryClient client;
+  if (!client.Connect(options.endpoint)) {
+    std::fprintf(stderr, "cannot connect to %s\n", options.endpoint.c_str());
+    return 1;
+  }
+
+  for (const auto &query : options.queries) {
+    const std::wstring wideQuery = Utils::WideFromUtf8(query);
+    std::optional<Ipc::QueryResponse> response;
+    std::vector<double> samples;
+    for (size_t run = 0; run < options.repeat; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      response = client.Query(wideQuery, static_cast<uint32_t>(options.limit));
+      samples.push_back(MillisecondsSince(start) * 1000.0);
+      if (!response) {
+        std::fprintf(stderr, "connection lost\n");
+        return 1;
+      }
+    }
+
+    if (!options.quiet) {
+      for (const auto &hit : response->hits)
+        std::printf("%s\n", Utils::Utf8FromWide(hit.path).c_str());
+    }
+    PrintQueryTimings(query, response->hits.size(), samples, "us");
+  }
+
+  if (options.stats) {
+    auto stats = client.Stats();
+    if (!stats) {
+      std::fprintf(stderr, "connection lost\n");
+      return 1;
+    }
+    std::printf("%s\n", stats->c_str());
+  }
+  return 0;
+}
+
+int Serve(Engine::SearchIndex &index, const Options &options) {
+  index.SetLockTracking(true);
+  Ipc::QueryServer server(index);
+  if (!server.Start(options.endpoint)) {
+    std::fprintf(stderr, "cannot listen on %s\n", options.endpoint.c_str());
+    return 1;
+  }
+  std::fprintf(stderr, "serving %s\n", options.endpoint.c_str());
+
+  std::signal(SIGINT, [](int) { g_interrupted = true; });
+  std::signal(SIGTERM, [](int) { g_interrupted = true; });
+  while (!g_interrupted)
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+  server.Stop();
+  std::fprintf(stderr, "queries_served %llu\n", server.QueriesServed());
+  std::fprintf(stderr, "shared_scans %llu\n", server.ScansRun());
+  std::fprintf(stderr, "cache_hits %llu\n", server.CacheHits());
+  return 0;
+}
+
+void PrintLargestFolders(const Engine::SearchIndex &index,
+                         const Options &options) {
+  for (unsigned long long root : index.GetRootIds()) {
+    auto start = std::chrono::steady_clock::now();
+    const auto folders = index.LargestFolders(root, options.largest);
+    const double elapsedMs = MillisecondsSince(start);
+    if (!options.quiet) {
+      for (const auto &[id, totals] : folders) {
+        std::printf("%llu\t%u\t%s\n", totals.bytes, totals.files,
+                    Utils::Utf8FromWide(index.GetFullPath(id)).c_str());
+      }
+    }
+    std::fprintf(stderr, "largest_folders %zu ms %.3f\n", folders.size(),
+                 elapsedMs);
+  }
+}
+
+int Run(const Options &options) {
+  Engine::SearchIndex index;
+  if (!options.loadPath.empty()) {
+    auto start = std::chrono::steady_clock::now();
+    if (!index.LoadSnapshot(options.loadPath)) {
+      std::fprintf(stderr, "cannot load snapshot %s\n",
+                   options.loadPath.c_str());
+      return 1;
+    }
+    std::fprintf(stderr, "load_ms %.1f\n", MillisecondsSince(start));
+  } else {
+    try {
+      Scan(index, options);
+    } catch (const std::exception &e) {
+      std::fprintf(stderr, "scan failed: %s\n", e.what());
+      return 1;
+    }
+  }
+  std::fprintf(stderr, "index_entries %zu\n", index.Count());
+
+  if (!options.savePath.empty()) {
+    auto start = std::chrono::steady_clock::now();
+    if (!index.SaveSnapshot(options.savePath)) {
+      std::fprintf(stderr, "cannot save snapshot %s\n",
+                   options.savePath.c_str());
+      return 1;
+    }
+    std::fprintf(stderr, "save_ms %.1f\n", MillisecondsSince(start));
+  }
+
+  for (const auto &query : options.queries) {
+    const std::wstring wideQuery = Utils::WideFromUtf8(query);
+    std::vector<unsigned long long> results;
+    std::vector<double> samples;
+    for (size_t run = 0; run < options.repeat; ++run) {
+      auto start = std::chrono::steady_clock::now();
+      results = index.Search(wideQuery, options.limit, options.filter);
+      samples.push_back(MillisecondsSince(start));
+    }
+
+    if (!options.quiet) {
+      for (auto id : results) {
+        std::printf("%s\n", Utils::Utf8FromWide(index.GetFullPath(id)).c_str());
+      }
+    }
+    PrintQueryTimings(query, results.size(), samples, "ms");
+  }
+
+  if (options.largest > 0)
+    PrintLargestFolders(index, options);
+
+  return options.serve ? Serve(index, options) : 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+  if (options.connect)
+    return RunClient(options);
+
+  Utils::Trace::Enable(!options.tracePath.empty());
+  Utils::Trace::SetThreadName("main");
+  const int status = Run(options);
+  if (!options.tracePath.empty() &&
+      !Utils::Trace::WriteChromeJson(options.tracePath)) {
+    std::fprintf(stderr, "cannot write trace %s\n", options.tracePath.c_str());
+    return 1;
+  }
+  return status;
+}
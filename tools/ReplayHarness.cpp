@@ -0,0 +1,157 @@
+#include "PulseFS/Core/JournalSource.hpp"
+#include "PulseFS/Core/UsnMonitor.hpp"
+#include "PulseFS/Engine/SearchIndex.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace PulseFS;
+
+namespace {
+
+struct Options {
+  std::string recording;
+  bool realTime = false;
+  Core::SyntheticChurnOptions churn;
+  size_t searchers = 1;
+  long long searchIntervalUs = 1000;
+  std::wstring query = L"index";
+};
+
+void PrintUsage() {
+  std::printf(
+      "usage: pulsefs-replay [--recording <file>] [--realtime]\n"
+      "                      [--buffers <n>] [--directories <n>] [--seed <n>]\n"
+      "                      [--searchers <n>] [--search-interval-us <n>]\n"
+      "                      [--query <text>] [--split]\n"
+      "--split lets a file's records straddle buffers.\n");
+}
+
+bool ParseArgs(int argc, char **argv, Options &options) {
+  for (int i = 1; i < argc; ++i) {
+    const char *arg = argv[i];
+    const char *value = (i + 1 < argc) ? argv[i + 1] : nullptr;
+
+    if (std::strcmp(arg, "--realtime") == 0) {
+      options.realTime = true;
+      continue;
+    }
+    if (std::strcmp(arg, "--split") == 0) {
+      options.churn.splitSequences = true;
+      continue;
+    }
+    if (!value)
+      return false;
+    ++i;
+
+    if (std::strcmp(arg, "--recording") == 0) {
+      options.recording = value;
+    } else if (std::strcmp(arg, "--buffers") == 0) {
+      options.churn.buffers = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--directories") == 0) {
+      options.churn.directories = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--seed") == 0) {
+      options.churn.seed = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--searchers") == 0) {
+      options.searchers = std::strtoull(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--search-interval-us") == 0) {
+      options.searchIntervalUs = std::strtoll(value, nullptr, 10);
+    } else if (std::strcmp(arg, "--query") == 0) {
+      options.query = std::wstring(value, value + std::strlen(value));
+    } else {
+      return false;
+    }
+  }
+  return true;
+}
+
+double Percentile(std::vector<long long> &samples, double fraction) {
+  if (samples.empty())
+    return 0.0;
+  size_t rank = static_cast<size_t>(fraction * (samples.size() - 1));
+  std::nth_element(samples.begin(), samples.begin() + rank, samples.end());
+  return samples[rank] / 1000.0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+  Options options;
+  if (!ParseArgs(argc, argv, options)) {
+    PrintUsage();
+    return 1;
+  }
+
+  Engine::SearchIndex index;
+  std::unique_ptr<Core::JournalSource> source;
+
+  if (!options.recording.empty()) {
+    auto replay = std::make_unique<Core::ReplayJournalSource>(
+        options.recording, options.realTime ? Core::ReplayPacing::RealTime
+                                            : Core::ReplayPacing::FullSpeed);
+    if (!replay->IsOpen()) {
+      std::fprintf(stderr, "cannot read recording %s\n",
+                   options.recording.c_str());
+      return 1;
+    }
+    source = std::move(replay);
+  } else {
+    auto synthetic = std::make_unique<Core::SyntheticJournalSource>(options.churn);
+    for (const auto &entry : synthetic->InitialEntries())
+      index.Insert(entry);
+    source = std::move(synthetic);
+  }
+
+  std::atomic<bool> done = false;
+  std::vector<std::vector<long long>> latencies(options.searchers);
+  std::vector<std::thread> searchers;
+  for (size_t i = 0; i < options.searchers; ++i) {
+    searchers.emplace_back([&, i]() {
+      while (!done) {
+        auto start = std::chrono::steady_clock::now();
+        auto results = index.Search(options.query, 100);
+        auto end = std::chrono::steady_clock::now();
+        latencies[i].push_back(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end - start)
+                .count());
+        if (options.searchIntervalUs > 0) {
+          std::this_thread::sleep_for(
+              std::chrono::microseconds(options.searchIntervalUs));
+        }
+      }
+    });
+  }
+
+  Core::UsnMonitor monitor(index);
+  auto start = std::chrono::steady_clock::now();
+  monitor.Start(std::move(source));
+  monitor.Wait();
+  auto elapsed = std::chrono::steady_clock::now() - start;
+
+  done = true;
+  for (auto &thread : searchers)
+    thread.join();
+
+  std::vector<long long> samples;
+  for (auto &perThread : latencies)
+    samples.insert(samples.end(), perThread.begin(), perThread.end());
+
+  const double seconds = std::chrono::duration<double>(elapsed).count();
+  std::printf("records_decoded %llu\n", monitor.RecordsDecoded());
+  std::printf("changes_applied %llu\n", monitor.ChangesApplied());
+  std::printf("elapsed_ms %.1f\n", seconds * 1000.0);
+  std::printf("records_per_sec %.0f\n",
+              seconds > 0 ? monitor.RecordsDecoded() / seconds : 0.0);
+  std::printf("index_entries %zu\n", index.Count());
+  std::printf("search_queries %zu\n", samples.size());
+  std::printf("search_p50_us %.1f\n", Percentile(samples, 0.50));
+  std::printf("search_p99_us %.1f\n", Percentile(samples, 0.99));
+  std::printf("search_max_us %.1f\n", Percentile(samples, 1.0));
+  return 0;
+}